@@ -16,12 +16,21 @@
 #endif
 #endif // _WIN32
 
+// DebugStream.h does not depend on LibXPUInfo.h, so match XPUINFO_TRY/XPUINFO_CATCH_ALL locally
+#if defined(__cpp_exceptions) || defined(__EXCEPTIONS) || defined(_CPPUNWIND)
+#define DEBUGSTREAM_TRY try
+#define DEBUGSTREAM_CATCH_ALL catch (...)
+#else
+#define DEBUGSTREAM_TRY if (true)
+#define DEBUGSTREAM_CATCH_ALL else
+#endif
+
 namespace XI
 {
 void DebugStream::OutputToDebugger() noexcept
 {
 #if !DISABLE_DEBUGSTREAM
-    try
+    DEBUGSTREAM_TRY
     {
 #ifdef _WIN32
         if (IsDebuggerPresent())
@@ -45,7 +54,7 @@ void DebugStream::OutputToDebugger() noexcept
         clear();
 #endif
     }
-    catch (...)
+    DEBUGSTREAM_CATCH_ALL
     {
     }
 #endif // DISABLE_DEBUGSTREAM
@@ -65,7 +74,7 @@ DebugStream::~DebugStream()
 void DebugStreamW::OutputToDebugger() noexcept
 {
 #if !DISABLE_DEBUGSTREAM
-    try
+    DEBUGSTREAM_TRY
     {
 #ifdef _WIN32
         if (IsDebuggerPresent())
@@ -89,7 +98,7 @@ void DebugStreamW::OutputToDebugger() noexcept
         clear();
 #endif
     }
-    catch (...)
+    DEBUGSTREAM_CATCH_ALL
     {
     }
 #endif // DISABLE_DEBUGSTREAM
@@ -14,6 +14,7 @@
 
 #include <sstream>
 #include <exception>
+#include <cstdlib>
 #include <iomanip>
 #include <unordered_map>
 
@@ -40,7 +41,12 @@ namespace XI
 	{
 		std::ostringstream err;
 		err << message << " at " << fileName << ":" << lineNumber;
+#if XPUINFO_HAS_EXCEPTIONS
 		throw std::logic_error(err.str().c_str());
+#else
+		std::cerr << err.str() << std::endl;
+		std::abort();
+#endif
 	}
 
 	ErrorHandlerType g_ErrorHandlerFunc = ErrorHandlerDefault;
@@ -57,6 +63,18 @@ namespace XI
 		return tmp;
 	}
 
+	const char* getStatusString(Status status) noexcept
+	{
+		switch (status)
+		{
+		case Status::SUCCESS: return "Success";
+		case Status::NOT_SUPPORTED: return "Not supported";
+		case Status::NOT_FOUND: return "Not found";
+		case Status::UNAVAILABLE: return "Unavailable";
+		}
+		return "Unknown";
+	}
+
 	bool XPUInfo::hasDXCore()
 	{
 #ifdef XPUINFO_USE_DXCORE
@@ -227,6 +245,158 @@ namespace XI
 		{9, "Hopper"},
 	};
 
+	/* Peak throughput tables, internal for the same reasons as S_GenNameMap.
+	*  Rates are per compute unit (EU/Vector Engine for Intel, CUDA core for NVIDIA) per clock, with
+	*  multiply-add counted as 2 operations.  Matrix rates are dense (no sparsity).
+	*/
+	struct IntelPeakRates
+	{
+		IntelGfxFamily family;
+		I32 defaultSIMDWidth;	// Used if ComputeUnitSIMDWidth is unknown
+		bool hasDP4A;			// Used in addition to VendorFlags, which come from OpenCL
+		bool hasXMX;
+	};
+	static const IntelPeakRates S_IntelPeakRates[] =
+	{
+		{ IntelGfxFamily::iGen9_Generic,       8, false, false },
+		{ IntelGfxFamily::iGen11_Generic,      8, false, false },
+		{ IntelGfxFamily::iGen12LP_Generic,    8, true,  false },
+		{ IntelGfxFamily::iGen12HP_DG2,        8, true,  true  },
+		{ IntelGfxFamily::iXe_S,               8, true,  false },
+		{ IntelGfxFamily::iXe_L_MeteorLakeH,   8, true,  false },
+		{ IntelGfxFamily::iXe_L_ArrowLakeH,    8, true,  true  },
+		{ IntelGfxFamily::iXe2_Generic,       16, true,  true  },
+		{ IntelGfxFamily::iXe2_LunarLake,     16, true,  true  },
+		{ IntelGfxFamily::iXe2_BattleMage,    16, true,  true  },
+		{ IntelGfxFamily::iXe3_Generic,       16, true,  true  },
+	};
+	// XMX ops per EU per clock, as multiples of SIMD width: DG2 (SIMD8) 128 FP16 / 256 INT8, Xe2 (SIMD16) 256 / 512
+	static const double S_IntelXMXFP16PerLane = 16.;
+	static const double S_IntelXMXINT8PerLane = 32.;
+
+	struct NVPeakRates
+	{
+		UI32 arch;				// nvmlDeviceArchitecture_t
+		double fp32, fp16, bf16, int8; // Per CUDA core per clock; 0 if not supported
+		bool tensorCores;
+	};
+	// Consumer parts where datacenter parts of the same architecture differ (i.e. GA102 rather than GA100)
+	static const NVPeakRates S_NVPeakRates[] =
+	{
+		{ 2, 2., 0.,      0.,  0., false }, // Kepler
+		{ 3, 2., 0.,      0.,  0., false }, // Maxwell
+		{ 4, 2., 2./64.,  0.,  8., false }, // Pascal: FP16 at 1/64, INT8 via DP4A
+		{ 5, 2., 16.,     0.,  8., true  }, // Volta: no INT8 Tensor Core support
+		{ 6, 2., 16.,     0., 32., true  }, // Turing
+		{ 7, 2., 8.,      8., 16., true  }, // Ampere
+		{ 8, 2., 8.,      8., 16., true  }, // Ada
+		{ 9, 2., 32.,    32., 64., true  }, // Hopper
+		{10, 2., 8.,      8., 16., true  }, // Blackwell
+	};
+
+	// NPUs don't report compute units; published dense peak at max frequency
+	struct NPUPeakRates
+	{
+		UI32 gen;				// S_GenNameMap::gen
+		double fp16, int8;
+	};
+	static const NPUPeakRates S_NPUPeakRates[] =
+	{
+		{ 0x80000000, 5.7e12, 11.5e12 }, // NPU2.7
+		{ 0x80000002, 24e12,  48e12 },   // NPU4
+	};
+
+	PeakThroughput Device::getPeakThroughput() const
+	{
+		PeakThroughput peak;
+		if (m_props.MemoryBandWidthMax > 0)
+		{
+			peak.MemoryBandwidth = double(m_props.MemoryBandWidthMax);
+		}
+
+		if (getType() == DEVICE_TYPE_NPU)
+		{
+			for (const auto& rates : S_NPUPeakRates)
+			{
+				if (rates.gen == UI32(m_props.DeviceGenerationID))
+				{
+					peak.FP16 = rates.fp16;
+					peak.INT8 = rates.int8;
+					peak.UsesMatrixEngine = true;
+					break;
+				}
+			}
+			return peak;
+		}
+
+		if ((m_props.NumComputeUnits <= 0) || (m_props.FreqMaxMHz <= 0))
+		{
+			return peak;
+		}
+		const double cuClocks = double(m_props.NumComputeUnits) * m_props.FreqMaxMHz * 1e6;
+
+		if (IsVendor(kVendorId_Intel))
+		{
+			auto family = getIntelGfxFamilyName();
+			const IntelPeakRates* pRates = nullptr;
+			if (family)
+			{
+				for (const auto& rates : S_IntelPeakRates)
+				{
+					if (rates.family == family->first)
+					{
+						pRates = &rates;
+						break;
+					}
+				}
+			}
+			I32 simdWidth = m_props.ComputeUnitSIMDWidth;
+			if (simdWidth <= 0)
+			{
+				if (!pRates)
+				{
+					return peak;
+				}
+				simdWidth = pRates->defaultSIMDWidth;
+			}
+			const auto& flags = m_props.VendorFlags.IntelFeatureFlags;
+			const bool hasDP4A = flags.FLAG_DP4A || (pRates && pRates->hasDP4A);
+			const bool hasXMX = flags.FLAG_DPAS || (pRates && pRates->hasXMX);
+
+			peak.FP32 = cuClocks * simdWidth * 2.;
+			if (hasXMX)
+			{
+				peak.FP16 = cuClocks * simdWidth * S_IntelXMXFP16PerLane;
+				peak.BF16 = peak.FP16;
+				peak.INT8 = cuClocks * simdWidth * S_IntelXMXINT8PerLane;
+				peak.UsesMatrixEngine = true;
+			}
+			else
+			{
+				peak.FP16 = peak.FP32 * 2.; // Packed half
+				// Without DP4A, int8 runs at the packed 16-bit rate
+				peak.INT8 = hasDP4A ? peak.FP32 * 4. : peak.FP16;
+			}
+		}
+		else if (IsVendor(kVendorId_nVidia) && (m_props.DeviceGenerationAPI == API_TYPE_NVML))
+		{
+			for (const auto& rates : S_NVPeakRates)
+			{
+				if (rates.arch == UI32(m_props.DeviceGenerationID))
+				{
+					auto toPeak = [cuClocks](double r) { return (r > 0.) ? cuClocks * r : -1.; };
+					peak.FP32 = toPeak(rates.fp32);
+					peak.FP16 = toPeak(rates.fp16);
+					peak.BF16 = toPeak(rates.bf16);
+					peak.INT8 = toPeak(rates.int8);
+					peak.UsesMatrixEngine = rates.tensorCores;
+					break;
+				}
+			}
+		}
+		return peak;
+	}
+
 	std::ostream& operator<<(std::ostream& s, APIType t)
 	{
 		if (t == API_TYPE_UNKNOWN)
@@ -824,16 +994,16 @@ Device::Device(UI32 inIndex, DXGI_ADAPTER_DESC1* pDesc, DeviceType inType, APITy
 
 		if (!rawDriverVerion)
 		{
-			m_pDriverVersion.reset(new DeviceDriverVersion(m_props.dxgiDesc.AdapterLuid));
+			m_DriverVersion.emplace(m_props.dxgiDesc.AdapterLuid);
 		}
 		else
 		{
-			m_pDriverVersion.reset(new DeviceDriverVersion(rawDriverVerion));
+			m_DriverVersion.emplace(rawDriverVerion);
 		}
 #if defined(_WIN32) && defined(_DEBUG)
 		{
 			DebugStreamW dStr(false);
-			dStr << L"Device: " << name() << L", LUID = " << std::hex << getLUID() << std::dec << L", Version = " << m_pDriverVersion->GetAsWString() << std::endl;
+			dStr << L"Device: " << name() << L", LUID = " << std::hex << getLUID() << std::dec << L", Version = " << m_DriverVersion->GetAsWString() << std::endl;
 		}
 #endif
         
@@ -849,9 +1019,9 @@ static const DeviceDriverVersion S_NullDriverVersion(LUID{});
 
 const DeviceDriverVersion& Device::driverVersion() const
 {
-	if (m_pDriverVersion)
+	if (m_DriverVersion)
 	{
-		return *m_pDriverVersion;
+		return *m_DriverVersion;
 	}
 	else
 	{
@@ -1079,6 +1249,95 @@ XPUInfo::XPUInfo(APIType initMask, const RuntimeNames& runtimeNamesToTrack, size
 	// Init after SystemMemoryInfo (WMI on Win)
 	m_pMemoryInfo.reset(new SystemMemoryInfo(m_pSystemInfo));
 #endif // XPUINFO_USE_SYSTEMEMORYINFO
+	buildDeviceSummaries();
+}
+
+template <class StringT>
+const StringT* PooledString<StringT>::intern(const StringT& str)
+{
+	if (str.empty())
+	{
+		return nullptr;
+	}
+	// Never destroyed, so devices in static storage can still read their strings
+	static std::mutex* s_pMutex = new std::mutex;
+	static auto* s_pStrings = new std::unordered_set<StringT>; // Node-based, so element addresses are stable
+	std::lock_guard<std::mutex> lock(*s_pMutex);
+	return &*s_pStrings->insert(str).first;
+}
+
+template <class StringT>
+const StringT& PooledString<StringT>::getEmpty()
+{
+	static const StringT* s_pEmpty = new StringT;
+	return *s_pEmpty;
+}
+
+template class XPUINFO_EXPORT PooledString<String>;
+template class XPUINFO_EXPORT PooledString<WString>;
+
+std::string_view StringPool::intern(std::string_view str)
+{
+	auto [it, bInserted] = m_Strings.emplace(str);
+	if (bInserted)
+	{
+		m_bytes += it->size();
+	}
+	return *it;
+}
+
+std::string_view StringPool::intern(const WString& str)
+{
+	return intern(convert(str));
+}
+
+void XPUInfo::buildDeviceSummaries()
+{
+	m_DeviceSummaries.clear();
+	m_DeviceSummaries.reserve(m_Devices.size());
+	for (const auto& [luid, dev] : m_Devices)
+	{
+		const auto& props = dev->getProperties();
+		DeviceSummary ds;
+		ds.LUID = luid;
+		ds.pDevice = dev.get();
+		ds.name = m_StringPool.intern(WString(props.dxgiDesc.Description));
+		if (dev->driverVersion().Valid())
+		{
+			ds.driverVersion = m_StringPool.intern(dev->driverVersion().GetAsString());
+		}
+		ds.dedicatedMemory = props.DedicatedMemorySize;
+		ds.sharedMemory = props.SharedMemorySize;
+		ds.memoryBandwidth = props.MemoryBandWidthMax;
+		auto peak = dev->getPeakThroughput();
+		ds.peakFP32 = float(peak.FP32);
+		ds.peakINT8 = float(peak.INT8);
+		ds.adapterIndex = dev->getAdapterIndex();
+		ds.vendorID = props.dxgiDesc.VendorId;
+		ds.deviceID = props.dxgiDesc.DeviceId;
+		ds.computeUnits = props.NumComputeUnits;
+		ds.freqMaxMHz = props.FreqMaxMHz;
+		ds.type = dev->getType();
+		ds.uma = props.UMA;
+		ds.isHighPerformance = props.IsHighPerformance;
+		ds.isMinimumPower = props.IsMinimumPower;
+		ds.intelFeatureFlags = U8(props.VendorFlags.IntelFeatureFlagsUI32);
+		m_DeviceSummaries.push_back(ds);
+	}
+	std::stable_sort(m_DeviceSummaries.begin(), m_DeviceSummaries.end(),
+		[](const DeviceSummary& a, const DeviceSummary& b) { return a.adapterIndex < b.adapterIndex; });
+}
+
+const DeviceSummary* XPUInfo::getDeviceSummary(UI64 inLUID) const
+{
+	for (const auto& ds : m_DeviceSummaries)
+	{
+		if (ds.LUID == inLUID)
+		{
+			return &ds;
+		}
+	}
+	return nullptr;
 }
 
 #if defined(XPUINFO_USE_RUNTIMEVERSIONINFO)
@@ -1107,6 +1366,108 @@ XPUInfo::~XPUInfo()
 {
 }
 
+AsyncXPUInfoBuilder::AsyncXPUInfoBuilder(APIType initMask, const RuntimeNames& runtimeNamesToTrack, const Callback& onStageComplete) :
+	m_Callback(onStageComplete)
+{
+	for (int i = 0; i < 2; ++i)
+	{
+		m_futures[i] = m_promises[i].get_future().share();
+	}
+
+	const APIType coreMask = APIType(initMask & kCoreAPIs);
+	const bool bSeparateCore = (coreMask != initMask);
+	if (bSeparateCore)
+	{
+		// Duplicates core enumeration in the vendor stage, which is cheap compared to loading vendor libraries
+		m_threads.emplace_back([this, coreMask]()
+			{
+				XPUINFO_TRY
+				{
+					publish(STAGE_CORE_ENUMERATION, std::make_shared<XPUInfo>(coreMask));
+				}
+				XPUINFO_CATCH_ALL
+				{
+					m_promises[0].set_exception(std::current_exception());
+				}
+			});
+	}
+	m_threads.emplace_back([this, initMask, runtimeNamesToTrack, bSeparateCore]()
+		{
+			XPUINFO_TRY
+			{
+				auto pXI = std::make_shared<XPUInfo>(initMask, runtimeNamesToTrack);
+				if (!bSeparateCore)
+				{
+					publish(STAGE_CORE_ENUMERATION, pXI);
+				}
+				publish(STAGE_VENDOR_DETAILS, pXI);
+			}
+			XPUINFO_CATCH_ALL
+			{
+				if (!bSeparateCore)
+				{
+					m_promises[0].set_exception(std::current_exception());
+				}
+				m_promises[1].set_exception(std::current_exception());
+			}
+		});
+}
+
+AsyncXPUInfoBuilder::~AsyncXPUInfoBuilder()
+{
+	for (auto& t : m_threads)
+	{
+		t.join();
+	}
+}
+
+void AsyncXPUInfoBuilder::publish(Stage stage, const XPUInfoPtr& pXPUInfo)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		// Vendor stage may finish first; don't replace it with less detail
+		if (stage > m_currentStage)
+		{
+			m_pCurrent = pXPUInfo;
+			m_currentStage = stage;
+		}
+	}
+	if (m_Callback)
+	{
+		XPUINFO_TRY
+		{
+			m_Callback(stage, pXPUInfo);
+		}
+		XPUINFO_CATCH_ALL
+		{
+			// Callback errors must not prevent the future from being set
+		}
+	}
+	m_promises[stage - 1].set_value(pXPUInfo);
+}
+
+std::shared_future<XPUInfoPtr> AsyncXPUInfoBuilder::getFuture(Stage stage) const
+{
+	XPUINFO_REQUIRE((stage == STAGE_CORE_ENUMERATION) || (stage == STAGE_VENDOR_DETAILS));
+	return m_futures[stage - 1];
+}
+
+XPUInfoPtr AsyncXPUInfoBuilder::getCurrent(Stage* pOutStage) const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (pOutStage)
+	{
+		*pOutStage = m_currentStage;
+	}
+	return m_pCurrent;
+}
+
+AsyncXPUInfoBuilder::Stage AsyncXPUInfoBuilder::getStage() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_currentStage;
+}
+
 template <APIType APITYPE>
 bool XPUInfo::getDevice(UI64 inLUID, typename API_Traits<APITYPE>::API_handle_type* outTypePtr)
 {
@@ -1211,6 +1572,28 @@ const DevicePtr XPUInfo::getDeviceByIndex(UI32 inIndex) const
 	return DevicePtr();
 }
 
+Result<DevicePtr> XPUInfo::tryGetDevice(UI64 inLUID) const noexcept
+{
+	auto it = m_Devices.find(inLUID);
+	if (it != m_Devices.end())
+	{
+		return it->second;
+	}
+	return Status::NOT_FOUND;
+}
+
+Result<DevicePtr> XPUInfo::tryGetDeviceByIndex(UI32 inIndex) const noexcept
+{
+	for (const auto& [luidUnused, dev] : m_Devices)
+	{
+		if (dev->getAdapterIndex() == inIndex)
+		{
+			return dev;
+		}
+	}
+	return Status::NOT_FOUND;
+}
+
 #if defined(_WIN32) && !defined(_M_ARM64)
 float DriverInfo::SystemTimeToYears(const SYSTEMTIME& inSysTime) 
 {
@@ -1485,6 +1868,25 @@ std::ostream& operator<<(std::ostream& ostr, const Device& xiDev)
 	{
 		ostr << "\tPackage TDP (W): " << devProps.PackageTDP << std::endl;
 	}
+	auto peak = xiDev.getPeakThroughput();
+	if (peak.isValid())
+	{
+		SaveRestoreIOSFlags sr(ostr);
+		auto printTOPS = [&ostr](const char* label, double ops) {
+			if (ops > 0.)
+				ostr << " " << label << " " << std::fixed << std::setprecision(2) << ops * 1e-12;
+		};
+		ostr << "\tPeak TFLOPS/TOPS:";
+		printTOPS("FP32", peak.FP32);
+		printTOPS("FP16", peak.FP16);
+		printTOPS("BF16", peak.BF16);
+		printTOPS("INT8", peak.INT8);
+		if (peak.UsesMatrixEngine)
+			ostr << " (matrix)";
+		if (peak.getRidgePoint() > 0.)
+			ostr << ", FP32 Ridge Point: " << std::setprecision(1) << peak.getRidgePoint() << " FLOP/byte";
+		ostr << std::endl;
+	}
 	return ostr;
 }
 
@@ -1811,6 +2213,36 @@ DXCoreAdapterMemoryBudget XI::Device::getMemUsage() const
 	return memUsage;
 }
 
+Result<DXCoreAdapterMemoryBudget> XI::Device::tryGetMemUsage() const noexcept
+{
+#if __APPLE__
+	// getMemUsage_Metal() is not noexcept
+	XPUINFO_TRY
+	{
+		return getMemUsage_Metal();
+	}
+	XPUINFO_CATCH_ALL
+	{
+		return Status::UNAVAILABLE;
+	}
+#else
+
+#ifdef XPUINFO_USE_DXCORE
+	if (XPUInfo::hasDXCore())
+	{
+		DXCoreAdapterMemoryBudget memUsage{};
+		if (FAILED(queryMemUsage_DXCORE(memUsage)))
+		{
+			return Status::UNAVAILABLE;
+		}
+		return memUsage;
+	}
+#endif
+#endif
+
+	return Status::NOT_SUPPORTED;
+}
+
 std::ostream& operator<<(std::ostream& ostr, const ConstDevicePtrVec& devPtrs)
 {
 	ostr << devPtrs.m_label << " (" << devPtrs.size() << "):\n";
@@ -1864,13 +2296,25 @@ const DeviceCPU& XPUInfo::getCPUDevice() const
 	return *m_pCPU;
 }
 
+Result<const DeviceCPU*> XPUInfo::tryGetCPUDevice() const noexcept
+{
+	if (!m_pCPU)
+	{
+		return Status::NOT_FOUND;
+	}
+	return m_pCPU.get();
+}
+
 #ifdef XPUINFO_USE_SYSTEMEMORYINFO
-size_t SystemMemoryInfo::getCurrentAvailablePhysicalMemory()
+Result<size_t> SystemMemoryInfo::tryGetCurrentAvailablePhysicalMemory() noexcept
 {
 #ifdef _WIN32
 	PERFORMANCE_INFORMATION pi;
-	XPUINFO_REQUIRE(GetPerformanceInfo(&pi, sizeof(pi)));
-	return pi.PhysicalAvailable * pi.PageSize;
+	if (!GetPerformanceInfo(&pi, sizeof(pi)))
+	{
+		return Status::UNAVAILABLE;
+	}
+	return size_t(pi.PhysicalAvailable * pi.PageSize);
 #elif defined(__APPLE__)
 	mach_port_t            hostPort;
 	mach_msg_type_number_t hostSize;
@@ -1882,31 +2326,52 @@ size_t SystemMemoryInfo::getCurrentAvailablePhysicalMemory()
 
 	vm_statistics64_data_t vmStat;
 
-	XPUINFO_REQUIRE(host_statistics(hostPort, HOST_VM_INFO, (host_info_t)&vmStat, &hostSize) == KERN_SUCCESS);
-	return vmStat.free_count * pageSize;
+	if (host_statistics(hostPort, HOST_VM_INFO, (host_info_t)&vmStat, &hostSize) != KERN_SUCCESS)
+	{
+		return Status::UNAVAILABLE;
+	}
+	return size_t(vmStat.free_count * pageSize);
 #elif defined(__linux__)
 	long availablePages = sysconf(_SC_AVPHYS_PAGES);
-	XPUINFO_REQUIRE(availablePages != -1);
 	long pagesize = sysconf(_SC_PAGESIZE);
-	XPUINFO_REQUIRE(pagesize != -1);
-
-	return availablePages * pagesize;
+	if ((availablePages == -1) || (pagesize == -1))
+	{
+		return Status::UNAVAILABLE;
+	}
+	return size_t(availablePages * pagesize);
 #else
-	return 0;
+	return Status::NOT_SUPPORTED;
 #endif
 }
 
-size_t SystemMemoryInfo::getCurrentTotalPhysicalMemory()
+Result<size_t> SystemMemoryInfo::tryGetCurrentTotalPhysicalMemory() noexcept
 {
 #ifdef _WIN32
 	PERFORMANCE_INFORMATION pi;
-	XPUINFO_REQUIRE(GetPerformanceInfo(&pi, sizeof(pi)));
-	return pi.PhysicalTotal * pi.PageSize;
+	if (!GetPerformanceInfo(&pi, sizeof(pi)))
+	{
+		return Status::UNAVAILABLE;
+	}
+	return size_t(pi.PhysicalTotal * pi.PageSize);
 #else
-	return 0;
+	return Status::NOT_SUPPORTED;
 #endif
 }
 
+size_t SystemMemoryInfo::getCurrentAvailablePhysicalMemory()
+{
+	auto result = tryGetCurrentAvailablePhysicalMemory();
+	XPUINFO_REQUIRE(result || (result.error() == Status::NOT_SUPPORTED));
+	return result.value_or(0);
+}
+
+size_t SystemMemoryInfo::getCurrentTotalPhysicalMemory()
+{
+	auto result = tryGetCurrentTotalPhysicalMemory();
+	XPUINFO_REQUIRE(result || (result.error() == Status::NOT_SUPPORTED));
+	return result.value_or(0);
+}
+
 size_t SystemMemoryInfo::getCurrentInstalledPhysicalMemory()
 {
 #ifdef _WIN32
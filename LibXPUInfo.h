@@ -60,8 +60,15 @@
 #include <iostream>
 #include <mutex>
 #include <limits>
+#include <optional>
+#include <array>
 #include <functional>
 #include <sstream>
+#include <thread>
+#include <condition_variable>
+#include <future>
+#include <string_view>
+#include <unordered_set>
 
 #ifdef _WIN32
 #pragma warning(push)
@@ -69,10 +76,24 @@
 #endif
 
 namespace XI {
+    // With exceptions enabled, the default handler throws std::logic_error.  Without exceptions the
+    // default handler prints the message and aborts, and a custom handler must not return.
     typedef void(*ErrorHandlerType)(const std::string& message, const char* fileName, const int lineNumber);
     XPUINFO_EXPORT ErrorHandlerType getErrorHandlerFunc();
     XPUINFO_EXPORT ErrorHandlerType setErrorHandlerFunc(ErrorHandlerType f);
 }
+
+// The library builds with exceptions disabled (i.e. -fno-exceptions) when the C++/WinRT-based APIs
+// (XPUINFO_USE_DXCORE, XPUINFO_USE_WMI) are not used.  Use these instead of try/catch.
+#if defined(__cpp_exceptions) || defined(__EXCEPTIONS) || defined(_CPPUNWIND)
+#define XPUINFO_HAS_EXCEPTIONS 1
+#define XPUINFO_TRY try
+#define XPUINFO_CATCH_ALL catch (...)
+#else
+#define XPUINFO_HAS_EXCEPTIONS 0
+#define XPUINFO_TRY if (true)
+#define XPUINFO_CATCH_ALL else
+#endif
 #define ENABLE_PER_LOGICAL_CPUID_ISA_DETECTION 0
 #define XPUINFO_REQUIRE(x) if (!(x)) XI::getErrorHandlerFunc()(#x, __FILE__, __LINE__)
 #define XPUINFO_REQUIRE_CONSTEXPR_MSG(x, msg) if constexpr (!(x)) { \
@@ -207,6 +228,45 @@ namespace XI
         NoCopyAssign& operator=(const NoCopyAssign&) = delete;
     };
 
+    // String interned in a process-wide pool, for device and driver strings that repeat across devices
+    // and may outlive the XPUInfo that read them.  Holds a pointer instead of a copy, and converts to
+    // const StringT& so it reads like the string it replaces.
+    template <class StringT>
+    class PooledString
+    {
+    public:
+        PooledString() = default;
+        PooledString(const StringT& str) : m_pStr(intern(str)) {}
+        PooledString& operator=(const StringT& str) { m_pStr = intern(str); return *this; }
+
+        const StringT& str() const { return m_pStr ? *m_pStr : getEmpty(); }
+        operator const StringT&() const { return str(); }
+        const typename StringT::value_type* c_str() const { return str().c_str(); }
+        size_t length() const { return str().length(); }
+        size_t size() const { return str().size(); }
+        bool empty() const { return !m_pStr; }
+
+        // Equal strings share one pooled copy
+        friend bool operator==(const PooledString& lhs, const PooledString& rhs) { return lhs.m_pStr == rhs.m_pStr; }
+        friend bool operator!=(const PooledString& lhs, const PooledString& rhs) { return lhs.m_pStr != rhs.m_pStr; }
+        friend bool operator==(const PooledString& lhs, const StringT& rhs) { return lhs.str() == rhs; }
+        friend bool operator==(const StringT& lhs, const PooledString& rhs) { return lhs == rhs.str(); }
+        friend bool operator!=(const PooledString& lhs, const StringT& rhs) { return lhs.str() != rhs; }
+        friend bool operator!=(const StringT& lhs, const PooledString& rhs) { return lhs != rhs.str(); }
+        friend std::basic_ostream<typename StringT::value_type>& operator<<(
+            std::basic_ostream<typename StringT::value_type>& ostr, const PooledString& str) { return ostr << str.str(); }
+
+    protected:
+        // Null for the empty string.  Pooled strings are never freed.
+        static const StringT* intern(const StringT& str);
+        static const StringT& getEmpty();
+        const StringT* m_pStr = nullptr;
+    };
+    extern template class XPUINFO_EXPORT PooledString<String>;
+    extern template class XPUINFO_EXPORT PooledString<WString>;
+    using PooledUTF8String = PooledString<String>;
+    using PooledWString = PooledString<WString>;
+
     enum DeviceType : UI32
     {
         DEVICE_TYPE_UNKNOWN = 0,
@@ -264,6 +324,37 @@ namespace XI
         NONUMA_DISCRETE =   1 << 1
     };
 
+    // Status of the noexcept query variants (tryGet*)
+    enum class Status : UI32
+    {
+        SUCCESS = 0,
+        NOT_SUPPORTED,      // Not provided by the OS/APIs in use, or not compiled in
+        NOT_FOUND,
+        UNAVAILABLE,        // OS or driver query failed
+    };
+    XPUINFO_EXPORT const char* getStatusString(Status status) noexcept;
+
+    // Value or Status, in the style of std::expected
+    template <typename T>
+    class Result
+    {
+    public:
+        Result(const T& value) : m_value(value), m_status(Status::SUCCESS) {}
+        Result(Status status) : m_value(), m_status(status) {}
+        bool has_value() const noexcept { return m_status == Status::SUCCESS; }
+        explicit operator bool() const noexcept { return has_value(); }
+        Status error() const noexcept { return m_status; }
+        // Value-initialized T if !has_value()
+        const T& value() const noexcept { return m_value; }
+        T value_or(const T& defaultValue) const { return has_value() ? m_value : defaultValue; }
+        const T& operator*() const noexcept { return m_value; }
+        const T* operator->() const noexcept { return &m_value; }
+
+    protected:
+        T m_value;
+        Status m_status;
+    };
+
     inline double BtoGB(size_t n)
     {
         return (n / (1024.0 * 1024 * 1024));
@@ -346,12 +437,13 @@ namespace XI
     struct XPUINFO_EXPORT DriverInfo
     {
         LUID DeviceLUID = {};
-        WString DriverDesc;
-        WString DeviceDesc;
-        WString DriverVersion;
-        WString DriverInfSection; // DEVPKEY_Device_DriverInfSection
-        WString DeviceInstanceId; // DEVPKEY_Device_InstanceId, to correlate with WMI data
+        PooledWString DriverDesc;
+        PooledWString DeviceDesc;
+        PooledWString DriverVersion;
+        PooledWString DriverInfSection; // DEVPKEY_Device_DriverInfSection
+        PooledWString DeviceInstanceId; // DEVPKEY_Device_InstanceId, to correlate with WMI data
         PCIAddressType LocationInfo;
+        I32 NumaNode = -1;          // DEVPKEY_Device_Numa_Node, -1 if unknown
 #ifdef _WIN32
         FILETIME DriverDate = {};   // When driver was created/published
         FILETIME InstallDate = {};  // When driver was installed
@@ -379,6 +471,27 @@ namespace XI
     };
     typedef std::pair<IntelGfxFamily, std::string> IntelGfxFamilyNamePair;
 
+    // Theoretical peak throughput, see Device::getPeakThroughput().
+    // Operations/sec, counting a multiply-add as 2 operations.  -1 if unknown or not supported.
+    struct XPUINFO_EXPORT PeakThroughput
+    {
+        double FP32 = -1.;
+        double FP16 = -1.;
+        double BF16 = -1.;
+        double INT8 = -1.;
+        double MemoryBandwidth = -1.;   // bytes/sec, from DeviceProperties::MemoryBandWidthMax
+        bool UsesMatrixEngine = false;  // FP16/BF16/INT8 rates are for matrix engines (XMX/DPAS, Tensor Cores)
+
+        bool isValid() const { return (FP32 > 0.) || (INT8 > 0.); }
+        // Roofline ridge point: arithmetic intensity (ops/byte) above which a kernel running at
+        // peakOps is compute-bound rather than memory-bound.  -1 if unknown.
+        double getRidgePoint(double peakOps) const
+        {
+            return ((peakOps > 0.) && (MemoryBandwidth > 0.)) ? peakOps / MemoryBandwidth : -1.;
+        }
+        double getRidgePoint() const { return getRidgePoint(FP32); }
+    };
+
     const UINT kVendorId_Intel = 0x8086;
     const UINT kVendorId_nVidia = 0x10de;
 
@@ -525,6 +638,7 @@ namespace XI
         bool IsVendor(const UINT inVendorId) const { return m_props.IsVendor(inVendorId); }
 
         DXCoreAdapterMemoryBudget getMemUsage() const;
+        Result<DXCoreAdapterMemoryBudget> tryGetMemUsage() const noexcept;
 
 #ifdef XPUINFO_USE_RAPIDJSON
         rapidjson::Value serialize(JSON::AllocatorType& a);
@@ -532,13 +646,14 @@ namespace XI
 #endif
         bool operator==(const Device& dev) const;
         std::optional<IntelGfxFamilyNamePair> getIntelGfxFamilyName() const;
+        // Derived from compute units, SIMD width, max frequency and generation, using internal per-architecture tables
+        PeakThroughput getPeakThroughput() const;
 
     protected:
         APIType validAPIs = API_TYPE_UNKNOWN;
         DeviceProperties m_props;
 
-        // unique_ptr helps avoid unintentional copying, but not valid as member of vector
-        SharedPtr<DeviceDriverVersion> m_pDriverVersion;
+        std::optional<DeviceDriverVersion> m_DriverVersion;
 #ifdef _WIN32
         void initDXIntelPerfCounter(IDXGIAdapter1*);
 #endif
@@ -550,13 +665,13 @@ namespace XI
         // IGCL
         void initIGCLDevice(ctl_device_adapter_handle_t inHandle, IGCLAdapterPropertiesPtr& inPropsPtr);
         ctl_device_adapter_handle_t m_hIGCLAdapter = nullptr;
-        String m_IGCLAdapterName;
+        PooledUTF8String m_IGCLAdapterName;
 
         // OpenCL
         void initOpenCLDevice(cl_platform_id inPlatform, cl_device_id inDevice, const std::string& inExtensions);
         cl_device_id m_CLDevice = nullptr;
         cl_platform_id m_CLPlatform = nullptr;
-        String m_OpenCLAdapterName;
+        PooledUTF8String m_OpenCLAdapterName;
 
         // DXCore
 #ifdef _WIN32
@@ -564,6 +679,9 @@ namespace XI
         winrt::com_ptr<IDXCoreAdapter> m_pDXCoreAdapter;
 #endif
         DXCoreAdapterMemoryBudget getMemUsage_DXCORE() const;
+#ifdef XPUINFO_USE_DXCORE
+        HRESULT queryMemUsage_DXCORE(DXCoreAdapterMemoryBudget& outMemUsage) const noexcept;
+#endif
         DXCoreAdapterMemoryBudget getMemUsage_Metal() const;
 
         // NVML
@@ -588,21 +706,54 @@ namespace XI
     };
 
 #ifdef XPUINFO_USE_TELEMETRYTRACKER
+    class CPUThermalMonitor; // Fwd decl, see LibXPUInfo_HostTelemetry.h
+    class CPUIdleMonitor; // Fwd decl, see LibXPUInfo_HostTelemetry.h
+    class ResCtrlMonitor; // Fwd decl, see LibXPUInfo_ResCtrl.h
+    class TelemetryTraceWriter; // Fwd decl, see LibXPUInfo_TraceExport.h
+    class TelemetryHistory; // Fwd decl, see LibXPUInfo_TelemetryHistory.h
+    class TelemetryRegionLog; // Fwd decl, see LibXPUInfo_TelemetryRegions.h
+    class TelemetryRealtimeWriter; // Fwd decl, see LibXPUInfo_TelemetryRealtime.h
+    class TelemetryWindow; // Fwd decl, see LibXPUInfo_TelemetryQuery.h
+    class TelemetryRollup; // Fwd decl, see LibXPUInfo_TelemetryRollup.h
+    class TelemetryChangeDetector; // Fwd decl, see LibXPUInfo_TelemetryChange.h
+    class TelemetryClockCorrelator; // Fwd decl, see LibXPUInfo_TelemetryClock.h
+
     class XPUINFO_EXPORT TelemetryTracker : public NoCopyAssign
     {
     public:
         friend class Device;
+        friend class TelemetryTraceWriter;
+        friend class TelemetryRegionLog;
+        friend class TelemetryRealtimeWriter;
+        friend class TelemetryWindow;
+        friend class TelemetryRollup;
+        friend class TelemetryBottleneckClassifier;
+        // deviceToTrack may be null to track only host (CPU) telemetry.  Records are written to
+        // pRealTimeOutputStream as CSV from a background thread (see setRealtimeOutputParams).
         TelemetryTracker(const DevicePtr& deviceToTrack, UI32 msPeriod, std::ostream* pRealTimeOutputStream = nullptr);
         virtual ~TelemetryTracker() noexcept(false);
 
         void start();
         void stop();
+        // All records as CSV; see TelemetryWindow to read records or aggregates of a time window
         String getLog() const;
 
         UI64 getMaxMemUsage() const;
         UI64 getInitialMemUsage() const;
 
         const DevicePtr& getDevice() const;
+        const CPUThermalMonitor* getCPUThermalMonitor() const { return m_pCPUThermal.get(); }
+        const CPUIdleMonitor* getCPUIdleMonitor() const { return m_pCPUIdle.get(); }
+
+        // Per-core-type columns: index 0 is P-cores (or all cores if not hybrid), index 1 is E-cores
+        static constexpr UI32 kMaxCPUCoreTypes = 2;
+        static UI32 getCPUCoreTypeIndex(short coreType);
+
+        // Track LLC occupancy and memory bandwidth of resctrl monitoring groups (see ResCtrlMonitor).
+        // Call before start().  Returns false if none of the groups can be monitored.
+        static constexpr UI32 kMaxResCtrlGroups = 4;
+        bool setResCtrlMonitorGroups(const std::vector<String>& groups, const String& resctrlRoot = String());
+        const ResCtrlMonitor* getResCtrlMonitor() const { return m_pResCtrlMon.get(); }
 
         enum TelemetryItem : UI32
         {
@@ -620,6 +771,11 @@ namespace XI
             TELEMETRYITEM_FREQUENCY_MEDIA =         1 << 8,
             TELEMETRYITEM_FREQUENCY_MEMORY =        1 << 9,
 
+            TELEMETRYITEM_CPU_THERMAL =             1 << 10, // CPU throttling and thermal headroom (Linux sysfs)
+            TELEMETRYITEM_RESCTRL_MON =             1 << 11, // LLC occupancy and memory bandwidth (Linux resctrl)
+            TELEMETRYITEM_CPU_IDLE =                1 << 12, // C-state residency (Linux cpuidle)
+            TELEMETRYITEM_DEVICE_ENERGY =           1 << 13, // Cumulative device energy (IGCL, NVML), reported as power
+
             // TODO: PCI bandwidth?  Neither IGCL nor L0 working now.  Can derive from micro+mem_bw, though.
         };
 
@@ -649,8 +805,181 @@ namespace XI
 
             double pctCPU;
             double cpu_freq;
+
+            // CPU thermal, per core type (see getCPUCoreTypeIndex): deltas since previous record
+            UI32 cpuThrottleEvents[kMaxCPUCoreTypes];
+            UI32 cpuThrottleTimeMs[kMaxCPUCoreTypes];
+            UI32 cpuPackageThrottleEvents;  // Package counters, over all packages
+            UI32 cpuPackageThrottleTimeMs;
+            double cpuTempC;
+            double cpuThermalHeadroomC;
+
+            // C-state residency since previous record, per core type, averaged over CPUs
+            double cpuIdlePct[kMaxCPUCoreTypes];
+            double cpuDeepestIdlePct[kMaxCPUCoreTypes];   // Time in deepest enabled C-state
+            double cpuBusiestPct;   // Time not idle of the busiest CPU, over all core types
+
+            // resctrl monitoring, per group (see setResCtrlMonitorGroups)
+            UI64 llcOccupancyBytes[kMaxResCtrlGroups];
+            double hostMemBWTotal[kMaxResCtrlGroups]; // Bytes/s
+            double hostMemBWLocal[kMaxResCtrlGroups]; // Bytes/s
+
+            double deviceEnergyJ;   // Cumulative
+
+            // Derived when recorded, from this and the previous record (see setDerivedMetricsParams).
+            // NaN if not available, i.e. rates for the first record.
+            double readBWBytesPerSec;
+            double writeBWBytesPerSec;
+            double activityGlobalPct;
+            double activityComputePct;
+            double activityMediaPct;
+            double devicePowerW;
+            UI32 counterWrapMask;   // TelemetryItems whose counters wrapped since the previous record
+            UI32 counterResetMask;  // TelemetryItems whose counters were reset, so rates count from 0
         };
         typedef std::vector<TimedRecord> TimedRecords;
+        // Most recent record; Status::UNAVAILABLE if nothing has been recorded yet
+        Result<TimedRecord> tryGetLatestRecord() const noexcept;
+
+        struct SampleResult
+        {
+            TimedRecord record{};
+            UI64 hostTimeNs = 0;                        // When sampled; see getHostTimeNs()
+            UI32 items = TELEMETRYITEM_UNKNOWN;         // TelemetryItems read now
+            UI32 itemsFromLatestRecord = TELEMETRYITEM_UNKNOWN;
+            double latencyUs = 0.;                      // Cost of sampleNow()
+            bool usedRecordMutex = false;
+        };
+        // Read the requested TelemetryItems now, without waiting for the next period or appending a record.
+        // Memory usage is read without the record mutex.  Device frequency, activity and bandwidth share
+        // API state with recording, so briefly take it.  Items measured over the sampling period (CPU
+        // thermal, idle, resctrl) are copied from the latest record.  Record fields otherwise have the same
+        // meaning as in recorded records; the timestamp is the CPU's unless IGCL items were read.  Derived
+        // metrics are relative to the latest record, without smoothing.
+        SampleResult sampleNow(UI32 mask);
+
+        struct DerivedMetricsParams
+        {
+            double smoothingAlpha = 1.;     // EWMA weight of the newest value, in (0, 1]; 1 for no smoothing
+            UI32 bwCounterBits = 64;        // Width of the bandwidth counters, for wraparound detection
+        };
+        // Call before start()
+        void setDerivedMetricsParams(const DerivedMetricsParams& params);
+        const DerivedMetricsParams& getDerivedMetricsParams() const { return m_DerivedParams; }
+
+        // Record time on the host monotonic clock (steady_clock/CLOCK_MONOTONIC, or QPC on Windows), in ns.
+        // The host clock is system-wide, so records of other trackers and processes can be merged on it.
+        // Device (i.e. IGCL) timestamps are converted with the clock correlation, as fitted when called.
+        UI64 getHostTimeNs(const TimedRecord& rec) const;
+        static UI64 getCurrentHostTimeNs();
+
+        // Device timestamps (TELEMETRYITEM_TIMESTAMP_DOUBLE) are periodically paired with host clock
+        // readings, to fit their offset and drift (see TelemetryClockCorrelator).
+        struct ClockCorrelationParams
+        {
+            UI32 intervalMs = 1000;         // Between pairs; 0 to pair every record
+            double minFitSpanSec = 1.;      // Drift is taken as 0 until pairs span this (std dev of device time)
+            double maxDriftPPM = 1000.;     // Fitted drift is clamped to this, so conversion stays monotonic
+        };
+        struct ClockCorrelation
+        {
+            UI32 numPairs = 0;
+            double offsetNs = 0.;           // Host time at device time 0
+            double driftPPM = 0.;           // Device clock rate relative to host, minus 1
+            double residualNs = 0.;         // RMS error predicting new pairs (recent weighted)
+            double minBracketNs = 0.;       // Fastest host time around reading the device timestamp
+        };
+        // Call before start()
+        void setClockCorrelationParams(const ClockCorrelationParams& params);
+        // numPairs is 0 without device timestamps
+        ClockCorrelation getClockCorrelation() const;
+        // Device timestamp to and from the host clock; the first record is the anchor until there are pairs
+        UI64 deviceToHostNs(double deviceSec) const;
+        double hostToDeviceSec(UI64 hostNs) const;
+
+        // Stream each new record to pWriter as it is recorded (nullptr to stop).  pWriter must outlive
+        // streaming.  Records already taken are not written; see TelemetryTraceWriter::writeRecords().
+        void setTraceWriter(TelemetryTraceWriter* pWriter);
+
+        // Keep history compressed in memory (see TelemetryHistory) rather than as TimedRecords, dropping the
+        // oldest records once it exceeds maxBytes (if non-zero).  Call before start().
+        void enableCompressedHistory(size_t maxBytes = 0);
+        const TelemetryHistory* getCompressedHistory() const { return m_pHistory.get(); }
+
+        // Application region markers on the host clock, for per-region summaries (see TelemetryRegionLog).
+        // Call enableRegionMarkers() before start(); until then, begin/endRegion() do nothing.
+        void enableRegionMarkers(UI32 maxMarkers = 16384);
+        bool beginRegion(const char* name, UI64 instance = 0);
+        bool endRegion(const char* name, UI64 instance = 0);
+        const TelemetryRegionLog* getRegionLog() const { return m_pRegionLog.get(); }
+
+        enum RealtimeDropPolicy : UI32
+        {
+            REALTIME_DROP_NEWEST = 0,   // Discard records arriving while the queue is full
+            REALTIME_DROP_OLDEST,       // Discard the oldest queued record
+            REALTIME_BLOCK,             // Wait for space, so a slow stream stalls sampling
+        };
+        struct RealtimeOutputParams
+        {
+            UI32 queueCapacity = 1024;      // Records
+            UI32 flushIntervalMs = 250;     // 0 to flush after every batch
+            UI32 batchBytes = 64 * 1024;    // Formatted CSV written per stream write
+            RealtimeDropPolicy dropPolicy = REALTIME_DROP_NEWEST;
+        };
+        // Call before start(); no effect without pRealTimeOutputStream
+        void setRealtimeOutputParams(const RealtimeOutputParams& params);
+        // Null without pRealTimeOutputStream
+        TelemetryRealtimeWriter* getRealtimeWriter() const { return m_pRealtimeWriter.get(); }
+
+        // Retention tiers of counter rollups (see TelemetryRollup), i.e. { {10000, 8640}, {60000, 10080} }
+        // for 10 s buckets over a day and 1 min buckets over a week.  rawRetentionMs (if non-zero) bounds
+        // the records kept at full resolution to about that long; see enableCompressedHistory() to bound
+        // compressed history instead.  Call before start().
+        struct RollupTier
+        {
+            UI32 bucketMs;
+            UI32 numBuckets;
+        };
+        void enableRollups(const std::vector<RollupTier>& tiers, UI32 maxCounters = 32, UI32 rawRetentionMs = 0);
+        const TelemetryRollup* getRollup() const { return m_pRollup.get(); }
+
+        // Online change-point detection on counters (see TelemetryChangeDetector).  Changes are passed to
+        // the callback and listed by getLog().
+        enum ChangeDetectorMethod : UI32
+        {
+            CHANGE_DETECTOR_CUSUM = 0,
+            CHANGE_DETECTOR_EWMA,
+        };
+        struct ChangeDetectorParams
+        {
+            String counterName;             // As in getLog(), i.e. "Freq(MHz)"
+            ChangeDetectorMethod method = CHANGE_DETECTOR_CUSUM;
+            UI32 warmupSamples = 30;        // To estimate the baseline
+            double threshold = 5.;          // CUSUM decision interval, or EWMA control limit, in std devs
+            double cusumSlack = 0.5;        // Shift ignored by CUSUM, in std devs
+            double ewmaLambda = 0.2;
+            double minRelStdDev = 0.01;     // Floor of the baseline std dev, relative to its mean
+        };
+        struct ChangeEvent
+        {
+            String counterName;
+            ChangeDetectorMethod method = CHANGE_DETECTOR_CUSUM;
+            UI64 timeNs = 0;                // Host clock, when detected
+            UI64 onsetNs = 0;               // Estimated start of the change
+            bool bIncrease = false;
+            double beforeMean = 0.;         // Baseline
+            double beforeStdDev = 0.;
+            double afterMean = 0.;          // Samples since onset
+            double afterStdDev = 0.;
+            UI32 afterSamples = 0;
+        };
+        typedef std::function<void(const ChangeEvent& event)> ChangeEventFunc;
+        // Call before start(), and after setResCtrlMonitorGroups() for its counters.  False if counterName
+        // is not a counter of getLog() on this system (i.e. no per-core-type CPU counters).
+        bool addChangeDetector(const ChangeDetectorParams& params);
+        // Called from the recording thread after the record is stored, without the record lock held
+        void setChangeEventCallback(const ChangeEventFunc& func);
+        std::vector<ChangeEvent> getChangeEvents() const;
 
 #ifdef _WIN32
         static VOID CALLBACK
@@ -669,7 +998,7 @@ namespace XI
 #endif
 
     protected:
-        std::mutex m_RecordMutex;
+        mutable std::mutex m_RecordMutex;
         const DevicePtr m_Device; // Tracker will keep device "alive" if needed
         const DWORD m_msPeriod;
         TelemetryItem m_ResultMask;
@@ -686,6 +1015,9 @@ namespace XI
 
         void InitL0();
         void InitIGCL();
+        void InitCPUThermal();
+        void InitCPUIdle();
+        APIType getDeviceAPIs() const { return m_Device ? m_Device->getCurrentAPIs() : API_TYPE_UNKNOWN; }
 
         void RecordNow();
         bool RecordMemoryUsage(TimedRecord& rec);
@@ -693,16 +1025,88 @@ namespace XI
         bool RecordNVML(TimedRecord& rec);
         bool RecordL0(TimedRecord& rec);
         bool RecordCPUTimestamp(TimedRecord& rec);
-        void printRecord(TimedRecords::const_iterator it, std::ostream& ostr) const;
+        static bool readCPUTimestamp(UI64& ticks);
+        bool RecordCPUThermal(TimedRecord& rec);
+        bool RecordCPUIdle(TimedRecord& rec);
+        bool RecordResCtrl(TimedRecord& rec);
+        // Fills derived fields of rec; pPrev is null for the first record
+        void computeDerivedMetrics(TimedRecord& rec, const TimedRecord* pPrev, double smoothingAlpha) const;
+        void printRecord(const TimedRecord& rec, std::ostream& ostr) const;
+        // Tracker state that appendRecordCSV() formats with, read with m_RecordMutex held.  The realtime
+        // writer queues a copy with each record so its thread does not read the tracker.
+        struct RecordFormat
+        {
+            TelemetryItem resultMask = TELEMETRYITEM_UNKNOWN;
+            double startTime = 0.;
+            UI64 startTimeUI64 = 0;
+            UI32 numResCtrlGroups = 0;
+        };
+        RecordFormat getRecordFormat() const;
+        void appendRecordCSV(const TimedRecord& rec, String& buf) const;
+        void appendRecordCSV(const TimedRecord& rec, const RecordFormat& format, String& buf) const;
+        // Change events to pass to m_changeEventFunc are added to newEvents
+        void detectChanges(const TimedRecord& rec, std::vector<ChangeEvent>& newEvents);
+        void printChangeEvents(std::ostream& ostr) const;
+        // Device timestamp read between host times hostBeforeNs and hostAfterNs
+        void correlateClock(double deviceSec, UI64 hostBeforeNs, UI64 hostAfterNs);
         void printRecordHeader(std::ostream& ostr) const;
+        // Counters of a record as in getLog(), by column name.  Rates are not reported for the first record.
+        typedef std::function<void(const String& name, double value)> CounterFunc;
+        void getRecordCounters(const TimedRecord& rec, const CounterFunc& func) const;
+        // Counters of getRecordCounters(), built once the tracked items are known, so names are not
+        // rebuilt for each record
+        struct CounterDesc
+        {
+            String name;
+            UI32 mask;                      // TelemetryItems that must all be tracked
+            bool bFiniteOnly;               // Derived values are NaN when not available
+            std::function<double(const TimedRecord& rec)> get;
+        };
+        void buildCounterDescs();
+        // False if desc is not tracked or not available for rec
+        bool getCounter(const CounterDesc& desc, const TimedRecord& rec, double& value) const;
+        // All records in order, from compressed history if enabled.  Call with m_RecordMutex held if recording.
+        typedef std::function<void(const TimedRecord& rec, const TimedRecord* pPrev)> RecordFunc;
+        void forEachRecord(const RecordFunc& func) const;
+        TelemetryTraceWriter* m_pTraceWriter = nullptr;
 #ifdef _WIN32
         PTP_TIMER m_timer = nullptr;
         TP_CALLBACK_ENVIRON m_CallBackEnviron;
         PTP_CLEANUP_GROUP m_cleanupgroup = nullptr;
+#else
+        // Sampling thread used in place of the Win32 threadpool timer
+        void SamplerThreadFunc();
+        std::thread m_samplerThread;
+        std::mutex m_samplerMutex;
+        std::condition_variable m_samplerCV;
+        bool m_bSamplerStop = false;
 #endif
+        SharedPtr<CPUThermalMonitor> m_pCPUThermal;
+        SharedPtr<CPUIdleMonitor> m_pCPUIdle;
+        UI32 m_numCPUCoreTypes = 0;
+        SharedPtr<ResCtrlMonitor> m_pResCtrlMon;
+        SharedPtr<TelemetryHistory> m_pHistory; // When enabled, m_records only holds the latest record
+        SharedPtr<TelemetryRegionLog> m_pRegionLog;
+        DerivedMetricsParams m_DerivedParams;
+        SharedPtr<TelemetryRealtimeWriter> m_pRealtimeWriter;
+        SharedPtr<TelemetryRollup> m_pRollup;
+        UI64 m_rawRetentionNs = 0;
+        std::vector<CounterDesc> m_counterDescs;
+        struct ChangeDetectorEntry
+        {
+            CounterDesc counter;            // Resolved when added
+            SharedPtr<TelemetryChangeDetector> pDetector;
+        };
+        std::vector<ChangeDetectorEntry> m_changeDetectors;
+        ChangeEventFunc m_changeEventFunc;
+        std::vector<ChangeEvent> m_changeEvents;
+        UI64 m_numChangeEventsDropped = 0;
+        ClockCorrelationParams m_ClockParams;
+        SharedPtr<TelemetryClockCorrelator> m_pClockCorrelator; // Created with the first pair
         
         double m_startTime = 0.;
         UI64 m_startTimeUI64 = 0;
+        UI64 m_startHostTimeNs = 0;
         UI64 m_timestamp_freq = 0;
 
         double m_freqMax = 0.;
@@ -900,6 +1304,8 @@ namespace XI
 
         static size_t getCurrentAvailablePhysicalMemory();
         static size_t getCurrentTotalPhysicalMemory(); // Should not change over time - just static impl
+        static Result<size_t> tryGetCurrentAvailablePhysicalMemory() noexcept;
+        static Result<size_t> tryGetCurrentTotalPhysicalMemory() noexcept;
         static size_t getCurrentInstalledPhysicalMemory(); // Should not change over time - just static impl
         size_t getInstalledPhysicalMemory() const { return m_installedPhysicalMemory; }
         size_t getTotalPhysicalMemory() const { return m_totalPhysicalMemory; }
@@ -916,6 +1322,48 @@ namespace XI
     };
 #endif // XPUINFO_USE_SYSTEMEMORYINFO
 
+    // Interned UTF-8 strings.  Views returned by intern() remain valid for the lifetime of the pool.
+    // Not thread-safe for interning; filled while an XPUInfo is constructed.
+    class XPUINFO_EXPORT StringPool : public NoCopyAssign
+    {
+    public:
+        std::string_view intern(std::string_view str);
+        std::string_view intern(const WString& str);
+        size_t size() const { return m_Strings.size(); }
+        size_t getBytes() const { return m_bytes; } // Characters stored, excluding container overhead
+
+    protected:
+        std::unordered_set<String> m_Strings; // Node-based, so element addresses are stable
+        size_t m_bytes = 0;
+    };
+
+    // Cache-friendly copy of the scheduler-relevant fields of a Device, for iterating devices without
+    // touching the full DeviceProperties (DXGI description, driver info, etc.).  Summaries are kept in
+    // addition to the Devices, so they add to the memory footprint rather than reduce it.
+    // See XPUInfo::getDeviceSummaries().
+    struct DeviceSummary
+    {
+        UI64 LUID = 0;
+        const Device* pDevice = nullptr;    // Full device, owned by the same XPUInfo
+        std::string_view name;              // UTF-8, interned in XPUInfo::getStringPool()
+        std::string_view driverVersion;     // UTF-8, interned; empty if unknown
+        UI64 dedicatedMemory = 0;
+        UI64 sharedMemory = 0;
+        I64 memoryBandwidth = -1;           // bytes/sec
+        float peakFP32 = -1.f;              // ops/sec, see Device::getPeakThroughput()
+        float peakINT8 = -1.f;
+        UI32 adapterIndex = 0;
+        UI32 vendorID = 0;
+        UI32 deviceID = 0;
+        I32 computeUnits = -1;
+        I32 freqMaxMHz = -1;
+        DeviceType type = DEVICE_TYPE_UNKNOWN;
+        UMAType uma = UMA_UNKNOWN;
+        I8 isHighPerformance = -1;
+        I8 isMinimumPower = -1;
+        U8 intelFeatureFlags = 0;           // DeviceProperties::VendorFlags
+    };
+
     class XPUInfo;
     typedef std::shared_ptr<XPUInfo> XPUInfoPtr;
     typedef std::vector<std::string> RuntimeNames;
@@ -935,7 +1383,15 @@ namespace XI
         const DevicePtr getDevice(const char* inNameSubString) const;
         const DevicePtr getDeviceByIndex(UI32 inIndex) const;
         const DeviceMap& getDeviceMap() const { return m_Devices; }
+        // Copies of hot fields of each device in adapter index order, with strings interned in getStringPool()
+        const std::vector<DeviceSummary>& getDeviceSummaries() const { return m_DeviceSummaries; }
+        const DeviceSummary* getDeviceSummary(UI64 inLUID) const;
+        const StringPool& getStringPool() const { return m_StringPool; }
         const DeviceCPU& getCPUDevice() const;
+        // noexcept lookups; Status::NOT_FOUND rather than a null DevicePtr
+        Result<DevicePtr> tryGetDevice(UI64 inLUID) const noexcept;
+        Result<DevicePtr> tryGetDeviceByIndex(UI32 inIndex) const noexcept;
+        Result<const DeviceCPU*> tryGetCPUDevice() const noexcept;
 
         void printInfo(std::ostream& ostr) const;
         void printCPUInfo(std::ostream& ostr) const;
@@ -987,7 +1443,10 @@ namespace XI
         void initMetal();
 #endif
         void finalInitDXGI();
+        void buildDeviceSummaries();
         DeviceMap m_Devices;
+        StringPool m_StringPool;
+        std::vector<DeviceSummary> m_DeviceSummaries;
         const APIType m_InitAPIs;
 
         APIType m_UsedAPIs;
@@ -1010,6 +1469,47 @@ namespace XI
     };
     XPUINFO_EXPORT std::ostream& operator<<(std::ostream& ostr, const XPUInfo& xi);
 
+    // Builds XPUInfo in the background, publishing a complete XPUInfo as each stage finishes so callers
+    // can start with the CPU and core-enumerated devices before vendor libraries have loaded.
+    // Each published XPUInfo is fully constructed and never modified afterwards, so views are consistent;
+    // a later stage publishes a separate, more detailed XPUInfo.
+    class XPUINFO_EXPORT AsyncXPUInfoBuilder : public NoCopyAssign
+    {
+    public:
+        enum Stage : UI32
+        {
+            STAGE_NONE = 0,
+            STAGE_CORE_ENUMERATION,     // CPU and devices from kCoreAPIs
+            STAGE_VENDOR_DETAILS,       // All requested APIs, as XPUInfo(initMask)
+        };
+        static const APIType kCoreAPIs = APIType(UI32(API_TYPE_DXGI) | UI32(API_TYPE_DXCORE) | UI32(API_TYPE_METAL));
+        // Called from a builder thread.  Not called for a stage that failed; see getFuture().
+        typedef std::function<void(Stage stage, const XPUInfoPtr& pXPUInfo)> Callback;
+
+        // Returns immediately.  Both stages start at once, on separate threads.
+        AsyncXPUInfoBuilder(APIType initMask, const RuntimeNames& runtimeNamesToTrack = RuntimeNames(),
+            const Callback& onStageComplete = nullptr);
+        ~AsyncXPUInfoBuilder(); // Waits for outstanding stages
+
+        // Future for a stage; get() rethrows if construction failed
+        std::shared_future<XPUInfoPtr> getFuture(Stage stage) const;
+        XPUInfoPtr wait(Stage stage = STAGE_VENDOR_DETAILS) const { return getFuture(stage).get(); }
+        // Most detailed XPUInfo published so far, or nullptr
+        XPUInfoPtr getCurrent(Stage* pOutStage = nullptr) const;
+        Stage getStage() const;
+
+    protected:
+        void publish(Stage stage, const XPUInfoPtr& pXPUInfo);
+
+        const Callback m_Callback;
+        mutable std::mutex m_mutex;
+        XPUInfoPtr m_pCurrent;
+        Stage m_currentStage = STAGE_NONE;
+        std::promise<XPUInfoPtr> m_promises[2];
+        std::shared_future<XPUInfoPtr> m_futures[2];
+        std::vector<std::thread> m_threads;
+    };
+
     // ScopedRegisterNotification inteded to work as no-op when DXCORE is not available
     class XPUINFO_EXPORT ScopedRegisterNotification : public NoCopyAssign
     {
@@ -296,16 +296,25 @@ void Device::initDXCoreDevice(com_ptr<IDXCoreAdapter>& pDXCoreAdapter, bool bHig
 DXCoreAdapterMemoryBudget Device::getMemUsage_DXCORE() const
 {
     DXCoreAdapterMemoryBudget memUsage{};
-    DXCoreAdapterMemoryBudgetNodeSegmentGroup nsg{}; // Want all-zero
 
     if (XPUInfo::hasDXCore())
     {
         XPUINFO_REQUIRE(m_pDXCoreAdapter);
-        THROW_IF_FAILED(m_pDXCoreAdapter->QueryState(DXCoreAdapterState::AdapterMemoryBudget, &nsg, &memUsage));
+        THROW_IF_FAILED(queryMemUsage_DXCORE(memUsage));
     }
     return memUsage;
 }
 
+HRESULT Device::queryMemUsage_DXCORE(DXCoreAdapterMemoryBudget& outMemUsage) const noexcept
+{
+    DXCoreAdapterMemoryBudgetNodeSegmentGroup nsg{}; // Want all-zero
+    if (!m_pDXCoreAdapter)
+    {
+        return E_POINTER;
+    }
+    return m_pDXCoreAdapter->QueryState(DXCoreAdapterState::AdapterMemoryBudget, &nsg, &outMemUsage);
+}
+
 void ScopedRegisterNotification::DXCoreNotificationCallback(DXCoreNotificationType notificationType,
     IUnknown* object,
     void* context)
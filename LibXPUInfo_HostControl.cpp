@@ -0,0 +1,513 @@
+// Copyright (C) 2024 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "LibXPUInfo_HostControl.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <tuple>
+#ifdef __linux__
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace XI
+{
+namespace
+{
+    String getCPUFreqDir(const String& sysRoot, UI32 cpu)
+    {
+        return sysRoot + "/devices/system/cpu/cpu" + std::to_string(cpu) + "/cpufreq/";
+    }
+
+    std::vector<String> readWordList(const String& path)
+    {
+        std::vector<String> words;
+        String str;
+        if (Sysfs::readString(path, str))
+        {
+            std::istringstream istr(str);
+            String w;
+            while (istr >> w)
+            {
+                words.push_back(w);
+            }
+        }
+        return words;
+    }
+
+    // platform_profile_choices and the current profile use the same names
+    const char kPlatformProfile[] = "/firmware/acpi/platform_profile";
+    const char kJournalHeader[] = "# LibXPUInfo CPUPerfModeGuard restore journal";
+
+    void splitPath(const String& path, String& dir, String& attribute)
+    {
+        const size_t slash = path.rfind('/');
+        dir = (slash == String::npos) ? String() : path.substr(0, slash + 1);
+        attribute = (slash == String::npos) ? path : path.substr(slash + 1);
+    }
+
+    bool writeAttribute(const CPUPerfModeGuard::WriteFunc& writeFunc, const String& path, const String& value)
+    {
+        return writeFunc ? writeFunc(path, value) : Sysfs::writeString(path, value);
+    }
+
+    // Order of writing {path, value} pairs: per cpufreq directory, the governor before EPP (intel_pstate
+    // only accepts EPP changes for some governors), then min/max ordered so that min <= max holds after
+    // each write.  Directories keep their order.
+    std::vector<size_t> getWriteOrder(const std::vector<std::pair<String, String>>& entries)
+    {
+        const auto rank = [](const String& attribute)
+        {
+            return (attribute == "scaling_governor") ? 0 : (attribute == "energy_performance_preference") ? 1 :
+                ((attribute == "scaling_min_freq") || (attribute == "scaling_max_freq")) ? 2 : 3;
+        };
+        std::vector<String> dirs;
+        std::map<String, std::vector<size_t>> byDir;
+        for (size_t i = 0; i < entries.size(); ++i)
+        {
+            String dir, attribute;
+            splitPath(entries[i].first, dir, attribute);
+            if (!byDir.count(dir))
+            {
+                dirs.push_back(dir);
+            }
+            byDir[dir].push_back(i);
+        }
+
+        std::vector<size_t> order;
+        for (const auto& dir : dirs)
+        {
+            auto& indices = byDir[dir];
+            std::stable_sort(indices.begin(), indices.end(), [&](size_t a, size_t b)
+                {
+                    String d, attrA, attrB;
+                    splitPath(entries[a].first, d, attrA);
+                    splitPath(entries[b].first, d, attrB);
+                    return rank(attrA) < rank(attrB);
+                });
+            auto itMin = std::find_if(indices.begin(), indices.end(), [&](size_t i) { return entries[i].first == dir + "scaling_min_freq"; });
+            auto itMax = std::find_if(indices.begin(), indices.end(), [&](size_t i) { return entries[i].first == dir + "scaling_max_freq"; });
+            if ((itMin != indices.end()) && (itMax != indices.end()))
+            {
+                // Max first if the new min is above the current max
+                auto curMax = Sysfs::readUI64(dir + "scaling_max_freq");
+                const bool bMaxFirst = curMax.has_value() && (std::strtoull(entries[*itMin].second.c_str(), nullptr, 10) > curMax.value());
+                if (bMaxFirst != (itMax < itMin))
+                {
+                    std::iter_swap(itMin, itMax);
+                }
+            }
+            order.insert(order.end(), indices.begin(), indices.end());
+        }
+        return order;
+    }
+
+    // With bSkipCurrent, values already in place are not written
+    bool restoreValues(const std::vector<std::pair<String, String>>& entries, bool bSkipCurrent,
+        const CPUPerfModeGuard::WriteFunc& writeFunc)
+    {
+        bool bRestored = true;
+        for (size_t i : getWriteOrder(entries))
+        {
+            String cur;
+            if (bSkipCurrent && Sysfs::readString(entries[i].first, cur) && (cur == entries[i].second))
+            {
+                continue;
+            }
+            bRestored = writeAttribute(writeFunc, entries[i].first, entries[i].second) && bRestored;
+        }
+        return bRestored;
+    }
+}
+
+CPUPerfModeGuard::CPUPerfModeGuard(const Params& params) :
+    m_journalPath(params.journalPath), m_bDryRun(params.dryRun), m_writeFunc(params.writeFunc)
+{
+    // Undo a guard that did not exit cleanly first, else its values would be taken as the originals
+    if (m_journalPath.size() && !m_bDryRun)
+    {
+        recoverFromJournal(m_journalPath, m_writeFunc);
+    }
+    plan(params);
+    if (m_bDryRun)
+    {
+        return;
+    }
+    if (m_journalPath.size() && !writeJournal())
+    {
+        // Don't change anything that couldn't be recovered after a crash
+        for (auto& c : m_Changes)
+        {
+            if (c.error.empty())
+            {
+                c.error = "failed to write journal " + m_journalPath;
+            }
+        }
+        return;
+    }
+    apply();
+}
+
+CPUPerfModeGuard::~CPUPerfModeGuard()
+{
+    restore();
+}
+
+CPUPerfModeGuard::Change* CPUPerfModeGuard::addChange(I32 cpu, const String& attribute, const String& path, const String& requested,
+    const std::vector<String>& allowed)
+{
+    // Settings for a specific core type override those for CoreTypes::ANY
+    auto it = std::find_if(m_Changes.begin(), m_Changes.end(), [&path](const Change& c) { return c.path == path; });
+    if (it != m_Changes.end())
+    {
+        m_Changes.erase(it);
+    }
+
+    Change c;
+    c.cpu = cpu;
+    c.attribute = attribute;
+    c.path = path;
+    c.requested = requested;
+    if (!Sysfs::readString(path, c.previous))
+    {
+        c.error = "not available";
+    }
+    else if (c.previous == requested)
+    {
+        return nullptr;
+    }
+    else if (allowed.size() && (std::find(allowed.begin(), allowed.end(), requested) == allowed.end()))
+    {
+        c.error = "not supported";
+    }
+    m_Changes.push_back(c);
+    return &m_Changes.back();
+}
+
+void CPUPerfModeGuard::plan(const Params& params)
+{
+    const auto cpusByType = Sysfs::getCPUsByCoreType(params.sysRoot);
+    std::vector<UI32> allCPUs;
+    for (const auto& [coreType, cpus] : cpusByType)
+    {
+        allCPUs.insert(allCPUs.end(), cpus.begin(), cpus.end());
+    }
+    std::sort(allCPUs.begin(), allCPUs.end());
+
+    // Apply ANY first so that core type specific settings take precedence
+    std::vector<std::pair<std::vector<UI32>, const Settings*>> work;
+    auto anyIt = params.coreTypes.find(HybridDetect::CoreTypes::ANY);
+    if (anyIt != params.coreTypes.end())
+    {
+        work.emplace_back(allCPUs, &anyIt->second);
+    }
+    for (const auto& [coreType, settings] : params.coreTypes)
+    {
+        if (coreType != HybridDetect::CoreTypes::ANY)
+        {
+            auto ctIt = cpusByType.find(coreType);
+            if (ctIt != cpusByType.end())
+            {
+                work.emplace_back(ctIt->second, &settings);
+            }
+        }
+    }
+
+    for (const auto& [cpus, pSettings] : work)
+    {
+        for (auto cpu : cpus)
+        {
+            const String dir = getCPUFreqDir(params.sysRoot, cpu);
+            // Written in dependency order by apply(); see getWriteOrder()
+            if (pSettings->governor.has_value())
+            {
+                addChange(cpu, "scaling_governor", dir + "scaling_governor", pSettings->governor.value(),
+                    readWordList(dir + "scaling_available_governors"));
+            }
+            if (pSettings->epp.has_value())
+            {
+                addChange(cpu, "energy_performance_preference", dir + "energy_performance_preference", pSettings->epp.value(),
+                    readWordList(dir + "energy_performance_available_preferences"));
+            }
+
+            auto addFreq = [&](const char* attribute, const std::optional<UI32>& value)
+            {
+                if (!value.has_value())
+                {
+                    return;
+                }
+                Change* pChange = addChange(cpu, attribute, dir + attribute, std::to_string(value.value()));
+                auto hwMin = Sysfs::readUI64(dir + "cpuinfo_min_freq");
+                auto hwMax = Sysfs::readUI64(dir + "cpuinfo_max_freq");
+                if (pChange && pChange->error.empty() &&
+                    ((hwMin.has_value() && (value.value() < hwMin.value())) || (hwMax.has_value() && (value.value() > hwMax.value()))))
+                {
+                    pChange->error = "out of range";
+                }
+            };
+            addFreq("scaling_min_freq", pSettings->minFreqKHz);
+            addFreq("scaling_max_freq", pSettings->maxFreqKHz);
+        }
+    }
+
+    if (params.platformProfile.has_value())
+    {
+        const String path = params.sysRoot + kPlatformProfile;
+        addChange(-1, "platform_profile", path, params.platformProfile.value(), readWordList(path + "_choices"));
+    }
+}
+
+bool CPUPerfModeGuard::writeJournal() const
+{
+    std::ostringstream ostr;
+    ostr << kJournalHeader << "\n";
+    for (const auto& c : m_Changes)
+    {
+        if (c.error.empty())
+        {
+            ostr << c.path << "\t" << c.previous << "\n";
+        }
+    }
+    const String text = ostr.str();
+#ifdef __linux__
+    // Synced before anything is changed, so the journal survives a crash or power loss
+    int fd = open(m_journalPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0)
+    {
+        return false;
+    }
+    bool bOK = (write(fd, text.data(), text.size()) == (ssize_t)text.size()) && (fsync(fd) == 0);
+    bOK = (close(fd) == 0) && bOK;
+    String dir, name;
+    splitPath(m_journalPath, dir, name);
+    int dirFd = open(dir.size() ? dir.c_str() : ".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dirFd >= 0)
+    {
+        fsync(dirFd); // Make the new directory entry durable
+        close(dirFd);
+    }
+    return bOK;
+#else
+    std::ofstream ofs(m_journalPath, std::ios::out | std::ios::trunc);
+    ofs << text;
+    ofs.flush();
+    return ofs.good();
+#endif
+}
+
+void CPUPerfModeGuard::apply()
+{
+    std::vector<std::pair<String, String>> entries;
+    for (const auto& c : m_Changes)
+    {
+        entries.emplace_back(c.path, c.requested);
+    }
+    m_bApplied = true;
+    for (size_t i : getWriteOrder(entries))
+    {
+        auto& c = m_Changes[i];
+        if (c.error.empty())
+        {
+            c.applied = writeAttribute(m_writeFunc, c.path, c.requested);
+            if (!c.applied)
+            {
+                c.error = "write failed";
+            }
+        }
+        m_bApplied = m_bApplied && c.applied;
+    }
+}
+
+void CPUPerfModeGuard::restore()
+{
+    if (m_bRestored)
+    {
+        return;
+    }
+    m_bRestored = true;
+
+    std::vector<std::pair<String, String>> entries;
+    for (const auto& c : m_Changes)
+    {
+        if (c.applied)
+        {
+            entries.emplace_back(c.path, c.previous);
+        }
+    }
+    const bool bRestored = restoreValues(entries, false, m_writeFunc);
+    // Keep the journal if something couldn't be restored, so a later recoverFromJournal() can retry
+    if (bRestored && m_journalPath.size() && !m_bDryRun)
+    {
+        std::remove(m_journalPath.c_str());
+    }
+}
+
+void CPUPerfModeGuard::printReport(std::ostream& ostr) const
+{
+    // {attribute, previous, requested, status} -> CPUs
+    std::map<std::tuple<String, String, String, String>, std::vector<UI32>> groups;
+    for (const auto& c : m_Changes)
+    {
+        const String status = c.applied ? "applied" : (c.error.size() ? c.error : "dry-run");
+        auto& cpus = groups[std::make_tuple(c.attribute, c.previous, c.requested, status)];
+        if (c.cpu >= 0)
+        {
+            cpus.push_back(UI32(c.cpu));
+        }
+    }
+    ostr << "CPU performance mode changes" << (m_bDryRun ? " (dry-run)" : "") << ":\n";
+    if (groups.empty())
+    {
+        ostr << "\tNone\n";
+    }
+    for (const auto& [key, cpus] : groups)
+    {
+        ostr << "\t" << std::get<0>(key) << ": " << (std::get<1>(key).size() ? std::get<1>(key) : String("?"))
+             << " -> " << std::get<2>(key) << " [" << std::get<3>(key) << "]";
+        if (cpus.size())
+        {
+            ostr << " CPUs " << Sysfs::formatCPUList(cpus);
+        }
+        ostr << std::endl;
+    }
+}
+
+std::map<short, CPUPerfModeGuard::Settings> CPUPerfModeGuard::readCurrent(const String& sysRoot)
+{
+    std::map<short, Settings> current;
+    for (const auto& [coreType, cpus] : Sysfs::getCPUsByCoreType(sysRoot))
+    {
+        if (cpus.empty())
+        {
+            continue;
+        }
+        const String dir = getCPUFreqDir(sysRoot, cpus.front());
+        Settings s;
+        String str;
+        if (Sysfs::readString(dir + "scaling_governor", str))
+        {
+            s.governor = str;
+        }
+        if (Sysfs::readString(dir + "energy_performance_preference", str))
+        {
+            s.epp = str;
+        }
+        auto minFreq = Sysfs::readUI64(dir + "scaling_min_freq");
+        if (minFreq.has_value())
+        {
+            s.minFreqKHz = UI32(minFreq.value());
+        }
+        auto maxFreq = Sysfs::readUI64(dir + "scaling_max_freq");
+        if (maxFreq.has_value())
+        {
+            s.maxFreqKHz = UI32(maxFreq.value());
+        }
+        current[coreType] = s;
+    }
+    return current;
+}
+
+std::optional<String> CPUPerfModeGuard::readPlatformProfile(const String& sysRoot)
+{
+    String profile;
+    if (Sysfs::readString(sysRoot + kPlatformProfile, profile))
+    {
+        return profile;
+    }
+    return std::nullopt;
+}
+
+bool CPUPerfModeGuard::recoverFromJournal(const String& journalPath, const WriteFunc& writeFunc)
+{
+    std::ifstream ifs(journalPath);
+    if (!ifs.good())
+    {
+        return true; // Nothing to recover
+    }
+    std::vector<std::pair<String, String>> entries;
+    String line;
+    while (std::getline(ifs, line))
+    {
+        auto tab = line.find('\t');
+        if (line.empty() || (line[0] == '#') || (tab == String::npos))
+        {
+            continue;
+        }
+        entries.emplace_back(line.substr(0, tab), line.substr(tab + 1));
+    }
+    ifs.close();
+
+    const bool bRestored = restoreValues(entries, true, writeFunc);
+    if (bRestored)
+    {
+        std::remove(journalPath.c_str());
+    }
+    return bRestored;
+}
+
+PMQoSLatencyGuard::PMQoSLatencyGuard(const Params& params) : m_maxLatencyUs(params.maxLatencyUs)
+{
+    if (params.cpus.empty())
+    {
+#ifdef __linux__
+        // The request is a binary s32, held for as long as the file stays open
+        m_fd = open(params.dmaLatencyPath.c_str(), O_WRONLY | O_CLOEXEC);
+        if (m_fd >= 0)
+        {
+            I32 value = I32(std::min<UI32>(m_maxLatencyUs, std::numeric_limits<I32>::max()));
+            if (write(m_fd, &value, sizeof(value)) == (ssize_t)sizeof(value))
+            {
+                m_bActive = true;
+            }
+            else
+            {
+                close(m_fd);
+                m_fd = -1;
+            }
+        }
+#endif
+        return;
+    }
+
+    // For pm_qos_resume_latency_us, "0" means no constraint and "n/a" means 0us.
+    // Values read back use the same convention, so they can be written as-is on restore.
+    const String value = m_maxLatencyUs ? std::to_string(m_maxLatencyUs) : String("n/a");
+    m_bActive = true;
+    for (auto cpu : params.cpus)
+    {
+        const String path = params.sysRoot + "/devices/system/cpu/cpu" + std::to_string(cpu) + "/power/pm_qos_resume_latency_us";
+        String prev;
+        if (!Sysfs::readString(path, prev) || !Sysfs::writeString(path, value))
+        {
+            m_bActive = false;
+            continue;
+        }
+        m_prevValues.emplace_back(path, prev);
+    }
+}
+
+PMQoSLatencyGuard::~PMQoSLatencyGuard()
+{
+    release();
+}
+
+void PMQoSLatencyGuard::release()
+{
+#ifdef __linux__
+    if (m_fd >= 0)
+    {
+        close(m_fd);
+        m_fd = -1;
+    }
+#endif
+    for (auto it = m_prevValues.rbegin(); it != m_prevValues.rend(); ++it)
+    {
+        Sysfs::writeString(it->first, it->second);
+    }
+    m_prevValues.clear();
+    m_bActive = false;
+}
+
+} // XI
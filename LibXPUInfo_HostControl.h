@@ -0,0 +1,132 @@
+// Copyright (C) 2024 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+// Scoped host (CPU/platform) power and performance controls.
+//
+// Each guard applies settings for its lifetime and restores the previous values on destruction.
+// Like the sources in LibXPUInfo_HostTelemetry.h, these use Linux sysfs relative to a
+// caller-provided root so they can be exercised against a fixture tree.  Writing to the real /sys
+// requires root privileges; failed writes are reported rather than thrown.
+
+#pragma once
+#include "LibXPUInfo.h"
+#include "LibXPUInfo_Util.h"
+
+#ifdef _WIN32
+#pragma warning(push)
+#pragma warning(disable : 4251)
+#endif
+
+namespace XI
+{
+    // cpufreq governor, energy_performance_preference (EPP), scaling min/max frequency and ACPI
+    // platform_profile.  Values are written per CPU in dependency order (governor, EPP, then min/max
+    // keeping min <= max), and restored in the same order.
+    //
+    // An optional journal file records original values (synced to disk) before anything is written.
+    // Recovery after a crash is not automatic: it happens when the next guard with the same journal
+    // path is constructed, or when recoverFromJournal() is called, i.e. at application startup.
+    class XPUINFO_EXPORT CPUPerfModeGuard : public NoCopyAssign
+    {
+    public:
+        struct Settings
+        {
+            std::optional<String> governor;     // i.e. "performance", "powersave", "schedutil"
+            std::optional<String> epp;          // i.e. "performance", "balance_performance", "power"
+            std::optional<UI32> minFreqKHz;
+            std::optional<UI32> maxFreqKHz;
+        };
+        // Writes one attribute, returning false on failure
+        typedef std::function<bool(const String& path, const String& value)> WriteFunc;
+        struct Params
+        {
+            // Keyed by HybridDetect::CoreTypes; CoreTypes::ANY applies to all CPUs
+            std::map<short, Settings> coreTypes;
+            std::optional<String> platformProfile; // i.e. "performance", "balanced", "low-power"
+            String sysRoot = Sysfs::kDefaultSysRoot;
+            String journalPath;                 // Empty for no journal
+            bool dryRun = false;                // Only compute and report changes
+            // Empty for Sysfs::writeString.  A test can reject the writes the kernel would (i.e. EPP under
+            // the performance governor, min above max frequency) to check the write order on a fixture.
+            WriteFunc writeFunc;
+        };
+
+        struct Change
+        {
+            I32 cpu = -1;                       // -1 for platform-wide settings
+            String attribute;                   // i.e. "scaling_governor", "platform_profile"
+            String path;
+            String previous;
+            String requested;
+            bool applied = false;
+            String error;                       // Why the change was not applied, if not dry-run
+        };
+
+        CPUPerfModeGuard(const Params& params);
+        ~CPUPerfModeGuard();
+
+        // True if every planned change was written (always false in dry-run mode)
+        bool isApplied() const { return m_bApplied; }
+        bool isDryRun() const { return m_bDryRun; }
+        const std::vector<Change>& getChanges() const { return m_Changes; }
+        // Changes grouped by attribute and value, listing CPUs in cpulist format
+        void printReport(std::ostream& ostr) const;
+        void restore();
+
+        // Current settings of the first CPU of each core type
+        static std::map<short, Settings> readCurrent(const String& sysRoot = Sysfs::kDefaultSysRoot);
+        static std::optional<String> readPlatformProfile(const String& sysRoot = Sysfs::kDefaultSysRoot);
+
+        // Restore values recorded in a journal left behind by a guard that did not exit cleanly.
+        // Removes the journal if all values were restored.  Returns false if any write failed.
+        static bool recoverFromJournal(const String& journalPath, const WriteFunc& writeFunc = WriteFunc());
+
+    protected:
+        void plan(const Params& params);
+        // Returns nullptr if the value is already as requested
+        Change* addChange(I32 cpu, const String& attribute, const String& path, const String& requested,
+            const std::vector<String>& allowed = {});
+        bool writeJournal() const;
+        void apply();
+
+        const String m_journalPath;
+        const bool m_bDryRun;
+        const WriteFunc m_writeFunc;
+        bool m_bApplied = false;
+        bool m_bRestored = false;
+        std::vector<Change> m_Changes;
+    };
+
+    // Bounds CPU wake-up latency (and so the C-states cpuidle may select) for the lifetime of the guard.
+    // With no CPUs given, a global request is held open on /dev/cpu_dma_latency; the kernel drops it
+    // when the file is closed, including on process exit.  Otherwise the per-CPU
+    // power/pm_qos_resume_latency_us values are set and restored on destruction.
+    class XPUINFO_EXPORT PMQoSLatencyGuard : public NoCopyAssign
+    {
+    public:
+        struct Params
+        {
+            UI32 maxLatencyUs = 0;
+            std::vector<UI32> cpus;             // Empty for a global (all CPUs) request
+            String sysRoot = Sysfs::kDefaultSysRoot;
+            String dmaLatencyPath = "/dev/cpu_dma_latency";
+        };
+        PMQoSLatencyGuard(const Params& params);
+        ~PMQoSLatencyGuard();
+
+        bool isActive() const { return m_bActive; }
+        bool isGlobal() const { return m_fd >= 0; }
+        UI32 getMaxLatencyUs() const { return m_maxLatencyUs; }
+        void release();
+
+    protected:
+        const UI32 m_maxLatencyUs;
+        bool m_bActive = false;
+        int m_fd = -1;
+        std::vector<std::pair<String, String>> m_prevValues; // {path, previous value}
+    };
+} // XI
+
+#ifdef _WIN32
+#pragma warning(pop)
+#endif
@@ -0,0 +1,336 @@
+// Copyright (C) 2024 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "LibXPUInfo_HostTelemetry.h"
+#include <algorithm>
+#include <cmath>
+
+namespace XI
+{
+namespace
+{
+    const double kMilliCelsius = 1000.0;
+}
+
+CPUThermalMonitor::CPUThermalMonitor(const String& sysRoot) : m_sysRoot(sysRoot)
+{
+    const String cpuDir = m_sysRoot + "/devices/system/cpu";
+    std::map<UI32, short> coreTypeOfCPU;
+    for (const auto& [coreType, cpus] : Sysfs::getCPUsByCoreType(m_sysRoot))
+    {
+        for (auto cpu : cpus)
+        {
+            coreTypeOfCPU[cpu] = coreType;
+        }
+    }
+
+    for (auto cpu : Sysfs::listIndexedEntries(cpuDir, "cpu"))
+    {
+        CPUCounters c;
+        c.cpu = cpu;
+        auto ctIt = coreTypeOfCPU.find(cpu);
+        c.coreType = (ctIt != coreTypeOfCPU.end()) ? ctIt->second : short(HybridDetect::CoreTypes::ANY);
+        auto pkg = Sysfs::readI64(cpuDir + "/cpu" + std::to_string(cpu) + "/topology/physical_package_id");
+        c.package = pkg.has_value() ? I32(pkg.value()) : -1;
+        if (readCounters(c))
+        {
+            m_CPUs.push_back(c);
+        }
+    }
+
+    const String zoneDir = m_sysRoot + "/class/thermal";
+    for (auto idx : Sysfs::listIndexedEntries(zoneDir, "thermal_zone"))
+    {
+        const String zonePath = zoneDir + "/thermal_zone" + std::to_string(idx);
+        ThermalZone z;
+        z.index = idx;
+        if (!Sysfs::readString(zonePath + "/type", z.type) || !Sysfs::exists(zonePath + "/temp"))
+        {
+            continue;
+        }
+        // Trip points are trip_point_N_type/trip_point_N_temp pairs
+        for (const auto& name : Sysfs::listEntries(zonePath, "trip_point_"))
+        {
+            const String suffix = "_type";
+            if ((name.size() <= suffix.size()) || name.compare(name.size() - suffix.size(), suffix.size(), suffix))
+            {
+                continue;
+            }
+            String tripType;
+            if (!Sysfs::readString(zonePath + "/" + name, tripType) || (tripType == "active"))
+            {
+                continue; // Active trip points are for fans, not throttling
+            }
+            const String tempName = name.substr(0, name.size() - suffix.size()) + "_temp";
+            auto tripTemp = Sysfs::readI64(zonePath + "/" + tempName);
+            if (tripTemp.has_value() && (tripTemp.value() > 0))
+            {
+                double tripC = tripTemp.value() / kMilliCelsius;
+                if (std::isnan(z.tripTempC) || (tripC < z.tripTempC))
+                {
+                    z.tripTempC = tripC;
+                }
+            }
+        }
+        m_Zones.push_back(z);
+    }
+}
+
+bool CPUThermalMonitor::readCounters(CPUCounters& c) const
+{
+    const String ttDir = m_sysRoot + "/devices/system/cpu/cpu" + std::to_string(c.cpu) + "/thermal_throttle/";
+    auto coreCount = Sysfs::readUI64(ttDir + "core_throttle_count");
+    if (!coreCount.has_value())
+    {
+        return false;
+    }
+    c.coreCount = coreCount.value();
+    c.coreTimeMs = Sysfs::readUI64(ttDir + "core_throttle_total_time_ms").value_or(0);
+    c.packageCount = Sysfs::readUI64(ttDir + "package_throttle_count").value_or(0);
+    c.packageTimeMs = Sysfs::readUI64(ttDir + "package_throttle_total_time_ms").value_or(0);
+    return true;
+}
+
+void CPUThermalMonitor::readZone(ThermalZone& z) const
+{
+    auto temp = Sysfs::readI64(m_sysRoot + "/class/thermal/thermal_zone" + std::to_string(z.index) + "/temp");
+    z.tempC = temp.has_value() ? temp.value() / kMilliCelsius : std::numeric_limits<double>::quiet_NaN();
+}
+
+const CPUThermalMonitor::Sample& CPUThermalMonitor::sample()
+{
+    Sample s;
+    TimerTick now = Timer::GetNow();
+    if (m_bHavePrev)
+    {
+        s.intervalSecs = Timer::GetSecsBetween(m_prevTime, now);
+    }
+
+    // {coreType, package} -> package deltas, since package counters repeat for every CPU in a package
+    std::map<std::pair<short, I32>, std::pair<UI64, UI64>> pkgDeltas;
+    for (auto& prev : m_CPUs)
+    {
+        CPUCounters cur = prev;
+        auto& ct = s.coreTypes[prev.coreType];
+        ++ct.numCPUs;
+        if (!readCounters(cur))
+        {
+            continue; // CPU went offline
+        }
+        if (m_bHavePrev)
+        {
+            // Counters only reset on CPU hotplug; treat a decrease as a restart from 0
+            UI64 dCount = (cur.coreCount >= prev.coreCount) ? cur.coreCount - prev.coreCount : cur.coreCount;
+            UI64 dTime = (cur.coreTimeMs >= prev.coreTimeMs) ? cur.coreTimeMs - prev.coreTimeMs : cur.coreTimeMs;
+            ct.coreThrottleEvents += dCount;
+            ct.coreThrottleTimeMs += dTime;
+            if (dCount || dTime)
+            {
+                ++ct.numThrottledCPUs;
+                s.throttledCPUs.push_back(cur.cpu);
+            }
+            auto& pd = pkgDeltas[std::make_pair(prev.coreType, prev.package)];
+            pd.first = std::max(pd.first, (cur.packageCount >= prev.packageCount) ? cur.packageCount - prev.packageCount : cur.packageCount);
+            pd.second = std::max(pd.second, (cur.packageTimeMs >= prev.packageTimeMs) ? cur.packageTimeMs - prev.packageTimeMs : cur.packageTimeMs);
+        }
+        prev = cur;
+    }
+    std::map<I32, std::pair<UI64, UI64>> packageTotals;
+    for (const auto& [key, deltas] : pkgDeltas)
+    {
+        auto& ct = s.coreTypes[key.first];
+        ct.packageThrottleEvents = std::max(ct.packageThrottleEvents, deltas.first);
+        ct.packageThrottleTimeMs = std::max(ct.packageThrottleTimeMs, deltas.second);
+        auto& pt = packageTotals[key.second];
+        pt.first = std::max(pt.first, deltas.first);
+        pt.second = std::max(pt.second, deltas.second);
+    }
+    for (const auto& pt : packageTotals)
+    {
+        s.packageThrottleEvents += pt.second.first;
+        s.packageThrottleTimeMs += pt.second.second;
+    }
+
+    for (auto z : m_Zones)
+    {
+        readZone(z);
+        if (!std::isnan(z.tempC))
+        {
+            if (std::isnan(s.maxTempC) || (z.tempC > s.maxTempC))
+            {
+                s.maxTempC = z.tempC;
+            }
+            if (!std::isnan(z.tripTempC))
+            {
+                double headroom = z.tripTempC - z.tempC;
+                if (std::isnan(s.thermalHeadroomC) || (headroom < s.thermalHeadroomC))
+                {
+                    s.thermalHeadroomC = headroom;
+                }
+            }
+        }
+        s.zones.push_back(std::move(z));
+    }
+
+    m_prevTime = now;
+    m_bHavePrev = true;
+    m_Last = std::move(s);
+    return m_Last;
+}
+
+double CPUThermalMonitor::Sample::getThrottleTimeFraction(short coreType) const
+{
+    auto it = coreTypes.find(coreType);
+    if ((it == coreTypes.end()) || !it->second.numCPUs || (intervalSecs <= 0.))
+    {
+        return 0.;
+    }
+    double frac = it->second.coreThrottleTimeMs / (1000.0 * intervalSecs * it->second.numCPUs);
+    return std::min(frac, 1.0);
+}
+
+bool CPUThermalMonitor::Sample::isThrottled(UI32 cpu) const
+{
+    return std::find(throttledCPUs.begin(), throttledCPUs.end(), cpu) != throttledCPUs.end();
+}
+
+CPUIdleMonitor::CPUIdleMonitor(const String& sysRoot) : m_sysRoot(sysRoot)
+{
+    std::map<UI32, short> coreTypeOfCPU;
+    for (const auto& [coreType, cpus] : Sysfs::getCPUsByCoreType(m_sysRoot))
+    {
+        for (auto cpu : cpus)
+        {
+            coreTypeOfCPU[cpu] = coreType;
+        }
+    }
+
+    for (auto cpu : Sysfs::listIndexedEntries(m_sysRoot + "/devices/system/cpu", "cpu"))
+    {
+        CPUStates c;
+        c.cpu = cpu;
+        auto ctIt = coreTypeOfCPU.find(cpu);
+        c.coreType = (ctIt != coreTypeOfCPU.end()) ? ctIt->second : short(HybridDetect::CoreTypes::ANY);
+        if (readStates(c, false) && c.states.size())
+        {
+            m_CPUs.push_back(c);
+        }
+    }
+}
+
+bool CPUIdleMonitor::readStates(CPUStates& c, bool bCountersOnly) const
+{
+    const String idleDir = m_sysRoot + "/devices/system/cpu/cpu" + std::to_string(c.cpu) + "/cpuidle";
+    if (!bCountersOnly)
+    {
+        c.states.clear();
+        for (auto idx : Sysfs::listIndexedEntries(idleDir, "state"))
+        {
+            const String stateDir = idleDir + "/state" + std::to_string(idx) + "/";
+            State st;
+            st.index = idx;
+            Sysfs::readString(stateDir + "name", st.name);
+            Sysfs::readString(stateDir + "desc", st.desc);
+            st.exitLatencyUs = UI32(Sysfs::readUI64(stateDir + "latency").value_or(0));
+            st.targetResidencyUs = UI32(Sysfs::readUI64(stateDir + "residency").value_or(0));
+            st.disabled = Sysfs::readUI64(stateDir + "disable").value_or(0) != 0;
+            c.states.push_back(st);
+        }
+        std::sort(c.states.begin(), c.states.end(), [](const State& a, const State& b) { return a.index < b.index; });
+    }
+    bool bOK = false;
+    for (auto& st : c.states)
+    {
+        const String stateDir = idleDir + "/state" + std::to_string(st.index) + "/";
+        auto usage = Sysfs::readUI64(stateDir + "usage");
+        auto timeUs = Sysfs::readUI64(stateDir + "time");
+        if (usage.has_value() && timeUs.has_value())
+        {
+            st.usage = usage.value();
+            st.timeUs = timeUs.value();
+            bOK = true;
+        }
+    }
+    return bOK;
+}
+
+std::vector<CPUIdleMonitor::CPUStates> CPUIdleMonitor::getStates() const
+{
+    std::vector<CPUStates> cur;
+    for (const auto& prev : m_CPUs)
+    {
+        CPUStates c = prev;
+        if (readStates(c, false))
+        {
+            cur.push_back(std::move(c));
+        }
+    }
+    return cur;
+}
+
+const CPUIdleMonitor::Sample& CPUIdleMonitor::sample()
+{
+    Sample s;
+    TimerTick now = Timer::GetNow();
+    if (m_bHavePrev)
+    {
+        s.intervalSecs = Timer::GetSecsBetween(m_prevTime, now);
+    }
+    const double intervalUs = s.intervalSecs * 1e6;
+
+    for (auto& prev : m_CPUs)
+    {
+        CPUStates cur = prev;
+        if (!readStates(cur, true))
+        {
+            continue; // CPU went offline
+        }
+        auto& ct = s.coreTypes[prev.coreType];
+        ++ct.numCPUs;
+        if (m_bHavePrev && (intervalUs > 0.))
+        {
+            double deepestFrac = 0.;
+            double cpuIdleFrac = 0.;
+            for (size_t i = 0; i < cur.states.size(); ++i)
+            {
+                const auto& st = cur.states[i];
+                // Counters reset when a state is re-enabled or the CPU is re-onlined
+                UI64 dTime = (st.timeUs >= prev.states[i].timeUs) ? st.timeUs - prev.states[i].timeUs : st.timeUs;
+                UI64 dUsage = (st.usage >= prev.states[i].usage) ? st.usage - prev.states[i].usage : st.usage;
+                double frac = std::min(dTime / intervalUs, 1.0);
+                ct.idleFraction += frac;
+                cpuIdleFrac += frac;
+                ct.stateFractions[st.name] += frac;
+                ct.wakeups += dUsage;
+                if (!st.disabled)
+                {
+                    deepestFrac = frac; // States are sorted shallow to deep
+                }
+            }
+            ct.deepestFraction += deepestFrac;
+            cpuIdleFrac = std::min(cpuIdleFrac, 1.0);
+            ct.minIdleFraction = (ct.numCPUs == 1) ? cpuIdleFrac : std::min(ct.minIdleFraction, cpuIdleFrac);
+        }
+        prev = std::move(cur);
+    }
+    // Sums over CPUs to averages
+    for (auto& [coreType, ct] : s.coreTypes)
+    {
+        if (ct.numCPUs)
+        {
+            ct.idleFraction = std::min(ct.idleFraction / ct.numCPUs, 1.0);
+            ct.deepestFraction /= ct.numCPUs;
+            for (auto& sf : ct.stateFractions)
+            {
+                sf.second /= ct.numCPUs;
+            }
+        }
+    }
+
+    m_prevTime = now;
+    m_bHavePrev = true;
+    m_Last = std::move(s);
+    return m_Last;
+}
+
+} // XI
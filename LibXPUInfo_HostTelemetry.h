@@ -0,0 +1,155 @@
+// Copyright (C) 2024 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+// Host-side (CPU/platform) telemetry sources.
+//
+// These read Linux sysfs, relative to a caller-provided root so they can be exercised against a
+// fixture directory tree.  On other OSs (or when the files are missing) isSupported() returns false.
+// Each source can be used standalone, and TelemetryTracker records a summary of each as columns.
+
+#pragma once
+#include "LibXPUInfo.h"
+#include "LibXPUInfo_Util.h"
+
+#ifdef _WIN32
+#pragma warning(push)
+#pragma warning(disable : 4251)
+#endif
+
+namespace XI
+{
+    // CPU thermal throttling (thermal_throttle counters) and thermal zones (class/thermal)
+    class XPUINFO_EXPORT CPUThermalMonitor : public NoCopyAssign
+    {
+    public:
+        CPUThermalMonitor(const String& sysRoot = Sysfs::kDefaultSysRoot);
+
+        bool isSupported() const { return m_CPUs.size() || m_Zones.size(); }
+        bool hasThrottleCounters() const { return m_CPUs.size() > 0; }
+
+        struct ThermalZone
+        {
+            UI32 index = 0;         // N in thermal_zoneN
+            String type;            // i.e. "x86_pkg_temp", "acpitz"
+            double tempC = 0.;
+            double tripTempC = std::numeric_limits<double>::quiet_NaN(); // Lowest passive/hot/critical trip point
+        };
+
+        // Deltas since previous sample, summed over the CPUs of one core type
+        struct CoreTypeThrottle
+        {
+            UI32 numCPUs = 0;
+            UI32 numThrottledCPUs = 0;      // CPUs with core throttle events during the interval
+            UI64 coreThrottleEvents = 0;
+            UI64 coreThrottleTimeMs = 0;
+            // Package counters are shared by all CPUs of a package, so these are the max over packages
+            // containing CPUs of this type rather than a sum.
+            UI64 packageThrottleEvents = 0;
+            UI64 packageThrottleTimeMs = 0;
+        };
+
+        struct Sample
+        {
+            double intervalSecs = 0.;       // 0 for first sample, which has no deltas
+            std::map<short, CoreTypeThrottle> coreTypes; // Keyed by HybridDetect::CoreTypes
+            std::vector<UI32> throttledCPUs;
+            std::vector<ThermalZone> zones;
+            double maxTempC = std::numeric_limits<double>::quiet_NaN();
+            // Min over zones of (trip point - temperature).  NaN if no zone has a trip point.
+            // Small or negative values indicate CPUs that should be deprioritized.
+            double thermalHeadroomC = std::numeric_limits<double>::quiet_NaN();
+            // Package counter deltas summed over packages, each counted once
+            UI64 packageThrottleEvents = 0;
+            UI64 packageThrottleTimeMs = 0;
+
+            // Fraction [0,1] of the interval the CPUs of coreType spent throttled (averaged over CPUs)
+            double getThrottleTimeFraction(short coreType) const;
+            bool isThrottled(UI32 cpu) const;
+        };
+
+        // Read current counters, returning deltas versus the previous call
+        const Sample& sample();
+        const Sample& getLastSample() const { return m_Last; }
+        const String& getSysRoot() const { return m_sysRoot; }
+
+    protected:
+        struct CPUCounters
+        {
+            UI32 cpu = 0;
+            short coreType = 0;
+            I32 package = -1;
+            UI64 coreCount = 0, coreTimeMs = 0;
+            UI64 packageCount = 0, packageTimeMs = 0;
+        };
+        bool readCounters(CPUCounters& c) const;
+        void readZone(ThermalZone& z) const;
+
+        const String m_sysRoot;
+        std::vector<CPUCounters> m_CPUs;    // Previous counter values
+        std::vector<ThermalZone> m_Zones;
+        TimerTick m_prevTime{};
+        bool m_bHavePrev = false;
+        Sample m_Last;
+    };
+
+    // cpuidle (C-state) states and residency, from devices/system/cpu/cpuN/cpuidle/stateK
+    class XPUINFO_EXPORT CPUIdleMonitor : public NoCopyAssign
+    {
+    public:
+        CPUIdleMonitor(const String& sysRoot = Sysfs::kDefaultSysRoot);
+
+        bool isSupported() const { return m_CPUs.size() > 0; }
+
+        struct State
+        {
+            UI32 index = 0;             // K in stateK; higher is deeper
+            String name;                // i.e. "POLL", "C1E", "C6"
+            String desc;
+            UI32 exitLatencyUs = 0;
+            UI32 targetResidencyUs = 0;
+            bool disabled = false;
+            UI64 usage = 0;             // Number of entries (cumulative)
+            UI64 timeUs = 0;            // Time spent in state (cumulative)
+        };
+        struct CPUStates
+        {
+            UI32 cpu = 0;
+            short coreType = 0;         // HybridDetect::CoreTypes
+            std::vector<State> states;
+        };
+        // Current state info and cumulative counters for each CPU with cpuidle
+        std::vector<CPUStates> getStates() const;
+        const String& getSysRoot() const { return m_sysRoot; }
+
+        // Deltas since previous sample, averaged over the CPUs of one core type
+        struct CoreTypeResidency
+        {
+            UI32 numCPUs = 0;
+            double idleFraction = 0.;           // Time in any idle state
+            double minIdleFraction = 0.;        // Of the least idle (busiest) CPU
+            double deepestFraction = 0.;        // Time in each CPU's deepest enabled state
+            std::map<String, double> stateFractions; // By state name
+            UI64 wakeups = 0;                   // Sum of state entries over CPUs
+        };
+        struct Sample
+        {
+            double intervalSecs = 0.;           // 0 for first sample, which has no deltas
+            std::map<short, CoreTypeResidency> coreTypes;
+        };
+        const Sample& sample();
+        const Sample& getLastSample() const { return m_Last; }
+
+    protected:
+        bool readStates(CPUStates& c, bool bCountersOnly) const;
+
+        const String m_sysRoot;
+        std::vector<CPUStates> m_CPUs;      // Previous counter values
+        TimerTick m_prevTime{};
+        bool m_bHavePrev = false;
+        Sample m_Last;
+    };
+} // XI
+
+#ifdef _WIN32
+#pragma warning(pop)
+#endif
@@ -1040,7 +1040,10 @@ bool TelemetryTracker::RecordIGCL(TimedRecord& rec)
 
 	ctl_power_telemetry_t pPowerTelemetry = {};
 	pPowerTelemetry.Size = sizeof(ctl_power_telemetry_t);
+	// Bracket the device timestamp with host clock readings for clock correlation
+	const UI64 hostBeforeNs = getCurrentHostTimeNs();
 	ctl_result_t status = ctlPowerTelemetryGet(hIGCL, &pPowerTelemetry);
+	const UI64 hostAfterNs = getCurrentHostTimeNs();
 	TelemetryItem resultMask = TelemetryItem(m_ResultMask | TELEMETRYITEM_TIMESTAMP_DOUBLE);
 
 	if (status == ctl_result_t::CTL_RESULT_SUCCESS)
@@ -1050,6 +1053,7 @@ bool TelemetryTracker::RecordIGCL(TimedRecord& rec)
 		XPUINFO_DEBUG_REQUIRE(CTL_UNITS_TIME_SECONDS == pPowerTelemetry.timeStamp.units);
 		XPUINFO_DEBUG_REQUIRE(CTL_DATA_TYPE_DOUBLE == pPowerTelemetry.timeStamp.type);
 		rec.timeStamp = pPowerTelemetry.timeStamp.value.datadouble;
+		correlateClock(rec.timeStamp, hostBeforeNs, hostAfterNs);
 		bUpdate = true;
 
 		if (pPowerTelemetry.gpuCurrentClockFrequency.bSupported)
@@ -1092,6 +1096,14 @@ bool TelemetryTracker::RecordIGCL(TimedRecord& rec)
 			resultMask = (TelemetryItem)(resultMask | TELEMETRYITEM_MEDIA_ACTIVITY);
 		}
 
+		if (pPowerTelemetry.gpuEnergyCounter.bSupported)
+		{
+			XPUINFO_DEBUG_REQUIRE(CTL_UNITS_ENERGY_JOULES == pPowerTelemetry.gpuEnergyCounter.units);
+			XPUINFO_DEBUG_REQUIRE(CTL_DATA_TYPE_DOUBLE == pPowerTelemetry.gpuEnergyCounter.type);
+			rec.deviceEnergyJ = pPowerTelemetry.gpuEnergyCounter.value.datadouble;
+			resultMask = (TelemetryItem)(resultMask | TELEMETRYITEM_DEVICE_ENERGY);
+		}
+
 		if (m_IGCL_MemFreqHandle)
 		{
 			ctl_freq_state_t freqState = { 0 };
@@ -4,6 +4,17 @@
 // Utility code for using XPUInfo out-of-process
 #ifdef XPUINFO_USE_IPC
 #include "LibXPUInfo_IPC.h"
+#include "LibXPUInfo_Util.h"
+#include <iomanip>
+#ifndef _WIN32
+#include <cerrno>
+#include <csignal>
+#include <ctime>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 #define OPEN_FILE_MAPPING_ERROR     ((DWORD)0xC00007D0L)
 #define UNABLE_MAP_VIEW_OF_FILE     ((DWORD)0xC00007D1L)
 
@@ -233,6 +244,479 @@ bool NamedPipe::Disconnect()
 }
 
 } // Win
+#else
+namespace Posix
+{
+
+NamedSharedMemory::NamedSharedMemory(size_t size, const char* sharedName, bool bReadOnlyAccess) :
+    m_Size(size)
+{
+    const String name = (sharedName[0] == '/') ? String(sharedName) : String("/") + sharedName;
+    m_fd = shm_open(name.c_str(), (bReadOnlyAccess ? O_RDONLY : (O_RDWR | O_CREAT)) | O_CLOEXEC, 0666);
+    if (m_fd < 0)
+    {
+        m_Status = errno;
+        return;
+    }
+    struct stat st{};
+    if (fstat(m_fd, &st) != 0)
+    {
+        m_Status = errno;
+        return;
+    }
+    if (size_t(st.st_size) < size)
+    {
+        // ftruncate zero-fills.  Racing openers extend to the same size, which is harmless.
+        if (bReadOnlyAccess || (ftruncate(m_fd, (off_t)size) != 0))
+        {
+            m_Status = bReadOnlyAccess ? EINVAL : errno;
+            return;
+        }
+    }
+    void* pMem = mmap(nullptr, size, bReadOnlyAccess ? PROT_READ : (PROT_READ | PROT_WRITE), MAP_SHARED, m_fd, 0);
+    if (pMem == MAP_FAILED)
+    {
+        m_Status = errno;
+        return;
+    }
+    m_pMappedMemory = pMem;
+    m_Status = 0;
+}
+
+NamedSharedMemory::~NamedSharedMemory()
+{
+    if (m_pMappedMemory)
+    {
+        XPUINFO_REQUIRE(munmap(m_pMappedMemory, m_Size) == 0);
+    }
+    if (m_fd >= 0)
+    {
+        close(m_fd);
+    }
+}
+
+bool NamedSharedMemory::remove(const char* sharedName)
+{
+    const String name = (sharedName[0] == '/') ? String(sharedName) : String("/") + sharedName;
+    return shm_unlink(name.c_str()) == 0;
+}
+
+} // Posix
+#endif // _WIN32
+
+namespace
+{
+    const UI32 kLedgerVersion = 2;
+    const UI32 kLedgerUninitialized = 0;
+    const UI32 kLedgerInitializing = 1;
+    const UI32 kLedgerReady = 2;
+    const UI64 kSlotFree = 0;
+    static_assert(std::atomic<UI64>::is_always_lock_free, "Ledger requires lock-free 64-bit atomics");
+
+    // A slot being claimed, renewed or freed holds the PID of that process in the upper half and 0 in
+    // the lower half, which is never the case for a LeaseID, so a holder that dies can be detected.
+    UI64 getBusyState(UI32 pid) { return UI64(pid) << 32; }
+    bool isBusyState(UI64 state) { return (state != kSlotFree) && !(state & 0xffffffffu); }
+    UI32 getBusyPID(UI64 state) { return UI32(state >> 32); }
+}
+
+// Shared memory layout: Header, then maxLeases Slots.  Zero-filled memory is an uninitialized ledger.
+struct alignas(64) DeviceMemoryLedger::Header
+{
+    std::atomic<UI32> initState;
+    UI32 version;
+    UI32 maxLeases;
+    std::atomic<UI32> generation;   // Upper half of LeaseIDs, so a reused slot gets a new ID
+    std::atomic<UI64> budget;
+    std::atomic<UI64> reserved;
+    std::atomic<UI32> initPID;      // Process initializing the ledger, so another can take over if it died
+    std::atomic<UI64> opCount;      // Bumped by each change to reserved, before its slot is published or freed
+    std::atomic<UI32> numUnreconciled; // Slots freed from dead processes since reserved was last reconciled
+};
+
+struct alignas(64) DeviceMemoryLedger::Slot
+{
+    std::atomic<UI64> state;        // kSlotFree, busy (see getBusyState()), or LeaseID of owner
+    std::atomic<UI64> bytes;
+    std::atomic<UI64> expiryMs;     // getTimeMs() value, 0 for no expiry
+    std::atomic<UI32> pid;
+};
+
+UI64 DeviceMemoryLedger::getTimeMs()
+{
+#ifdef _WIN32
+    return GetTickCount64();
+#else
+    timespec ts{};
+    clock_gettime(CLOCK_MONOTONIC, &ts); // Since boot, so comparable across processes
+    return UI64(ts.tv_sec) * 1000ULL + UI64(ts.tv_nsec) / 1000000ULL;
+#endif
+}
+
+UI32 DeviceMemoryLedger::getCurrentProcessID()
+{
+#ifdef _WIN32
+    return GetCurrentProcessId();
+#else
+    return UI32(getpid());
 #endif
+}
+
+bool DeviceMemoryLedger::isProcessAlive(UI32 pid)
+{
+#ifdef _WIN32
+    HANDLE hProcess = OpenProcess(SYNCHRONIZE | PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid);
+    if (!hProcess)
+    {
+        return GetLastError() != ERROR_INVALID_PARAMETER; // Access denied means it exists
+    }
+    bool bAlive = WaitForSingleObject(hProcess, 0) == WAIT_TIMEOUT;
+    CloseHandle(hProcess);
+    return bAlive;
+#else
+    return (kill(pid_t(pid), 0) == 0) || (errno == EPERM);
+#endif
+}
+
+String DeviceMemoryLedger::getLedgerName(const DevicePtr& device)
+{
+    XPUINFO_REQUIRE(device);
+    std::ostringstream ostr;
+    ostr << "XPUInfoMemLedger_" << std::hex << std::setw(16) << std::setfill('0') << device->getLUID();
+    return ostr.str();
+}
+
+DeviceMemoryLedger::DeviceMemoryLedger(const DevicePtr& device, UI64 budgetBytes, UI32 maxLeases) :
+    m_name(getLedgerName(device))
+{
+    if (!budgetBytes)
+    {
+        budgetBytes = device->getMemUsage().budget;
+        if (!budgetBytes && (device->getProperties().DedicatedMemorySize != UI64(-1)))
+        {
+            budgetBytes = device->getProperties().DedicatedMemorySize;
+        }
+    }
+    open(budgetBytes, maxLeases);
+}
+
+DeviceMemoryLedger::DeviceMemoryLedger(const String& name, UI64 budgetBytes, UI32 maxLeases) :
+    m_name(name)
+{
+    open(budgetBytes, maxLeases);
+}
+
+DeviceMemoryLedger::~DeviceMemoryLedger()
+{
+    // Leases outlive this object; they are released explicitly, by expiry, or when the process exits.
+}
+
+void DeviceMemoryLedger::open(UI64 budgetBytes, UI32 maxLeases)
+{
+    XPUINFO_REQUIRE_MSG(maxLeases && (maxLeases < 0xffffffffu), "Invalid number of leases");
+    const size_t size = sizeof(Header) + size_t(maxLeases) * sizeof(Slot);
+#ifdef _WIN32
+    m_pShm.reset(new Win::NamedSharedMemory(size, m_name.c_str()));
+#else
+    m_pShm.reset(new Posix::NamedSharedMemory(size, m_name.c_str()));
+#endif
+    XPUINFO_REQUIRE_MSG(m_pShm->getStatus() == 0, "Unable to open device memory ledger");
+    m_pHeader = reinterpret_cast<Header*>(m_pShm->getSharedMemPtr());
+    m_pSlots = reinterpret_cast<Slot*>(m_pHeader + 1);
+
+    const UI32 pid = getCurrentProcessID();
+    auto initialize = [&]()
+    {
+        m_pHeader->version = kLedgerVersion;
+        m_pHeader->maxLeases = maxLeases;
+        m_pHeader->budget = budgetBytes;
+        m_pHeader->initState.store(kLedgerReady, std::memory_order_release);
+    };
+    UI32 initState = kLedgerUninitialized;
+    if (m_pHeader->initState.compare_exchange_strong(initState, kLedgerInitializing))
+    {
+        m_pHeader->initPID.store(pid);
+        initialize();
+    }
+    else
+    {
+        // Another process is initializing.  If it died doing so, the first waiter to notice takes over.
+        UI64 timeoutMs = getTimeMs() + 1000;
+        while (m_pHeader->initState.load(std::memory_order_acquire) != kLedgerReady)
+        {
+            if (getTimeMs() >= timeoutMs)
+            {
+                UI32 initPID = m_pHeader->initPID.load();
+                XPUINFO_REQUIRE_MSG(!initPID || !isProcessAlive(initPID), "Timed out waiting for device memory ledger initialization");
+                if (m_pHeader->initPID.compare_exchange_strong(initPID, pid))
+                {
+                    initialize();
+                    break;
+                }
+                timeoutMs = getTimeMs() + 1000;
+            }
+            std::this_thread::yield();
+        }
+    }
+    XPUINFO_REQUIRE_MSG(m_pHeader->version == kLedgerVersion, "Device memory ledger version mismatch");
+    XPUINFO_REQUIRE_MSG(m_pHeader->maxLeases == maxLeases, "Device memory ledger opened with a different number of leases");
+    m_maxLeases = maxLeases;
+}
+
+DeviceMemoryLedger::Slot* DeviceMemoryLedger::getSlot(LeaseID lease) const
+{
+    const UI32 index = UI32(lease & 0xffffffffu);
+    if (!index || (index > m_maxLeases))
+    {
+        return nullptr;
+    }
+    return &m_pSlots[index - 1];
+}
+
+bool DeviceMemoryLedger::freeSlot(Slot& slot, UI64 expectedState)
+{
+    if (!slot.state.compare_exchange_strong(expectedState, getBusyState(getCurrentProcessID()), std::memory_order_acquire))
+    {
+        return false;
+    }
+    m_pHeader->reserved.fetch_sub(slot.bytes.load(std::memory_order_relaxed));
+    m_pHeader->opCount.fetch_add(1);
+    slot.state.store(kSlotFree, std::memory_order_release);
+    return true;
+}
+
+DeviceMemoryLedger::Slot* DeviceMemoryLedger::claimSlot()
+{
+    // Start the search at a per-process offset to spread contention
+    const UI32 pid = getCurrentProcessID();
+    const UI64 busy = getBusyState(pid);
+    for (UI32 i = 0; i < m_maxLeases; ++i)
+    {
+        Slot& slot = m_pSlots[(pid + i) % m_maxLeases];
+        UI64 expected = kSlotFree;
+        if ((slot.state.load(std::memory_order_relaxed) == kSlotFree) &&
+            slot.state.compare_exchange_strong(expected, busy, std::memory_order_acquire))
+        {
+            return &slot;
+        }
+    }
+    return nullptr;
+}
+
+bool DeviceMemoryLedger::addReserved(UI64 bytes)
+{
+    UI64 cur = m_pHeader->reserved.load();
+    for (;;)
+    {
+        const UI64 budget = m_pHeader->budget.load();
+        if ((bytes > budget) || (cur > budget - bytes))
+        {
+            return false;
+        }
+        if (m_pHeader->reserved.compare_exchange_weak(cur, cur + bytes))
+        {
+            m_pHeader->opCount.fetch_add(1); // See reconcile()
+            return true;
+        }
+    }
+}
+
+DeviceMemoryLedger::LeaseID DeviceMemoryLedger::reserve(UI64 bytes, UI32 leaseMs)
+{
+    XPUINFO_REQUIRE(bytes);
+    // The slot is claimed before reserved is increased, so reserved never includes bytes that no slot
+    // accounts for (see reclaimExpired()).  If full, retry once after reclaiming.
+    for (UI32 attempt = 0; attempt < 2; ++attempt)
+    {
+        if (attempt)
+        {
+            reclaimExpired();
+        }
+        Slot* pSlot = claimSlot();
+        if (!pSlot)
+        {
+            continue;
+        }
+        pSlot->pid.store(getCurrentProcessID(), std::memory_order_relaxed);
+        pSlot->bytes.store(bytes, std::memory_order_relaxed);
+        if (!addReserved(bytes))
+        {
+            pSlot->state.store(kSlotFree, std::memory_order_release);
+            continue;
+        }
+        pSlot->expiryMs.store(leaseMs ? getTimeMs() + leaseMs : 0, std::memory_order_relaxed);
+        UI32 gen = m_pHeader->generation.fetch_add(1) + 1;
+        if (!gen)
+        {
+            gen = m_pHeader->generation.fetch_add(1) + 1;
+        }
+        const LeaseID lease = (UI64(gen) << 32) | UI64(pSlot - m_pSlots + 1);
+        pSlot->state.store(lease, std::memory_order_release);
+        return lease;
+    }
+    return 0;
+}
+
+bool DeviceMemoryLedger::release(LeaseID lease)
+{
+    Slot* pSlot = getSlot(lease);
+    return pSlot && freeSlot(*pSlot, lease);
+}
+
+bool DeviceMemoryLedger::renew(LeaseID lease, UI32 leaseMs)
+{
+    Slot* pSlot = getSlot(lease);
+    if (!pSlot)
+    {
+        return false;
+    }
+    // Hold the slot while updating, so a concurrent reclaim can't free it and have the new owner's expiry overwritten
+    UI64 expected = lease;
+    if (!pSlot->state.compare_exchange_strong(expected, getBusyState(getCurrentProcessID()), std::memory_order_acquire))
+    {
+        return false;
+    }
+    pSlot->expiryMs.store(leaseMs ? getTimeMs() + leaseMs : 0, std::memory_order_relaxed);
+    pSlot->state.store(lease, std::memory_order_release);
+    return true;
+}
+
+UI32 DeviceMemoryLedger::reclaimExpired()
+{
+    UI32 numReclaimed = 0;
+    const UI64 now = getTimeMs();
+    for (UI32 i = 0; i < m_maxLeases; ++i)
+    {
+        Slot& slot = m_pSlots[i];
+        UI64 state = slot.state.load(std::memory_order_acquire);
+        if (state == kSlotFree)
+        {
+            continue;
+        }
+        if (isBusyState(state))
+        {
+            // Holder died mid-operation, so reserved may or may not include the slot; see reconcile()
+            if (!isProcessAlive(getBusyPID(state)) && slot.state.compare_exchange_strong(state, kSlotFree))
+            {
+                m_pHeader->numUnreconciled.fetch_add(1);
+                ++numReclaimed;
+            }
+            continue;
+        }
+        // Values may belong to a newer lease by now; freeSlot() then fails as the state (LeaseID) differs
+        const UI64 expiry = slot.expiryMs.load(std::memory_order_relaxed);
+        const bool bExpired = expiry && (expiry <= now);
+        if ((bExpired || !isProcessAlive(slot.pid.load(std::memory_order_relaxed))) && freeSlot(slot, state))
+        {
+            ++numReclaimed;
+        }
+    }
+
+    reconcile();
+    return numReclaimed;
+}
+
+void DeviceMemoryLedger::reconcile()
+{
+    // Only needed after freeing a slot of a process that died mid-operation, by this or another process
+    UI32 numUnreconciled = m_pHeader->numUnreconciled.load();
+    if (!numUnreconciled)
+    {
+        return;
+    }
+    // The scan is a consistent snapshot only if no reserve or release changed reserved during it.  Each
+    // bumps opCount after changing reserved and before its slot state changes, so a scan that saw either
+    // also sees opCount change.  Operations in progress hold a busy slot.
+    const UI64 opCount = m_pHeader->opCount.load();
+    UI64 reserved = m_pHeader->reserved.load();
+    UI64 leased = 0;
+    for (UI32 i = 0; i < m_maxLeases; ++i)
+    {
+        const UI64 state = m_pSlots[i].state.load(std::memory_order_acquire);
+        if (isBusyState(state))
+        {
+            return;
+        }
+        if (state != kSlotFree)
+        {
+            leased += m_pSlots[i].bytes.load(std::memory_order_relaxed);
+        }
+    }
+    // Retried by a later reclaimExpired() if this fails
+    if ((m_pHeader->opCount.load() == opCount) && m_pHeader->reserved.compare_exchange_strong(reserved, leased))
+    {
+        m_pHeader->numUnreconciled.compare_exchange_strong(numUnreconciled, 0);
+    }
+}
+
+UI64 DeviceMemoryLedger::getBudget() const
+{
+    return m_pHeader->budget.load();
+}
+
+void DeviceMemoryLedger::setBudget(UI64 budgetBytes)
+{
+    m_pHeader->budget.store(budgetBytes);
+}
+
+UI64 DeviceMemoryLedger::getReserved() const
+{
+    return m_pHeader->reserved.load();
+}
+
+UI64 DeviceMemoryLedger::getAvailable() const
+{
+    const UI64 budget = getBudget();
+    const UI64 reserved = getReserved();
+    return (budget > reserved) ? budget - reserved : 0;
+}
+
+std::vector<DeviceMemoryLedger::LeaseInfo> DeviceMemoryLedger::getLeases() const
+{
+    std::vector<LeaseInfo> leases;
+    const UI64 now = getTimeMs();
+    for (UI32 i = 0; i < m_maxLeases; ++i)
+    {
+        const Slot& slot = m_pSlots[i];
+        const UI64 state = slot.state.load(std::memory_order_acquire);
+        if ((state == kSlotFree) || isBusyState(state))
+        {
+            continue;
+        }
+        LeaseInfo info;
+        info.id = state;
+        info.pid = slot.pid.load(std::memory_order_relaxed);
+        info.bytes = slot.bytes.load(std::memory_order_relaxed);
+        const UI64 expiry = slot.expiryMs.load(std::memory_order_relaxed);
+        if (expiry)
+        {
+            info.remainingMs = (expiry > now) ? I64(expiry - now) : 0;
+        }
+        if (slot.state.load(std::memory_order_acquire) == state) // Skip if changed while reading
+        {
+            leases.push_back(info);
+        }
+    }
+    return leases;
+}
+
+void DeviceMemoryLedger::printInfo(std::ostream& ostr) const
+{
+    const double kMB = 1024. * 1024.;
+    SaveRestoreIOSFlags sr(ostr);
+    ostr << "Device memory ledger " << m_name << ": budget " << std::fixed << std::setprecision(1)
+        << getBudget() / kMB << " MB, reserved " << getReserved() / kMB << " MB" << std::endl;
+    for (const auto& lease : getLeases())
+    {
+        ostr << "\tLease 0x" << std::hex << lease.id << std::dec << ": pid " << lease.pid << ", "
+            << lease.bytes / kMB << " MB";
+        if (lease.remainingMs >= 0)
+        {
+            ostr << ", expires in " << lease.remainingMs << " ms";
+        }
+        ostr << std::endl;
+    }
+}
 } // XI
 #endif //XPUINFO_USE_IPC
+
@@ -11,6 +11,7 @@
 #pragma once
 #ifdef XPUINFO_USE_IPC
 #include "LibXPUInfo.h"
+#include <atomic>
 #ifdef _WIN32
 #include <Windows.h>
 #endif
@@ -207,7 +208,125 @@ namespace Win
         std::unique_ptr<NamedMutex::ScopedLock> m_pLock;
     };
 } // Win
+#else
+namespace Posix
+{
+    // POSIX (shm_open) counterpart of Win::NamedSharedMemory.  New memory is zero-filled.
+    // The object persists until remove() is called or the system restarts.
+    class XPUINFO_EXPORT NamedSharedMemory : public NoCopyAssign
+    {
+    public:
+        NamedSharedMemory(size_t size, const char* sharedName, bool bReadOnlyAccess = false);
+        ~NamedSharedMemory();
+
+        UI32 getStatus() const { return m_Status; } // 0 on success, else errno
+        void* getSharedMemPtr() {
+            XPUINFO_REQUIRE(m_pMappedMemory);
+            return m_pMappedMemory;
+        }
+        size_t size() const { return m_Size; }
+        static bool remove(const char* sharedName);
+
+    protected:
+        const size_t m_Size;
+        int m_fd = -1;
+        void* m_pMappedMemory = nullptr;
+        UI32 m_Status = UI32(-1);
+    };
+} // Posix
 #endif // _WIN32
+
+    // Cross-process ledger of device memory reservations against a budget, kept in named shared
+    // memory so co-located processes sharing a device coordinate without a central service.
+    // Reserve, release and renew are lock-free (atomics on the shared memory).  Leases may expire,
+    // and leases of processes that have exited are reclaimed, so a crashed holder does not leak
+    // its reservation.  A process that dies mid-operation (including while creating the ledger) is
+    // recovered from as well.  Process IDs must be from the same PID namespace.
+    class XPUINFO_EXPORT DeviceMemoryLedger : public NoCopyAssign
+    {
+    public:
+        static const UI32 kDefaultMaxLeases = 256;
+        typedef UI64 LeaseID;                   // 0 is not a valid lease
+
+        // Ledger of device (named by LUID).  budgetBytes 0 uses getMemUsage().budget when creating the
+        // ledger; an existing ledger keeps its budget.
+        DeviceMemoryLedger(const DevicePtr& device, UI64 budgetBytes = 0, UI32 maxLeases = kDefaultMaxLeases);
+        DeviceMemoryLedger(const String& name, UI64 budgetBytes, UI32 maxLeases = kDefaultMaxLeases);
+        ~DeviceMemoryLedger();
+
+        // Returns 0 if bytes would exceed the budget, even after reclaiming expired leases, or if all
+        // lease slots are in use.  leaseMs 0 never expires (until the owning process exits).
+        LeaseID reserve(UI64 bytes, UI32 leaseMs = 0);
+        // False if the lease was already released or reclaimed
+        bool release(LeaseID lease);
+        // Extend lease to leaseMs from now.  False if the lease has already been reclaimed.
+        bool renew(LeaseID lease, UI32 leaseMs);
+        // Release expired leases and those of processes that have exited, and slots left busy by such
+        // processes.  Bytes of operations interrupted that way are recovered by resetting getReserved()
+        // to the sum of leases, once a scan of the slots is not concurrent with any reserve or release.
+        // Returns number of slots reclaimed.
+        UI32 reclaimExpired();
+
+        UI64 getBudget() const;
+        void setBudget(UI64 budgetBytes);       // May be set below current reservations
+        UI64 getReserved() const;
+        UI64 getAvailable() const;
+        UI32 getMaxLeases() const { return m_maxLeases; }
+        const String& getName() const { return m_name; }
+
+        struct LeaseInfo
+        {
+            LeaseID id = 0;
+            UI32 pid = 0;
+            UI64 bytes = 0;
+            I64 remainingMs = -1;               // -1 if no expiry
+        };
+        std::vector<LeaseInfo> getLeases() const;
+        void printInfo(std::ostream& ostr) const;
+
+        static String getLedgerName(const DevicePtr& device);
+        static UI64 getTimeMs();                // System-wide monotonic clock used for lease expiry
+        static UI32 getCurrentProcessID();
+        static bool isProcessAlive(UI32 pid);
+
+        // Reservation released on destruction
+        class ScopedReservation : public NoCopyAssign
+        {
+        public:
+            ScopedReservation(DeviceMemoryLedger& ledger, UI64 bytes, UI32 leaseMs = 0) :
+                m_Ledger(ledger), m_Lease(ledger.reserve(bytes, leaseMs)) {}
+            ~ScopedReservation() { if (m_Lease) m_Ledger.release(m_Lease); }
+            bool isValid() const { return m_Lease != 0; }
+            LeaseID getLease() const { return m_Lease; }
+        protected:
+            DeviceMemoryLedger& m_Ledger;
+            const LeaseID m_Lease;
+        };
+
+    protected:
+        struct Header;
+        struct Slot;
+        void open(UI64 budgetBytes, UI32 maxLeases);
+        Slot* getSlot(LeaseID lease) const;
+        // Free slot, marked busy by this process
+        Slot* claimSlot();
+        // False if bytes would exceed the budget
+        bool addReserved(UI64 bytes);
+        // Reset reserved to the sum of leases after slots of dead processes were freed
+        void reconcile();
+        // Takes ownership of slot from expectedState and returns its bytes to the budget
+        bool freeSlot(Slot& slot, UI64 expectedState);
+
+        const String m_name;
+        UI32 m_maxLeases = 0;
+#ifdef _WIN32
+        std::unique_ptr<Win::NamedSharedMemory> m_pShm;
+#else
+        std::unique_ptr<Posix::NamedSharedMemory> m_pShm;
+#endif
+        Header* m_pHeader = nullptr;
+        Slot* m_pSlots = nullptr;
+    };
 } // XI
 
 #pragma warning(pop)
@@ -130,6 +130,7 @@ XPUInfoPtr XPUInfo::deserialize(const rapidjson::Document& val)
         }
     }
 #endif
+    xiPtr->buildDeviceSummaries();
     return xiPtr;
 }
 
@@ -289,6 +290,19 @@ rapidjson::Value Device::serialize(AllocatorType& a)
     curDev.AddMember("ComputeUnits", getProperties().NumComputeUnits, a);
     curDev.AddMember("ComputeUnitsSIMDWidth", getProperties().ComputeUnitSIMDWidth, a);
     curDev.AddMember("PackageTDP", getProperties().PackageTDP, a);
+    // Derived from the properties above, so not read back by deserialize()
+    auto peak = getPeakThroughput();
+    if (peak.isValid())
+    {
+        rapidjson::Value peakVal(rapidjson::kObjectType);
+        peakVal.AddMember("FP32", peak.FP32, a);
+        peakVal.AddMember("FP16", peak.FP16, a);
+        peakVal.AddMember("BF16", peak.BF16, a);
+        peakVal.AddMember("INT8", peak.INT8, a);
+        peakVal.AddMember("UsesMatrixEngine", peak.UsesMatrixEngine, a);
+        peakVal.AddMember("RidgePointFP32", peak.getRidgePoint(), a);
+        curDev.AddMember("PeakThroughput", peakVal, a);
+    }
 
     curDev.AddMember("validAPIs", getCurrentAPIs(), a);
     curDev.AddMember("UMA", getProperties().UMA, a);
@@ -538,8 +552,8 @@ bool Device::operator==(const Device& dev) const
 	if ((m_type == dev.m_type)
 		&& (m_adapterIndex == dev.m_adapterIndex)
 		&& (validAPIs == (dev.validAPIs & ~API_TYPE_DESERIALIZED))
-		&& (m_pDriverVersion && dev.m_pDriverVersion && 
-			(m_pDriverVersion->GetAsUI64()==dev.m_pDriverVersion->GetAsUI64()))
+		&& (m_DriverVersion && dev.m_DriverVersion && 
+			(m_DriverVersion->GetAsUI64()==dev.m_DriverVersion->GetAsUI64()))
 		&& (m_props == dev.m_props)
 		)
 	{
@@ -0,0 +1,425 @@
+// Copyright (C) 2024 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "LibXPUInfo_MemoryPressure.h"
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#ifdef __linux__
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+namespace XI
+{
+namespace
+{
+    // Used fraction [0,1] of physical memory, if known
+    std::optional<double> getSystemUsedFraction(const String& procRoot)
+    {
+#ifdef _WIN32
+        (void)procRoot;
+        MEMORYSTATUSEX ms{};
+        ms.dwLength = sizeof(ms);
+        if (GlobalMemoryStatusEx(&ms) && ms.ullTotalPhys)
+        {
+            return 1. - double(ms.ullAvailPhys) / double(ms.ullTotalPhys);
+        }
+#elif defined(__linux__)
+        // MemAvailable includes reclaimable page cache, unlike _SC_AVPHYS_PAGES (MemFree)
+        std::ifstream ifs(procRoot + "/meminfo");
+        String key;
+        UI64 value = 0, total = 0, avail = 0;
+        String unit;
+        while ((ifs >> key >> value >> unit) && !(total && avail))
+        {
+            if (key == "MemTotal:")
+                total = value;
+            else if (key == "MemAvailable:")
+                avail = value;
+        }
+        if (total && avail)
+        {
+            return 1. - double(avail) / double(total);
+        }
+#else
+        (void)procRoot;
+#endif
+        return std::nullopt;
+    }
+}
+
+const char* MemoryPressureMonitor::getLevelName(Level level)
+{
+    switch (level)
+    {
+    case LEVEL_NORMAL: return "Normal";
+    case LEVEL_MODERATE: return "Moderate";
+    case LEVEL_CRITICAL: return "Critical";
+    }
+    return "Unknown";
+}
+
+const char* MemoryPressureMonitor::getSourceName(Source source)
+{
+    switch (source)
+    {
+    case SOURCE_SYSTEM_PSI: return "System PSI";
+    case SOURCE_CGROUP_PSI: return "cgroup PSI";
+    case SOURCE_SYSTEM_AVAILABLE: return "System Available";
+    case SOURCE_DEVICE_BUDGET: return "Device Budget";
+    }
+    return "Unknown";
+}
+
+std::optional<double> MemoryPressureMonitor::readPSIAvg10(const String& path, bool full)
+{
+    // some avg10=0.00 avg60=0.00 avg300=0.00 total=0
+    // full avg10=0.00 avg60=0.00 avg300=0.00 total=0
+    std::ifstream ifs(path);
+    String line;
+    const String prefix = full ? "full avg10=" : "some avg10=";
+    while (std::getline(ifs, line))
+    {
+        if (line.compare(0, prefix.size(), prefix) == 0)
+        {
+            const char* start = line.c_str() + prefix.size();
+            char* end = nullptr;
+            const double avg10 = std::strtod(start, &end);
+            if (end == start)
+            {
+                return std::nullopt;
+            }
+            return avg10;
+        }
+    }
+    return std::nullopt;
+}
+
+std::optional<String> MemoryPressureMonitor::findCgroupPressurePath(const String& procRoot, const String& cgroupRoot)
+{
+    // cgroup v2 has a single "0::<path>" line
+    std::ifstream ifs(procRoot + "/self/cgroup");
+    String line;
+    while (std::getline(ifs, line))
+    {
+        if (line.compare(0, 3, "0::") == 0)
+        {
+            String cgPath = line.substr(3);
+            if (cgPath.empty() || (cgPath == "/"))
+            {
+                break; // Root cgroup has no memory.pressure; same as system
+            }
+            String pressurePath = cgroupRoot + cgPath + "/memory.pressure";
+            if (Sysfs::exists(pressurePath))
+            {
+                return pressurePath;
+            }
+            break;
+        }
+    }
+    return std::nullopt;
+}
+
+MemoryPressureMonitor::MemoryPressureMonitor(const Params& params) : m_Params(params)
+{
+    XPUINFO_REQUIRE_MSG(m_Params.moderateFraction <= m_Params.criticalFraction, "Moderate threshold above critical");
+
+#ifdef __linux__
+    if (m_Params.usePSI)
+    {
+        addPSIWatch(SOURCE_SYSTEM_PSI, m_Params.psiPath);
+        if (m_Params.cgroupPressurePath != "-")
+        {
+            auto cgPath = m_Params.cgroupPressurePath.size() ? std::optional<String>(m_Params.cgroupPressurePath) :
+                findCgroupPressurePath(m_Params.procRoot, m_Params.cgroupRoot);
+            if (cgPath)
+            {
+                addPSIWatch(SOURCE_CGROUP_PSI, *cgPath);
+            }
+        }
+    }
+#endif
+    if (!isUsingPSI() && getSystemUsedFraction(m_Params.procRoot))
+    {
+        m_Polled.push_back(PolledWatch());
+    }
+    for (const auto& dw : m_Params.devices)
+    {
+        XPUINFO_REQUIRE(dw.device);
+        PolledWatch pw;
+        pw.source = SOURCE_DEVICE_BUDGET;
+        pw.device = dw;
+        if (!pw.device.getUsage)
+        {
+            DevicePtr dev = dw.device;
+            pw.device.getUsage = [dev]() { return dev->getMemUsage(); };
+        }
+        m_Polled.push_back(pw);
+    }
+
+    if (m_PSI.size() || m_Polled.size())
+    {
+#ifdef __linux__
+        XPUINFO_REQUIRE(pipe2(m_wakePipe, O_CLOEXEC | O_NONBLOCK) == 0);
+#endif
+        m_thread = std::thread([this]() { ThreadFunc(); });
+    }
+}
+
+MemoryPressureMonitor::~MemoryPressureMonitor()
+{
+    stop();
+#ifdef __linux__
+    for (auto& watch : m_PSI)
+    {
+        for (int fd : watch.fd)
+        {
+            if (fd >= 0)
+                close(fd);
+        }
+    }
+    for (int fd : m_wakePipe)
+    {
+        if (fd >= 0)
+            close(fd);
+    }
+#endif
+}
+
+void MemoryPressureMonitor::stop()
+{
+    if (m_thread.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_bStop = true;
+        }
+        m_cv.notify_all();
+#ifdef __linux__
+        const char c = 0;
+        (void)!write(m_wakePipe[1], &c, 1);
+#endif
+        m_thread.join();
+    }
+}
+
+bool MemoryPressureMonitor::addPSIWatch(Source source, const String& path)
+{
+#ifdef __linux__
+    PSIWatch watch;
+    watch.source = source;
+    watch.path = path;
+    const PSITrigger* triggers[2] = { &m_Params.moderateTrigger, &m_Params.criticalTrigger };
+    for (int i = 0; i < 2; ++i)
+    {
+        if (!triggers[i]->stallUs)
+        {
+            continue;
+        }
+        // Each trigger needs its own open file; it is removed when the file is closed
+        int fd = open(path.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+        if (fd < 0)
+        {
+            break;
+        }
+        const String trig = String(triggers[i]->full ? "full " : "some ") + std::to_string(triggers[i]->stallUs) +
+            " " + std::to_string(triggers[i]->windowUs);
+        if (write(fd, trig.c_str(), trig.size() + 1) < 0)
+        {
+            close(fd);
+            break;
+        }
+        watch.fd[i] = fd;
+    }
+    if ((watch.fd[0] < 0) && (watch.fd[1] < 0))
+    {
+        return false;
+    }
+    m_PSI.push_back(watch);
+    m_PSIPaths.push_back(path);
+    return true;
+#else
+    (void)source; (void)path;
+    return false;
+#endif
+}
+
+MemoryPressureMonitor::Level MemoryPressureMonitor::getPolledLevel(Level current, double usedFraction) const
+{
+    // Rise as soon as a threshold is crossed, fall only once below it by hysteresis
+    if (usedFraction >= m_Params.criticalFraction)
+        return LEVEL_CRITICAL;
+    if ((current == LEVEL_CRITICAL) && (usedFraction >= m_Params.criticalFraction - m_Params.hysteresis))
+        return LEVEL_CRITICAL;
+    if (usedFraction >= m_Params.moderateFraction)
+        return LEVEL_MODERATE;
+    if ((current >= LEVEL_MODERATE) && (usedFraction >= m_Params.moderateFraction - m_Params.hysteresis))
+        return LEVEL_MODERATE;
+    return LEVEL_NORMAL;
+}
+
+void MemoryPressureMonitor::notify(Event& ev)
+{
+    UI32 maxLevel = LEVEL_NORMAL;
+    for (const auto& watch : m_PSI)
+        maxLevel = std::max<UI32>(maxLevel, watch.level);
+    for (const auto& watch : m_Polled)
+        maxLevel = std::max<UI32>(maxLevel, watch.level);
+    m_maxLevel = maxLevel;
+
+    if (m_Params.callback)
+    {
+        m_Params.callback(ev);
+    }
+}
+
+void MemoryPressureMonitor::updatePSI(PSIWatch& watch, std::chrono::steady_clock::time_point now)
+{
+    const auto quiet = std::chrono::milliseconds(m_Params.psiQuietMs);
+    Level newLevel = LEVEL_NORMAL;
+    if (watch.haveEvent[1] && (now - watch.lastEvent[1] < quiet))
+        newLevel = LEVEL_CRITICAL;
+    else if (watch.haveEvent[0] && (now - watch.lastEvent[0] < quiet))
+        newLevel = LEVEL_MODERATE;
+
+    if (newLevel != watch.level)
+    {
+        Event ev;
+        ev.source = watch.source;
+        ev.previousLevel = watch.level;
+        ev.level = newLevel;
+        ev.value = readPSIAvg10(watch.path).value_or(0.);
+        watch.level = newLevel;
+        notify(ev);
+    }
+}
+
+void MemoryPressureMonitor::updatePolled(PolledWatch& watch)
+{
+    std::optional<double> usedFraction;
+    if (watch.source == SOURCE_DEVICE_BUDGET)
+    {
+        XPUINFO_TRY
+        {
+            auto usage = watch.device.getUsage();
+            if (usage.budget)
+            {
+                usedFraction = double(usage.currentUsage) / double(usage.budget);
+            }
+        }
+        XPUINFO_CATCH_ALL
+        {
+        }
+    }
+    else
+    {
+        usedFraction = getSystemUsedFraction(m_Params.procRoot);
+    }
+    if (!usedFraction)
+    {
+        return;
+    }
+
+    Level newLevel = getPolledLevel(watch.level, *usedFraction);
+    if (newLevel != watch.level)
+    {
+        Event ev;
+        ev.source = watch.source;
+        ev.previousLevel = watch.level;
+        ev.level = newLevel;
+        ev.device = watch.device.device;
+        ev.value = *usedFraction;
+        watch.level = newLevel;
+        notify(ev);
+    }
+}
+
+void MemoryPressureMonitor::ThreadFunc()
+{
+#ifdef __linux__
+    std::vector<pollfd> pfds;
+    std::vector<std::pair<size_t, int>> fdWatch; // {index into m_PSI, trigger}, parallel to pfds[1..]
+    for (;;)
+    {
+        pfds.clear();
+        fdWatch.clear();
+        pfds.push_back({ m_wakePipe[0], POLLIN, 0 });
+        int timeoutMs = m_Polled.size() ? int(m_Params.pollIntervalMs) : -1;
+        const auto now = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < m_PSI.size(); ++i)
+        {
+            for (int t = 0; t < 2; ++t)
+            {
+                if (m_PSI[i].fd[t] >= 0)
+                {
+                    pfds.push_back({ m_PSI[i].fd[t], POLLPRI, 0 });
+                    fdWatch.emplace_back(i, t);
+                }
+            }
+            if (m_PSI[i].level != LEVEL_NORMAL)
+            {
+                // Wake when the quiet period of the latest event would end
+                auto last = std::max(m_PSI[i].haveEvent[0] ? m_PSI[i].lastEvent[0] : now - std::chrono::hours(1),
+                    m_PSI[i].haveEvent[1] ? m_PSI[i].lastEvent[1] : now - std::chrono::hours(1));
+                auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    last + std::chrono::milliseconds(m_Params.psiQuietMs) - now).count() + 1;
+                remaining = std::max<long long>(remaining, 0);
+                timeoutMs = (timeoutMs < 0) ? int(remaining) : std::min(timeoutMs, int(remaining));
+            }
+        }
+
+        int ret = poll(pfds.data(), pfds.size(), timeoutMs);
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_bStop)
+            {
+                break;
+            }
+        }
+        if ((ret < 0) && (errno != EINTR))
+        {
+            break;
+        }
+        const auto eventTime = std::chrono::steady_clock::now();
+        for (size_t p = 1; (ret > 0) && (p < pfds.size()); ++p)
+        {
+            auto& watch = m_PSI[fdWatch[p - 1].first];
+            const int t = fdWatch[p - 1].second;
+            if (pfds[p].revents & POLLERR)
+            {
+                // Monitored file went away (i.e. cgroup removed)
+                close(watch.fd[t]);
+                watch.fd[t] = -1;
+            }
+            else if (pfds[p].revents & POLLPRI)
+            {
+                watch.lastEvent[t] = eventTime;
+                watch.haveEvent[t] = true;
+            }
+        }
+        for (auto& watch : m_PSI)
+        {
+            updatePSI(watch, eventTime);
+        }
+        for (auto& watch : m_Polled)
+        {
+            updatePolled(watch);
+        }
+    }
+#else
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_bStop)
+    {
+        lock.unlock();
+        for (auto& watch : m_Polled)
+        {
+            updatePolled(watch);
+        }
+        lock.lock();
+        m_cv.wait_for(lock, std::chrono::milliseconds(m_Params.pollIntervalMs), [this]() { return m_bStop; });
+    }
+#endif
+}
+} // XI
@@ -0,0 +1,145 @@
+// Copyright (C) 2024 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+// Event-driven memory pressure notifications, so caches can shrink before the kernel or driver
+// starts reclaiming/evicting.
+//
+// On Linux, system and cgroup pressure come from PSI (Pressure Stall Information) triggers on
+// /proc/pressure/memory and <cgroup>/memory.pressure, waited on with poll().  If PSI is unavailable,
+// and on other OSs, the available physical memory fraction is polled instead.  Device memory
+// budgets (Device::getMemUsage()) are polled, as there is no portable notification for them.
+
+#pragma once
+#include "LibXPUInfo.h"
+#include "LibXPUInfo_Util.h"
+#include <atomic>
+
+#ifdef _WIN32
+#pragma warning(push)
+#pragma warning(disable : 4251)
+#endif
+
+namespace XI
+{
+    class XPUINFO_EXPORT MemoryPressureMonitor : public NoCopyAssign
+    {
+    public:
+        enum Source : UI32
+        {
+            SOURCE_SYSTEM_PSI = 0,      // /proc/pressure/memory
+            SOURCE_CGROUP_PSI,          // memory.pressure of this process' cgroup (v2)
+            SOURCE_SYSTEM_AVAILABLE,    // Polled available physical memory, if PSI is not available
+            SOURCE_DEVICE_BUDGET,       // Polled device memory usage vs. budget
+        };
+        enum Level : UI32
+        {
+            LEVEL_NORMAL = 0,
+            LEVEL_MODERATE,             // Shrink caches
+            LEVEL_CRITICAL,             // Release everything possible
+        };
+
+        struct Event
+        {
+            Source source = SOURCE_SYSTEM_PSI;
+            Level level = LEVEL_NORMAL;
+            Level previousLevel = LEVEL_NORMAL;
+            DevicePtr device;           // SOURCE_DEVICE_BUDGET only
+            // PSI: "some" avg10 percentage.  Others: used fraction [0,1] of available/budget memory.
+            double value = 0.;
+        };
+        typedef std::function<void(const Event&)> Callback;
+
+        // Stall of stallUs within any windowUs.  Unprivileged processes may only use windows that are
+        // a multiple of 2 seconds.
+        struct PSITrigger
+        {
+            bool full = false;          // All non-idle tasks stalled, rather than "some"
+            UI32 stallUs = 0;
+            UI32 windowUs = 2000000;
+        };
+        struct DeviceWatch
+        {
+            DevicePtr device;
+            // Defaults to device->getMemUsage()
+            std::function<DXCoreAdapterMemoryBudget()> getUsage;
+        };
+        struct Params
+        {
+            Callback callback;          // Called from the monitor thread
+
+            bool usePSI = true;
+            String psiPath = "/proc/pressure/memory";
+            // Empty to find the cgroup of this process from /proc/self/cgroup, "-" to not monitor a cgroup
+            String cgroupPressurePath;
+            String procRoot = "/proc";
+            String cgroupRoot = "/sys/fs/cgroup";
+            PSITrigger moderateTrigger = { false, 200000, 2000000 };
+            PSITrigger criticalTrigger = { true, 100000, 2000000 };
+            // PSI triggers only signal rising pressure; the level drops after this long without one
+            UI32 psiQuietMs = 3000;
+
+            std::vector<DeviceWatch> devices;
+            // Used fraction thresholds for polled sources.  Level drops once usage falls hysteresis below a threshold.
+            double moderateFraction = 0.85;
+            double criticalFraction = 0.95;
+            double hysteresis = 0.05;
+            UI32 pollIntervalMs = 250;
+        };
+
+        MemoryPressureMonitor(const Params& params);
+        ~MemoryPressureMonitor();
+
+        bool isUsingPSI() const { return m_PSI.size() > 0; }
+        const std::vector<String>& getPSIPaths() const { return m_PSIPaths; }
+        // Highest current level over all sources
+        Level getLevel() const { return Level(m_maxLevel.load()); }
+        void stop();
+
+        // "some"/"full" avg10 percentage from a PSI file, if readable
+        static std::optional<double> readPSIAvg10(const String& path, bool full = false);
+        // cgroup v2 memory.pressure of this process, if any (and not the root cgroup)
+        static std::optional<String> findCgroupPressurePath(const String& procRoot = "/proc",
+            const String& cgroupRoot = "/sys/fs/cgroup");
+        static const char* getLevelName(Level level);
+        static const char* getSourceName(Source source);
+
+    protected:
+        struct PSIWatch
+        {
+            Source source = SOURCE_SYSTEM_PSI;
+            String path;
+            int fd[2] = { -1, -1 };     // Moderate, critical triggers
+            std::chrono::steady_clock::time_point lastEvent[2];
+            bool haveEvent[2] = { false, false };
+            Level level = LEVEL_NORMAL;
+        };
+        struct PolledWatch
+        {
+            Source source = SOURCE_SYSTEM_AVAILABLE;
+            DeviceWatch device;
+            Level level = LEVEL_NORMAL;
+        };
+
+        bool addPSIWatch(Source source, const String& path);
+        void ThreadFunc();
+        void updatePSI(PSIWatch& watch, std::chrono::steady_clock::time_point now);
+        void updatePolled(PolledWatch& watch);
+        Level getPolledLevel(Level current, double usedFraction) const;
+        void notify(Event& ev);
+
+        const Params m_Params;
+        std::vector<PSIWatch> m_PSI;
+        std::vector<String> m_PSIPaths;
+        std::vector<PolledWatch> m_Polled;
+        std::atomic<UI32> m_maxLevel{ LEVEL_NORMAL };
+        std::thread m_thread;
+        std::mutex m_mutex;
+        std::condition_variable m_cv;
+        bool m_bStop = false;
+        int m_wakePipe[2] = { -1, -1 };
+    };
+} // XI
+
+#ifdef _WIN32
+#pragma warning(pop)
+#endif
@@ -165,6 +165,17 @@ bool TelemetryTracker::RecordNVML(TimedRecord& rec)
             }
             bRet = true;
         }
+        unsigned long long energyMilliJoules = 0; // Since driver load, Volta and later
+        result = nvmlDeviceGetTotalEnergyConsumption(dev, &energyMilliJoules);
+        if (NVML_SUCCESS == result)
+        {
+            rec.deviceEnergyJ = energyMilliJoules * 1e-3;
+            if (m_records.size() == 0)
+            {
+                m_ResultMask = (TelemetryItem)(m_ResultMask | TELEMETRYITEM_DEVICE_ENERGY);
+            }
+            bRet = true;
+        }
 
     }
     return bRet;
@@ -0,0 +1,674 @@
+// Copyright (C) 2024 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "LibXPUInfo_Platform.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <functional>
+#include <iomanip>
+#include <iterator>
+#include <sstream>
+
+namespace XI
+{
+namespace
+{
+    const UI32 kLocalNodeDistance = 10;
+
+#ifndef _WIN32
+    String getPCIDevicePath(const PCIAddressType& address, const String& sysRoot)
+    {
+        char bdf[32];
+        snprintf(bdf, sizeof(bdf), "%04x:%02x:%02x.%x", address.domain, address.bus, address.device, address.function);
+        return sysRoot + "/bus/pci/devices/" + bdf;
+    }
+
+    std::vector<UI32> getNodeCPUs(UI32 node, const String& sysRoot)
+    {
+        String cpuList;
+        if (Sysfs::readString(sysRoot + "/devices/system/node/node" + std::to_string(node) + "/cpulist", cpuList))
+        {
+            return Sysfs::parseCPUList(cpuList);
+        }
+        return {};
+    }
+#else
+    std::vector<UI32> getNodeCPUs(UI32 node)
+    {
+        std::vector<UI32> cpus;
+        USHORT numGroups = 0;
+        GetNumaNodeProcessorMask2((USHORT)node, nullptr, 0, &numGroups);
+        std::vector<GROUP_AFFINITY> groups(numGroups);
+        if (numGroups && GetNumaNodeProcessorMask2((USHORT)node, groups.data(), numGroups, &numGroups))
+        {
+            for (const auto& g : groups)
+            {
+                for (UI32 bit = 0; bit < 64; ++bit)
+                {
+                    if (g.Mask & (KAFFINITY(1) << bit))
+                    {
+                        cpus.push_back(g.Group * 64 + bit);
+                    }
+                }
+            }
+        }
+        return cpus;
+    }
+
+    HostLocality getHostLocalityFromNode(I32 node)
+    {
+        HostLocality loc;
+        loc.numaNode = node;
+        if (node >= 0)
+        {
+            loc.localCPUs = getNodeCPUs(UI32(node));
+            // Windows doesn't expose the SLIT, so only the local distance is known
+            loc.cpuNodeDistances[UI32(node)] = kLocalNodeDistance;
+        }
+        return loc;
+    }
+#endif
+
+    std::vector<UI32> getOnlineCPUs(const String& sysRoot)
+    {
+        std::vector<UI32> cpus;
+#ifdef _WIN32
+        UNREFERENCED_PARAMETER(sysRoot);
+        // Group * 64 + index, as for getNodeCPUs.  Active processors are contiguous within a group.
+        const WORD numGroups = GetActiveProcessorGroupCount();
+        for (WORD group = 0; group < numGroups; ++group)
+        {
+            const DWORD numCPUs = GetActiveProcessorCount(group);
+            for (UI32 i = 0; i < numCPUs; ++i)
+            {
+                cpus.push_back(UI32(group) * 64 + i);
+            }
+        }
+#else
+        for (const auto& ct : Sysfs::getCPUsByCoreType(sysRoot))
+        {
+            cpus.insert(cpus.end(), ct.second.begin(), ct.second.end());
+        }
+        std::sort(cpus.begin(), cpus.end());
+#endif
+        return cpus;
+    }
+
+    std::vector<UI32> getCPUsOfCoreType(short coreType, const String& sysRoot)
+    {
+#ifdef _WIN32
+        UNREFERENCED_PARAMETER(sysRoot);
+        std::vector<UI32> cpus;
+        HybridDetect::PROCESSOR_INFO procInfo;
+        HybridDetect::GetProcessorInfo(procInfo);
+        auto it = procInfo.coreMasks.find(coreType);
+        if (it != procInfo.coreMasks.end())
+        {
+            // HybridDetect masks are of processor group 0, so bit is also Group * 64 + bit
+            for (UI32 bit = 0; bit < 64; ++bit)
+            {
+                if (it->second & (1ULL << bit))
+                {
+                    cpus.push_back(bit);
+                }
+            }
+        }
+        return cpus;
+#else
+        auto cpusByType = Sysfs::getCPUsByCoreType(sysRoot);
+        auto it = cpusByType.find(coreType);
+        return (it != cpusByType.end()) ? it->second : std::vector<UI32>();
+#endif
+    }
+}
+
+HostLocality getHostLocality(const PCIAddressType& address, const String& sysRoot)
+{
+#ifdef _WIN32
+    UNREFERENCED_PARAMETER(sysRoot);
+#ifdef XPUINFO_USE_SETUPAPI
+    SetupDeviceInfo sdi;
+    auto pInfo = sdi.getAtAddress(address);
+    return getHostLocalityFromNode(pInfo ? pInfo->NumaNode : -1);
+#else
+    UNREFERENCED_PARAMETER(address);
+    return getHostLocalityFromNode(-1);
+#endif
+#else
+    HostLocality loc;
+    if (!address.valid())
+    {
+        return loc;
+    }
+    const String devPath = getPCIDevicePath(address, sysRoot);
+    loc.numaNode = I32(Sysfs::readI64(devPath + "/numa_node").value_or(-1));
+    String cpuList;
+    if (Sysfs::readString(devPath + "/local_cpulist", cpuList))
+    {
+        loc.localCPUs = Sysfs::parseCPUList(cpuList);
+    }
+    else if (loc.numaNode >= 0)
+    {
+        loc.localCPUs = getNodeCPUs(UI32(loc.numaNode), sysRoot);
+    }
+
+    if (loc.numaNode >= 0)
+    {
+        // nodeN/distance lists distances to all possible nodes, in node order
+        const String nodeDir = sysRoot + "/devices/system/node";
+        const auto nodes = Sysfs::listIndexedEntries(nodeDir, "node");
+        String distStr;
+        if (Sysfs::readString(nodeDir + "/node" + std::to_string(loc.numaNode) + "/distance", distStr))
+        {
+            std::istringstream istr(distStr);
+            UI32 dist;
+            for (size_t i = 0; (i < nodes.size()) && (istr >> dist); ++i)
+            {
+                if (getNodeCPUs(nodes[i], sysRoot).size())
+                {
+                    loc.cpuNodeDistances[nodes[i]] = dist;
+                }
+            }
+        }
+    }
+    return loc;
+#endif
+}
+
+HostLocality getHostLocality(const DevicePtr& device, const String& sysRoot)
+{
+    if (!device)
+    {
+        return HostLocality();
+    }
+    const auto& props = device->getProperties();
+#ifdef _WIN32
+    if (props.pDriverInfo)
+    {
+        return getHostLocalityFromNode(props.pDriverInfo->NumaNode);
+    }
+#endif
+    if (props.PCIAddress.valid())
+    {
+        return getHostLocality(props.PCIAddress, sysRoot);
+    }
+    if (props.pDriverInfo && props.pDriverInfo->LocationInfo.valid())
+    {
+        return getHostLocality(props.pDriverInfo->LocationInfo, sysRoot);
+    }
+    return HostLocality();
+}
+
+UI64 HostAffinity::getCPUMask() const
+{
+    UI64 mask = 0;
+    for (auto cpu : cpus)
+    {
+        if (cpu < 64)
+        {
+            mask |= 1ULL << cpu;
+        }
+    }
+    return mask;
+}
+
+HostAffinity getBestHostAffinity(const DevicePtr& device, short coreType, const String& sysRoot)
+{
+    HostAffinity aff;
+    const auto loc = getHostLocality(device, sysRoot);
+    aff.memoryNode = loc.numaNode;
+    aff.isDeviceLocal = loc.localCPUs.size() > 0;
+    aff.cpus = aff.isDeviceLocal ? loc.localCPUs : getOnlineCPUs(sysRoot);
+
+    if (coreType != HybridDetect::CoreTypes::ANY)
+    {
+        auto typeCPUs = getCPUsOfCoreType(coreType, sysRoot);
+        std::vector<UI32> both;
+        std::sort(aff.cpus.begin(), aff.cpus.end());
+        std::sort(typeCPUs.begin(), typeCPUs.end());
+        std::set_intersection(aff.cpus.begin(), aff.cpus.end(), typeCPUs.begin(), typeCPUs.end(), std::back_inserter(both));
+        if (both.size())
+        {
+            aff.cpus = std::move(both);
+        }
+    }
+    return aff;
+}
+
+namespace
+{
+    bool parseBDF(const String& str, PCIAddressType& address)
+    {
+        // dddd:bb:dd.f
+        unsigned dom, bus, dev, func;
+        char tail = 0;
+        if ((str.size() >= 12) && (sscanf(str.c_str(), "%x:%x:%x.%x%c", &dom, &bus, &dev, &func, &tail) == 4))
+        {
+            address = PCIAddressType(dom, bus, dev, func);
+            return true;
+        }
+        return false;
+    }
+
+    I32 getPCIeGen(double speedGTs)
+    {
+        const double kGenSpeeds[] = { 2.5, 5.0, 8.0, 16.0, 32.0, 64.0 };
+        for (I32 i = 0; i < I32(sizeof(kGenSpeeds) / sizeof(kGenSpeeds[0])); ++i)
+        {
+            if (std::abs(speedGTs - kGenSpeeds[i]) < 0.1)
+            {
+                return i + 1;
+            }
+        }
+        return -1;
+    }
+
+    // i.e. "16.0 GT/s PCIe", "8 GT/s", "Unknown"
+    double readLinkSpeed(const String& path)
+    {
+        String str;
+        if (Sysfs::readString(path, str))
+        {
+            return std::strtod(str.c_str(), nullptr);
+        }
+        return 0.;
+    }
+}
+
+double PlatformGraph::Link::getBandwidth() const
+{
+    if (isInternal)
+    {
+        return std::numeric_limits<double>::infinity();
+    }
+    if ((speedGTs <= 0.) || (width <= 0))
+    {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+    // 8b/10b for Gen1-2, 128b/130b for Gen3-5, FLIT mode (242/256) for Gen6+
+    double encoding = (gen > 0 && gen <= 2) ? 0.8 : ((gen >= 6) ? 242. / 256. : 128. / 130.);
+    return speedGTs * 1e9 * encoding * width / 8.;
+}
+
+PlatformGraph::PlatformGraph(const String& sysRoot)
+{
+    const UI32 host = addNode(NODE_TYPE_HOST, "host", -1);
+#ifdef _WIN32
+    UNREFERENCED_PARAMETER(sysRoot);
+    UNREFERENCED_PARAMETER(host);
+#else
+    // Sockets and NUMA nodes
+    std::map<I32, UI32> socketNodes;
+    std::map<I32, UI32> numaNodes;
+    const String nodeDir = sysRoot + "/devices/system/node";
+    for (auto idx : Sysfs::listIndexedEntries(nodeDir, "node"))
+    {
+        String cpuList;
+        Sysfs::readString(nodeDir + "/node" + std::to_string(idx) + "/cpulist", cpuList);
+        auto cpus = Sysfs::parseCPUList(cpuList);
+        UI32 parent = host;
+        if (cpus.size())
+        {
+            auto pkg = Sysfs::readI64(sysRoot + "/devices/system/cpu/cpu" + std::to_string(cpus.front()) + "/topology/physical_package_id");
+            if (pkg.has_value())
+            {
+                auto it = socketNodes.find(I32(pkg.value()));
+                if (it == socketNodes.end())
+                {
+                    it = socketNodes.emplace(I32(pkg.value()), addNode(NODE_TYPE_SOCKET, "socket" + std::to_string(pkg.value()), host)).first;
+                }
+                parent = it->second;
+            }
+        }
+        numaNodes[I32(idx)] = addNode(NODE_TYPE_NUMA, "node" + std::to_string(idx), parent);
+    }
+
+    // PCI hierarchy, from device paths like devices/pci0000:00/0000:00:01.0/0000:01:00.0
+    std::map<String, UI32> byName;
+    const String pciDir = sysRoot + "/bus/pci/devices";
+    for (const auto& name : Sysfs::listEntries(pciDir))
+    {
+        std::error_code ec;
+        auto devPath = std::filesystem::canonical(pciDir + "/" + name, ec);
+        if (ec)
+        {
+            continue;
+        }
+        I32 parent = -1;
+        std::filesystem::path curPath;
+        for (const auto& part : devPath)
+        {
+            curPath /= part;
+            const String comp = part.string();
+            PCIAddressType address;
+            if ((parent < 0) && (comp.compare(0, 3, "pci") == 0) && (comp.find(':') != String::npos))
+            {
+                auto it = byName.find(comp);
+                if (it == byName.end())
+                {
+                    it = byName.emplace(comp, addNode(NODE_TYPE_ROOT_COMPLEX, comp, host)).first;
+                }
+                parent = I32(it->second);
+            }
+            else if ((parent >= 0) && parseBDF(comp, address))
+            {
+                auto it = byName.find(comp);
+                if (it == byName.end())
+                {
+                    UI32 id = addNode(NODE_TYPE_DEVICE, comp, parent);
+                    m_Nodes[id].address = address;
+                    readPCINode(m_Nodes[id], curPath.string());
+                    it = byName.emplace(comp, id).first;
+                }
+                parent = I32(it->second);
+            }
+        }
+    }
+
+    // Nodes were created parent-first, so port direction can be assigned in one pass:
+    // bridges under a root complex are root ports; below that, switch upstream and downstream
+    // ports alternate.  Only links below root/downstream ports (and endpoint/upstream port links)
+    // are physical.
+    std::vector<bool> isDownstreamPort(m_Nodes.size(), false);
+    for (auto& node : m_Nodes)
+    {
+        if ((node.type != NODE_TYPE_BRIDGE) && (node.type != NODE_TYPE_DEVICE))
+        {
+            continue;
+        }
+        const auto& parent = m_Nodes[node.parent];
+        const bool bParentIsPort = (parent.type == NODE_TYPE_BRIDGE);
+        node.uplink.isInternal = !bParentIsPort || !isDownstreamPort[parent.id];
+        if (node.type == NODE_TYPE_BRIDGE)
+        {
+            isDownstreamPort[node.id] = !bParentIsPort || !isDownstreamPort[parent.id];
+        }
+    }
+
+    // Attach each root complex to the NUMA node of its devices
+    for (auto& rc : m_Nodes)
+    {
+        if (rc.type != NODE_TYPE_ROOT_COMPLEX)
+        {
+            continue;
+        }
+        std::vector<UI32> stack(rc.children);
+        while (stack.size())
+        {
+            const auto& n = m_Nodes[stack.back()];
+            stack.pop_back();
+            auto it = numaNodes.find(n.numaNode);
+            if (it != numaNodes.end())
+            {
+                setParent(rc.id, it->second);
+                break;
+            }
+            stack.insert(stack.end(), n.children.begin(), n.children.end());
+        }
+    }
+#endif
+}
+
+UI32 PlatformGraph::addNode(NodeType type, const String& name, I32 parent)
+{
+    Node n;
+    n.id = UI32(m_Nodes.size());
+    n.type = type;
+    n.name = name;
+    m_Nodes.push_back(n);
+    if (parent >= 0)
+    {
+        setParent(n.id, UI32(parent));
+    }
+    return n.id;
+}
+
+void PlatformGraph::setParent(UI32 child, UI32 parent)
+{
+    auto& c = m_Nodes[child];
+    if (c.parent >= 0)
+    {
+        auto& siblings = m_Nodes[c.parent].children;
+        siblings.erase(std::remove(siblings.begin(), siblings.end(), child), siblings.end());
+    }
+    c.parent = I32(parent);
+    m_Nodes[parent].children.push_back(child);
+}
+
+void PlatformGraph::readPCINode(Node& node, const String& devPath) const
+{
+    node.classCode = UI32(Sysfs::readUI64(devPath + "/class").value_or(0));
+    node.vendorID = UI32(Sysfs::readUI64(devPath + "/vendor").value_or(0));
+    node.deviceID = UI32(Sysfs::readUI64(devPath + "/device").value_or(0));
+    node.numaNode = I32(Sysfs::readI64(devPath + "/numa_node").value_or(-1));
+    if ((node.classCode >> 8) == 0x0604) // PCI-to-PCI bridge
+    {
+        node.type = NODE_TYPE_BRIDGE;
+    }
+    auto& l = node.uplink;
+    l.speedGTs = readLinkSpeed(devPath + "/current_link_speed");
+    l.gen = getPCIeGen(l.speedGTs);
+    l.width = I32(Sysfs::readI64(devPath + "/current_link_width").value_or(-1));
+    l.maxSpeedGTs = readLinkSpeed(devPath + "/max_link_speed");
+    l.maxGen = getPCIeGen(l.maxSpeedGTs);
+    l.maxWidth = I32(Sysfs::readI64(devPath + "/max_link_width").value_or(-1));
+}
+
+std::optional<UI32> PlatformGraph::findNode(const PCIAddressType& address) const
+{
+    for (const auto& n : m_Nodes)
+    {
+        if (((n.type == NODE_TYPE_DEVICE) || (n.type == NODE_TYPE_BRIDGE)) && (n.address == address))
+        {
+            return n.id;
+        }
+    }
+    return std::nullopt;
+}
+
+std::optional<UI32> PlatformGraph::findNode(const DevicePtr& device) const
+{
+    if (!device)
+    {
+        return std::nullopt;
+    }
+    const auto& props = device->getProperties();
+    if (props.PCIAddress.valid())
+    {
+        return findNode(props.PCIAddress);
+    }
+    if (props.pDriverInfo && props.pDriverInfo->LocationInfo.valid())
+    {
+        return findNode(props.pDriverInfo->LocationInfo);
+    }
+    return std::nullopt;
+}
+
+UI32 PlatformGraph::getDepth(UI32 id) const
+{
+    UI32 depth = 0;
+    for (I32 n = m_Nodes[id].parent; n >= 0; n = m_Nodes[n].parent)
+    {
+        ++depth;
+    }
+    return depth;
+}
+
+UI32 PlatformGraph::getCommonAncestor(UI32 a, UI32 b) const
+{
+    XPUINFO_REQUIRE((a < m_Nodes.size()) && (b < m_Nodes.size()));
+    UI32 da = getDepth(a), db = getDepth(b);
+    for (; da > db; --da)
+    {
+        a = UI32(m_Nodes[a].parent);
+    }
+    for (; db > da; --db)
+    {
+        b = UI32(m_Nodes[b].parent);
+    }
+    while (a != b)
+    {
+        a = UI32(m_Nodes[a].parent);
+        b = UI32(m_Nodes[b].parent);
+    }
+    return a;
+}
+
+std::vector<UI32> PlatformGraph::getPath(UI32 a, UI32 b) const
+{
+    const UI32 ancestor = getCommonAncestor(a, b);
+    std::vector<UI32> path, down;
+    for (UI32 n = a; n != ancestor; n = UI32(m_Nodes[n].parent))
+    {
+        path.push_back(n);
+    }
+    path.push_back(ancestor);
+    for (UI32 n = b; n != ancestor; n = UI32(m_Nodes[n].parent))
+    {
+        down.push_back(n);
+    }
+    path.insert(path.end(), down.rbegin(), down.rend());
+    return path;
+}
+
+PlatformGraph::PeerPath PlatformGraph::getPeerPath(UI32 a, UI32 b) const
+{
+    PeerPath pp;
+    pp.commonAncestor = getCommonAncestor(a, b);
+    pp.commonAncestorType = m_Nodes[pp.commonAncestor].type;
+    pp.viaRootComplex = (pp.commonAncestorType != NODE_TYPE_BRIDGE) && (pp.commonAncestorType != NODE_TYPE_DEVICE) && (a != b);
+    // Root complexes without a NUMA node hang off the host directly, so their socket is unknown
+    const auto getSocket = [this](UI32 n) -> I32
+    {
+        for (I32 i = I32(n); i >= 0; i = m_Nodes[i].parent)
+        {
+            if (m_Nodes[i].type == NODE_TYPE_SOCKET)
+            {
+                return i;
+            }
+        }
+        return -1;
+    };
+    const I32 socketA = getSocket(a), socketB = getSocket(b);
+    pp.crossSocket = (socketA >= 0) && (socketB >= 0) && (socketA != socketB);
+
+    // Each node below the common ancestor contributes its uplink
+    bool bUnknown = false;
+    double minBW = std::numeric_limits<double>::infinity();
+    for (auto n : getPath(a, b))
+    {
+        if (n == pp.commonAncestor)
+        {
+            continue;
+        }
+        const auto& link = m_Nodes[n].uplink;
+        if (link.isInternal)
+        {
+            continue;
+        }
+        ++pp.numLinks;
+        double bw = link.getBandwidth();
+        if (std::isnan(bw))
+        {
+            bUnknown = true;
+        }
+        else
+        {
+            minBW = std::min(minBW, bw);
+        }
+    }
+    pp.bottleneckBandwidth = (bUnknown && std::isinf(minBW)) ? std::numeric_limits<double>::quiet_NaN() : minBW;
+    return pp;
+}
+
+std::vector<std::vector<UI32>> PlatformGraph::getP2PGroups(const std::vector<UI32>& devices) const
+{
+    // Union-find of devices whose common ancestor is a switch port
+    std::vector<size_t> groupOf(devices.size());
+    for (size_t i = 0; i < devices.size(); ++i)
+    {
+        groupOf[i] = i;
+    }
+    std::function<size_t(size_t)> find = [&](size_t i) { return (groupOf[i] == i) ? i : (groupOf[i] = find(groupOf[i])); };
+    for (size_t i = 0; i < devices.size(); ++i)
+    {
+        for (size_t j = i + 1; j < devices.size(); ++j)
+        {
+            if (!getPeerPath(devices[i], devices[j]).viaRootComplex)
+            {
+                groupOf[find(j)] = find(i);
+            }
+        }
+    }
+
+    std::vector<std::vector<UI32>> groups;
+    std::map<size_t, size_t> groupIndex;
+    for (size_t i = 0; i < devices.size(); ++i)
+    {
+        auto it = groupIndex.find(find(i));
+        if (it == groupIndex.end())
+        {
+            it = groupIndex.emplace(find(i), groups.size()).first;
+            groups.emplace_back();
+        }
+        groups[it->second].push_back(devices[i]);
+    }
+    for (auto& g : groups)
+    {
+        std::sort(g.begin(), g.end());
+    }
+    return groups;
+}
+
+void PlatformGraph::printNode(std::ostream& ostr, UI32 id, UI32 indent) const
+{
+    const auto& n = m_Nodes[id];
+    ostr << String(indent * 2, ' ') << n.name;
+    if ((n.type == NODE_TYPE_DEVICE) || (n.type == NODE_TYPE_BRIDGE))
+    {
+        SaveRestoreIOSFlags srFlags(ostr);
+        ostr << " [" << std::hex << std::setfill('0') << std::setw(6) << n.classCode << " "
+             << std::setw(4) << n.vendorID << ":" << std::setw(4) << n.deviceID << "]" << std::dec;
+        if (!n.uplink.isInternal && (n.uplink.gen > 0))
+        {
+            ostr << " Gen" << n.uplink.gen << " x" << n.uplink.width;
+            if ((n.uplink.maxGen != n.uplink.gen) || (n.uplink.maxWidth != n.uplink.width))
+            {
+                ostr << " (max Gen" << n.uplink.maxGen << " x" << n.uplink.maxWidth << ")";
+            }
+        }
+    }
+    ostr << std::endl;
+    for (auto c : n.children)
+    {
+        printNode(ostr, c, indent + 1);
+    }
+}
+
+void PlatformGraph::printInfo(std::ostream& ostr) const
+{
+    ostr << "Platform graph:\n";
+    printNode(ostr, 0, 1);
+}
+
+std::ostream& operator<<(std::ostream& ostr, const HostLocality& loc)
+{
+    if (!loc.isKnown())
+    {
+        return ostr << "Host locality unknown";
+    }
+    ostr << "NUMA node " << loc.numaNode << ", local CPUs " << Sysfs::formatCPUList(loc.localCPUs);
+    if (loc.cpuNodeDistances.size())
+    {
+        ostr << ", distances:";
+        for (const auto& [node, dist] : loc.cpuNodeDistances)
+        {
+            ostr << " node" << node << "=" << dist;
+        }
+    }
+    return ostr;
+}
+
+} // XI
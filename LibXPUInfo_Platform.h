@@ -0,0 +1,143 @@
+// Copyright (C) 2024 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+// Platform topology: where devices attach to the host, and how they connect to each other.
+//
+// On Linux this is read from sysfs relative to a caller-provided root (so it can be exercised
+// against a fixture tree).  On Windows, NUMA information comes from the device's PCI location
+// (SetupAPI DEVPKEY_Device_Numa_Node) and the OS NUMA APIs, and sysRoot is ignored.
+
+#pragma once
+#include "LibXPUInfo.h"
+#include "LibXPUInfo_Util.h"
+
+#ifdef _WIN32
+#pragma warning(push)
+#pragma warning(disable : 4251)
+#endif
+
+namespace XI
+{
+    // Host locality of a PCI device
+    struct XPUINFO_EXPORT HostLocality
+    {
+        I32 numaNode = -1;                  // -1 if unknown, or if the platform has a single node
+        std::vector<UI32> localCPUs;        // Logical processors nearest the device, numbered as HostAffinity::cpus
+        // {NUMA node with CPUs, distance from numaNode}.  ACPI SLIT units: 10 is local.
+        std::map<UI32, UI32> cpuNodeDistances;
+        bool isKnown() const { return (numaNode >= 0) || localCPUs.size(); }
+    };
+    XPUINFO_EXPORT std::ostream& operator<<(std::ostream& ostr, const HostLocality& loc);
+
+    XPUINFO_EXPORT HostLocality getHostLocality(const PCIAddressType& address, const String& sysRoot = Sysfs::kDefaultSysRoot);
+    XPUINFO_EXPORT HostLocality getHostLocality(const DevicePtr& device, const String& sysRoot = Sysfs::kDefaultSysRoot);
+
+    // CPUs and memory node for host threads/buffers that feed a device
+    struct XPUINFO_EXPORT HostAffinity
+    {
+        // Logical processor indices.  On Windows, Group * 64 + index within the processor group,
+        // and core type filtering only covers group 0 (HybridDetect masks).
+        std::vector<UI32> cpus;
+        I32 memoryNode = -1;                // -1 if unknown (no preference)
+        bool isDeviceLocal = false;         // False if device locality is unknown and all CPUs are returned
+        // CPUs 0-63 (processor group 0 on Windows) as a mask, i.e. for HybridDetect::RunOnMask
+        UI64 getCPUMask() const;
+    };
+    // CPUs local to the device, optionally restricted to coreType (HybridDetect::CoreTypes).
+    // Falls back to all local CPUs if none are of coreType, and to all online CPUs if locality is unknown.
+    XPUINFO_EXPORT HostAffinity getBestHostAffinity(const DevicePtr& device,
+        short coreType = HybridDetect::CoreTypes::ANY, const String& sysRoot = Sysfs::kDefaultSysRoot);
+
+    // Graph of the host's CPU sockets, NUMA nodes and PCI hierarchy (root complexes, bridges/switch
+    // ports and devices), with the PCIe link of each node to its parent.  Built from the upstream
+    // device paths that /sys/bus/pci/devices links to.  Not available on Windows (empty graph).
+    class XPUINFO_EXPORT PlatformGraph
+    {
+    public:
+        enum NodeType : UI32
+        {
+            NODE_TYPE_HOST = 0,
+            NODE_TYPE_SOCKET,
+            NODE_TYPE_NUMA,
+            NODE_TYPE_ROOT_COMPLEX,     // i.e. pci0000:00
+            NODE_TYPE_BRIDGE,           // PCI bridge: root port or switch port
+            NODE_TYPE_DEVICE,
+        };
+
+        struct Link
+        {
+            // Links inside a root complex or switch (root complex to root port, switch upstream to
+            // downstream port) have no PCIe link and are treated as unlimited.
+            bool isInternal = true;
+            double speedGTs = 0.;       // Per lane; 0 if unknown
+            I32 gen = -1;
+            I32 width = -1;
+            double maxSpeedGTs = 0.;
+            I32 maxGen = -1;
+            I32 maxWidth = -1;
+            // Bytes/sec per direction after encoding overhead.  Infinity if internal, NaN if unknown.
+            double getBandwidth() const;
+        };
+
+        struct Node
+        {
+            UI32 id = 0;                // Index in getNodes()
+            NodeType type = NODE_TYPE_HOST;
+            String name;                // i.e. "0000:3b:00.0", "pci0000:00", "node1", "socket0"
+            I32 parent = -1;
+            std::vector<UI32> children;
+            Link uplink;                // Link to parent
+
+            // PCI nodes
+            PCIAddressType address;
+            UI32 classCode = 0;         // i.e. 0x030000 VGA, 0x060400 PCI bridge
+            UI32 vendorID = 0;
+            UI32 deviceID = 0;
+            I32 numaNode = -1;
+        };
+
+        PlatformGraph(const String& sysRoot = Sysfs::kDefaultSysRoot);
+
+        const std::vector<Node>& getNodes() const { return m_Nodes; }
+        const Node& getNode(UI32 id) const { return m_Nodes.at(id); }
+        std::optional<UI32> findNode(const PCIAddressType& address) const;
+        std::optional<UI32> findNode(const DevicePtr& device) const;
+
+        UI32 getCommonAncestor(UI32 a, UI32 b) const;
+        // Nodes from a up to the common ancestor and down to b
+        std::vector<UI32> getPath(UI32 a, UI32 b) const;
+
+        struct PeerPath
+        {
+            UI32 commonAncestor = 0;
+            NodeType commonAncestorType = NODE_TYPE_HOST;
+            UI32 numLinks = 0;          // Physical PCIe links traversed
+            double bottleneckBandwidth = std::numeric_limits<double>::quiet_NaN(); // Bytes/sec, see Link::getBandwidth()
+            // Traffic passes through a root complex (or further, between root complexes or sockets),
+            // where P2P may be slower or unsupported
+            bool viaRootComplex = false;
+            bool crossSocket = false;   // Only if both ends are known to be under different sockets
+        };
+        PeerPath getPeerPath(UI32 a, UI32 b) const;
+        double getBottleneckBandwidth(UI32 a, UI32 b) const { return getPeerPath(a, b).bottleneckBandwidth; }
+
+        // Partition devices into groups that can reach each other through a PCIe switch, without
+        // traversing a root complex.  Groups are sorted, and in the order of their first device.
+        std::vector<std::vector<UI32>> getP2PGroups(const std::vector<UI32>& devices) const;
+
+        void printInfo(std::ostream& ostr) const;
+
+    protected:
+        UI32 addNode(NodeType type, const String& name, I32 parent);
+        void setParent(UI32 child, UI32 parent);
+        void readPCINode(Node& node, const String& devPath) const;
+        UI32 getDepth(UI32 id) const;
+        void printNode(std::ostream& ostr, UI32 id, UI32 indent) const;
+
+        std::vector<Node> m_Nodes;
+    };
+} // XI
+
+#ifdef _WIN32
+#pragma warning(pop)
+#endif
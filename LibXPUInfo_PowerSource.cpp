@@ -0,0 +1,336 @@
+// Copyright (C) 2024 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "LibXPUInfo_PowerSource.h"
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#ifdef _WIN32
+#include <powerbase.h>
+#include <powersetting.h>
+#pragma comment(lib, "PowrProf.lib")
+#endif
+
+namespace XI
+{
+namespace
+{
+    const double kMicro = 1e-6;
+
+#ifndef _WIN32
+    std::optional<double> readScaled(const String& path, double scale)
+    {
+        auto val = Sysfs::readI64(path);
+        if (val.has_value())
+        {
+            return double(val.value()) * scale;
+        }
+        return std::nullopt;
+    }
+#endif
+}
+
+PowerState PowerState::read(const String& sysRoot)
+{
+    PowerState state;
+#ifdef _WIN32
+    (void)sysRoot;
+    SYSTEM_POWER_STATUS sps{};
+    if (GetSystemPowerStatus(&sps))
+    {
+        if (sps.ACLineStatus == 1)
+            state.source = SOURCE_AC;
+        else if (sps.ACLineStatus == 0)
+            state.source = SOURCE_BATTERY;
+        state.hasBattery = (sps.BatteryFlag != 255) && !(sps.BatteryFlag & 128); // 128: No system battery
+        if (state.hasBattery && (sps.BatteryLifePercent <= 100))
+        {
+            state.chargeFraction = sps.BatteryLifePercent / 100.;
+        }
+    }
+    SYSTEM_BATTERY_STATE sbs{};
+    if (state.hasBattery &&
+        (CallNtPowerInformation(SystemBatteryState, nullptr, 0, &sbs, sizeof(sbs)) == 0 /*STATUS_SUCCESS*/))
+    {
+        if (sbs.MaxCapacity)
+        {
+            state.chargeFraction = double(sbs.RemainingCapacity) / sbs.MaxCapacity;
+        }
+        const LONG rateMW = LONG(sbs.Rate); // Negative while discharging
+        if (sbs.Discharging && (rateMW < 0))
+        {
+            state.dischargeRateW = -rateMW * 1e-3;
+            state.timeToEmptyHours = sbs.RemainingCapacity * 1e-3 / state.dischargeRateW;
+        }
+    }
+#else
+    const String psDir = sysRoot + "/class/power_supply";
+    bool bACPresent = false, bACOnline = false, bDischarging = false;
+    double energyNow = 0., energyFull = 0., powerNow = 0.;
+    bool bHaveEnergy = true, bHavePower = false;
+    double capacitySum = 0.;
+    UI32 numBatteries = 0;
+    for (const auto& name : Sysfs::listEntries(psDir))
+    {
+        const String dir = psDir + "/" + name;
+        String type;
+        if (!Sysfs::readString(dir + "/type", type))
+        {
+            continue;
+        }
+        if (type == "Mains" || type.compare(0, 3, "USB") == 0)
+        {
+            bACPresent = true;
+            bACOnline |= Sysfs::readI64(dir + "/online").value_or(0) > 0;
+        }
+        else if (type == "Battery")
+        {
+            String scope;
+            if (Sysfs::readString(dir + "/scope", scope) && (scope == "Device"))
+            {
+                continue; // Peripheral (i.e. mouse) battery
+            }
+            if (Sysfs::readI64(dir + "/present").value_or(1) == 0)
+            {
+                continue;
+            }
+            ++numBatteries;
+            String status;
+            Sysfs::readString(dir + "/status", status);
+            const bool bBatDischarging = (status == "Discharging");
+            bDischarging |= bBatDischarging;
+
+            // Energy in uWh and power in uW, or charge in uAh and current in uA with voltage in uV
+            const double voltage = readScaled(dir + "/voltage_now", kMicro).value_or(0.);
+            auto eNow = readScaled(dir + "/energy_now", kMicro);
+            auto eFull = readScaled(dir + "/energy_full", kMicro);
+            if (!eNow || !eFull)
+            {
+                auto cNow = readScaled(dir + "/charge_now", kMicro);
+                auto cFull = readScaled(dir + "/charge_full", kMicro);
+                if (cNow && cFull && (voltage > 0.))
+                {
+                    eNow = *cNow * voltage;
+                    eFull = *cFull * voltage;
+                }
+            }
+            if (eNow && eFull && (*eFull > 0.))
+            {
+                energyNow += *eNow;
+                energyFull += *eFull;
+            }
+            else
+            {
+                bHaveEnergy = false;
+            }
+            capacitySum += Sysfs::readI64(dir + "/capacity").value_or(0) / 100.;
+
+            if (bBatDischarging)
+            {
+                auto power = readScaled(dir + "/power_now", kMicro);
+                if (!power)
+                {
+                    auto current = readScaled(dir + "/current_now", kMicro);
+                    if (current && (voltage > 0.))
+                    {
+                        power = std::fabs(*current) * voltage;
+                    }
+                }
+                if (power)
+                {
+                    powerNow += std::fabs(*power);
+                    bHavePower = true;
+                }
+            }
+        }
+    }
+
+    state.hasBattery = numBatteries > 0;
+    if (bACOnline)
+        state.source = SOURCE_AC;
+    else if (bDischarging || (state.hasBattery && bACPresent))
+        state.source = SOURCE_BATTERY;
+    else if (state.hasBattery)
+        state.source = SOURCE_AC; // Charging/full with no Mains supply listed
+    if (state.hasBattery)
+    {
+        state.chargeFraction = (bHaveEnergy && (energyFull > 0.)) ? energyNow / energyFull : capacitySum / numBatteries;
+        if (bDischarging && bHavePower && (powerNow > 0.))
+        {
+            state.dischargeRateW = powerNow;
+            if (bHaveEnergy)
+            {
+                state.timeToEmptyHours = energyNow / powerNow;
+            }
+        }
+    }
+#endif
+    return state;
+}
+
+std::ostream& operator<<(std::ostream& ostr, const PowerState& state)
+{
+    SaveRestoreIOSFlags sr(ostr);
+    switch (state.source)
+    {
+    case PowerState::SOURCE_AC: ostr << "AC"; break;
+    case PowerState::SOURCE_BATTERY: ostr << "Battery"; break;
+    default: ostr << "Unknown"; break;
+    }
+    if (state.hasBattery)
+    {
+        ostr << std::fixed << std::setprecision(1);
+        if (!std::isnan(state.chargeFraction))
+            ostr << ", charge " << state.chargeFraction * 100. << "%";
+        if (!std::isnan(state.dischargeRateW))
+            ostr << ", discharging " << state.dischargeRateW << " W";
+        if (!std::isnan(state.timeToEmptyHours))
+            ostr << ", " << state.timeToEmptyHours << " h remaining";
+    }
+    return ostr;
+}
+
+PowerSourceMonitor::PowerSourceMonitor(const Callback& onSourceChange, UI32 msPeriod, const String& sysRoot) :
+    m_Callback(onSourceChange), m_msPeriod(msPeriod), m_sysRoot(sysRoot)
+{
+    m_State = PowerState::read(m_sysRoot);
+#ifdef _WIN32
+    DEVICE_NOTIFY_SUBSCRIBE_PARAMETERS params{};
+    params.Callback = PowerSettingCallback;
+    params.Context = this;
+    HPOWERNOTIFY hNotify = nullptr;
+    if (PowerSettingRegisterNotification(&GUID_ACDC_POWER_SOURCE, DEVICE_NOTIFY_CALLBACK, &params, &hNotify) == ERROR_SUCCESS)
+    {
+        m_hNotify = hNotify;
+    }
+#else
+    XPUINFO_REQUIRE(m_msPeriod);
+    m_thread = std::thread([this]() { ThreadFunc(); });
+#endif
+}
+
+PowerSourceMonitor::~PowerSourceMonitor()
+{
+    stop();
+}
+
+void PowerSourceMonitor::stop()
+{
+#ifdef _WIN32
+    if (m_hNotify)
+    {
+        PowerSettingUnregisterNotification(HPOWERNOTIFY(m_hNotify));
+        m_hNotify = nullptr;
+    }
+#else
+    if (m_thread.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_bStop = true;
+        }
+        m_cv.notify_all();
+        m_thread.join();
+    }
+#endif
+}
+
+#ifdef _WIN32
+ULONG CALLBACK PowerSourceMonitor::PowerSettingCallback(PVOID context, ULONG type, PVOID /*setting*/)
+{
+    if (type == PBT_POWERSETTINGCHANGE)
+    {
+        // The setting has the new AC/DC value, but re-read everything for a consistent state
+        reinterpret_cast<PowerSourceMonitor*>(context)->update();
+    }
+    return 0;
+}
+#endif
+
+PowerState PowerSourceMonitor::getState() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_State;
+}
+
+void PowerSourceMonitor::update()
+{
+    PowerState current = PowerState::read(m_sysRoot);
+    PowerState previous;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        previous = m_State;
+        m_State = current;
+    }
+    if (m_Callback && (current.source != previous.source))
+    {
+        m_Callback(current, previous);
+    }
+}
+
+#ifndef _WIN32
+void PowerSourceMonitor::ThreadFunc()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_cv.wait_for(lock, std::chrono::milliseconds(m_msPeriod), [this]() { return m_bStop; }))
+    {
+        lock.unlock();
+        update();
+        lock.lock();
+    }
+}
+#endif
+
+ConstDevicePtrVec rankDevicesForPowerState(const XPUInfo& xpuInfo, const PowerState& state, const DeviceRankingParams& params)
+{
+    const bool bBattery = state.isOnBattery();
+    const bool bLowBattery = bBattery && !std::isnan(state.chargeFraction) && (state.chargeFraction <= params.lowBatteryFraction);
+
+    struct Ranked
+    {
+        DevicePtr device;
+        int powerClass;     // 0: NPU, 1: integrated/unknown GPU, 2: discrete GPU
+        bool preferred;     // IsMinimumPower on battery, IsHighPerformance on AC
+        I32 tdp;
+        double peakOps;
+    };
+    std::vector<Ranked> ranked;
+    for (const auto& [luid, device] : xpuInfo.getDeviceMap())
+    {
+        if (!(device->getType() & params.deviceTypes))
+        {
+            continue;
+        }
+        const auto& props = device->getProperties();
+        Ranked r;
+        r.device = device;
+        r.powerClass = (device->getType() == DEVICE_TYPE_NPU) ? 0 : ((props.UMA == NONUMA_DISCRETE) ? 2 : 1);
+        r.preferred = bBattery ? (props.IsMinimumPower > 0) : (props.IsHighPerformance > 0);
+        r.tdp = (props.PackageTDP > 0) ? props.PackageTDP : std::numeric_limits<I32>::max();
+        auto peak = device->getPeakThroughput();
+        r.peakOps = std::max({ peak.FP32, peak.FP16, peak.INT8 });
+        ranked.push_back(r);
+    }
+
+    std::stable_sort(ranked.begin(), ranked.end(), [bBattery, bLowBattery](const Ranked& a, const Ranked& b)
+        {
+            if (a.powerClass != b.powerClass)
+                return bBattery ? (a.powerClass < b.powerClass) : (a.powerClass > b.powerClass);
+            if (a.preferred != b.preferred)
+                return a.preferred;
+            if (bBattery && (a.tdp != b.tdp))
+                return a.tdp < b.tdp;
+            if (!bLowBattery && (a.peakOps != b.peakOps))
+                return a.peakOps > b.peakOps;
+            return false;
+        });
+
+    ConstDevicePtrVec devices(bBattery ? (bLowBattery ? "Preferred Devices (Low Battery)" : "Preferred Devices (Battery)") :
+        "Preferred Devices (AC)");
+    for (const auto& r : ranked)
+    {
+        devices.push_back(r.device);
+    }
+    return devices;
+}
+} // XI
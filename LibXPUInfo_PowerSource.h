@@ -0,0 +1,94 @@
+// Copyright (C) 2024 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+// Power source (AC/battery) state, and device ranking that follows it.
+//
+// DeviceProperties::IsMinimumPower/IsHighPerformance are static (and DXCore-only); these let a
+// selector prefer an NPU or integrated GPU on battery and a discrete GPU on AC.  On Linux, state is
+// read from class/power_supply relative to a caller-provided sysfs root.  On Windows it comes from
+// GetSystemPowerStatus and the SystemBatteryState power information.
+
+#pragma once
+#include "LibXPUInfo.h"
+#include "LibXPUInfo_Util.h"
+
+#ifdef _WIN32
+#pragma warning(push)
+#pragma warning(disable : 4251)
+#endif
+
+namespace XI
+{
+    struct XPUINFO_EXPORT PowerState
+    {
+        enum Source : UI32
+        {
+            SOURCE_UNKNOWN = 0,
+            SOURCE_AC,
+            SOURCE_BATTERY,
+        };
+        Source source = SOURCE_UNKNOWN;
+        bool hasBattery = false;
+        // Over all system batteries (not peripherals)
+        double chargeFraction = std::numeric_limits<double>::quiet_NaN();   // [0,1]
+        double dischargeRateW = std::numeric_limits<double>::quiet_NaN();   // While discharging
+        double timeToEmptyHours = std::numeric_limits<double>::quiet_NaN();
+
+        bool isOnBattery() const { return source == SOURCE_BATTERY; }
+        // Read current state.  sysRoot is ignored on Windows.
+        static PowerState read(const String& sysRoot = Sysfs::kDefaultSysRoot);
+    };
+    XPUINFO_EXPORT std::ostream& operator<<(std::ostream& ostr, const PowerState& state);
+
+    // Calls back when the power source changes (AC <-> battery).  On Windows this uses the
+    // GUID_ACDC_POWER_SOURCE power setting notification; on Linux, power_supply is polled every msPeriod.
+    class XPUINFO_EXPORT PowerSourceMonitor : public NoCopyAssign
+    {
+    public:
+        typedef std::function<void(const PowerState& current, const PowerState& previous)> Callback;
+
+        PowerSourceMonitor(const Callback& onSourceChange, UI32 msPeriod = 2000,
+            const String& sysRoot = Sysfs::kDefaultSysRoot);
+        ~PowerSourceMonitor();
+
+        // Last state read; charge and discharge rate are refreshed each period on Linux, on change on Windows
+        PowerState getState() const;
+        void stop();
+
+    protected:
+        void update();
+
+        const Callback m_Callback;
+        const UI32 m_msPeriod;
+        const String m_sysRoot;
+        mutable std::mutex m_mutex;
+        PowerState m_State;
+#ifdef _WIN32
+        static ULONG CALLBACK PowerSettingCallback(PVOID context, ULONG type, PVOID setting);
+        void* m_hNotify = nullptr;          // HPOWERNOTIFY
+#else
+        void ThreadFunc();
+        std::thread m_thread;
+        std::condition_variable m_cv;
+        bool m_bStop = false;
+#endif
+    };
+
+    struct XPUINFO_EXPORT DeviceRankingParams
+    {
+        UI32 deviceTypes = DEVICE_TYPE_GPU | DEVICE_TYPE_NPU;  // DeviceType mask
+        // At or below this charge, devices are ranked for lowest power only, ignoring throughput
+        double lowBatteryFraction = 0.2;
+    };
+
+    // Devices of xpuInfo ordered for the power state, most preferred first.
+    // On battery: NPU, integrated GPU, discrete GPU; then devices marked minimum-power, lower TDP, and
+    // (unless the battery is low) higher peak throughput.
+    // On AC (or unknown): discrete GPU, integrated GPU, NPU; then devices marked high-performance and higher peak throughput.
+    XPUINFO_EXPORT ConstDevicePtrVec rankDevicesForPowerState(const XPUInfo& xpuInfo, const PowerState& state,
+        const DeviceRankingParams& params = DeviceRankingParams());
+} // XI
+
+#ifdef _WIN32
+#pragma warning(pop)
+#endif
@@ -0,0 +1,568 @@
+// Copyright (C) 2024 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#include "LibXPUInfo_ResCtrl.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/syscall.h>
+#endif
+
+namespace XI
+{
+namespace
+{
+    std::optional<UI64> readHex(const String& path)
+    {
+        String str;
+        if (Sysfs::readString(path, str) && str.size())
+        {
+            char* pEnd = nullptr;
+            UI64 val = std::strtoull(str.c_str(), &pEnd, 16);
+            if (pEnd != str.c_str())
+            {
+                return val;
+            }
+        }
+        return std::nullopt;
+    }
+
+    UI32 countBits(UI64 v)
+    {
+        UI32 n = 0;
+        for (; v; v &= v - 1)
+        {
+            ++n;
+        }
+        return n;
+    }
+
+    bool isReservedEntry(const String& name)
+    {
+        return (name == "info") || (name == "mon_groups") || (name == "mon_data");
+    }
+}
+
+ResCtrl::ResCtrl(const String& root) : m_root(root)
+{
+    readInfo();
+}
+
+void ResCtrl::readInfo()
+{
+    const String infoDir = m_root + "/info";
+    for (const auto& res : Sysfs::listEntries(infoDir))
+    {
+        const String resDir = infoDir + "/" + res;
+        if (res == "MB")
+        {
+            MemBWAllocCaps mb;
+            mb.numCLOSIDs = UI32(Sysfs::readUI64(resDir + "/num_closids").value_or(0));
+            mb.bandwidthGran = UI32(Sysfs::readUI64(resDir + "/bandwidth_gran").value_or(0));
+            mb.minBandwidth = UI32(Sysfs::readUI64(resDir + "/min_bandwidth").value_or(0));
+            mb.delayLinear = Sysfs::readUI64(resDir + "/delay_linear").value_or(0) != 0;
+            if (mb.numCLOSIDs)
+            {
+                m_MBCaps = mb;
+            }
+        }
+        else if (res == "L3_MON")
+        {
+            MonitorCaps mon;
+            mon.numRMIDs = UI32(Sysfs::readUI64(resDir + "/num_rmids").value_or(0));
+            String features;
+            if (Sysfs::readString(resDir + "/mon_features", features))
+            {
+                std::istringstream istr(features);
+                String f;
+                while (istr >> f)
+                {
+                    mon.features.push_back(f);
+                }
+            }
+            m_MonCaps = mon;
+        }
+        else
+        {
+            auto cbmMask = readHex(resDir + "/cbm_mask");
+            if (cbmMask.has_value())
+            {
+                CacheAllocCaps cache;
+                cache.resource = res;
+                cache.cbmMask = cbmMask.value();
+                cache.numWays = countBits(cache.cbmMask);
+                cache.numCLOSIDs = UI32(Sysfs::readUI64(resDir + "/num_closids").value_or(0));
+                cache.minCBMBits = UI32(Sysfs::readUI64(resDir + "/min_cbm_bits").value_or(1));
+                cache.shareableBits = readHex(resDir + "/shareable_bits").value_or(0);
+                m_CacheCaps.push_back(cache);
+            }
+        }
+    }
+}
+
+const ResCtrl::CacheAllocCaps* ResCtrl::getCacheAllocCaps(const String& resource) const
+{
+    for (const auto& c : m_CacheCaps)
+    {
+        if (c.resource == resource)
+        {
+            return &c;
+        }
+    }
+    return nullptr;
+}
+
+void ResCtrl::printInfo(std::ostream& ostr) const
+{
+    SaveRestoreIOSFlags srFlags(ostr);
+    ostr << "resctrl (" << m_root << "):\n";
+    for (const auto& c : m_CacheCaps)
+    {
+        ostr << "\t" << c.resource << ": " << c.numWays << " ways (cbm_mask=0x" << std::hex << c.cbmMask
+             << ", shareable=0x" << c.shareableBits << std::dec << "), min_cbm_bits=" << c.minCBMBits
+             << ", CLOSIDs=" << c.numCLOSIDs << std::endl;
+    }
+    if (m_MBCaps.has_value())
+    {
+        ostr << "\tMB: granularity=" << m_MBCaps->bandwidthGran << "%, min=" << m_MBCaps->minBandwidth
+             << "%, CLOSIDs=" << m_MBCaps->numCLOSIDs << (m_MBCaps->delayLinear ? ", linear" : ", non-linear") << std::endl;
+    }
+    if (m_MonCaps.has_value())
+    {
+        ostr << "\tMonitoring: RMIDs=" << m_MonCaps->numRMIDs << ", features:";
+        for (const auto& f : m_MonCaps->features)
+        {
+            ostr << " " << f;
+        }
+        ostr << std::endl;
+    }
+}
+
+bool ResCtrl::parseSchemata(const String& text, Schemata& schemata)
+{
+    // Lines are "<resource>:<domain>=<value>;<domain>=<value>...", with leading whitespace for alignment
+    schemata.clear();
+    std::istringstream istr(text);
+    String line;
+    while (std::getline(istr, line))
+    {
+        auto first = line.find_first_not_of(" \t");
+        if (first == String::npos)
+        {
+            continue;
+        }
+        auto colon = line.find(':', first);
+        if (colon == String::npos)
+        {
+            return false;
+        }
+        const String resource = line.substr(first, colon - first);
+        const int base = isBandwidthResource(resource) ? 10 : 16;
+        auto& domains = schemata[resource];
+        std::istringstream dstr(line.substr(colon + 1));
+        String item;
+        while (std::getline(dstr, item, ';'))
+        {
+            auto eq = item.find('=');
+            if (eq == String::npos)
+            {
+                return false;
+            }
+            char* pEnd = nullptr;
+            UI32 domain = UI32(std::strtoul(item.c_str(), &pEnd, 10));
+            if (pEnd == item.c_str())
+            {
+                return false;
+            }
+            const char* pVal = item.c_str() + eq + 1;
+            UI64 value = std::strtoull(pVal, &pEnd, base);
+            if (pEnd == pVal)
+            {
+                return false;
+            }
+            domains[domain] = value;
+        }
+    }
+    return true;
+}
+
+String ResCtrl::formatSchemata(const Schemata& schemata)
+{
+    std::ostringstream ostr;
+    for (const auto& [resource, domains] : schemata)
+    {
+        ostr << resource << ":";
+        const bool bDecimal = isBandwidthResource(resource);
+        const char* sep = "";
+        for (const auto& [domain, value] : domains)
+        {
+            ostr << sep << domain << "=";
+            if (bDecimal)
+            {
+                ostr << value;
+            }
+            else
+            {
+                ostr << std::hex << value << std::dec;
+            }
+            sep = ";";
+        }
+        ostr << "\n";
+    }
+    return ostr.str();
+}
+
+UI64 ResCtrl::makeCBM(const CacheAllocCaps& caps, UI32 numWays, UI32 firstWay)
+{
+    if ((numWays < caps.minCBMBits) || (numWays + firstWay > caps.numWays) || (numWays >= 64))
+    {
+        return 0;
+    }
+    // cbm_mask is contiguous from bit 0 on all known implementations
+    UI64 cbm = ((UI64(1) << numWays) - 1) << firstWay;
+    return ((cbm & caps.cbmMask) == cbm) ? cbm : 0;
+}
+
+String ResCtrl::getGroupPath(const String& group) const
+{
+    return group.empty() ? m_root : m_root + "/" + group;
+}
+
+std::vector<String> ResCtrl::getGroups() const
+{
+    std::vector<String> groups;
+    for (const auto& name : Sysfs::listEntries(m_root))
+    {
+        std::error_code ec;
+        if (!isReservedEntry(name) && std::filesystem::is_directory(m_root + "/" + name, ec))
+        {
+            groups.push_back(name);
+        }
+    }
+    return groups;
+}
+
+bool ResCtrl::hasGroup(const String& group) const
+{
+    std::error_code ec;
+    return group.empty() || std::filesystem::is_directory(getGroupPath(group), ec);
+}
+
+bool ResCtrl::createGroup(const String& group)
+{
+    XPUINFO_REQUIRE_MSG(!group.empty() && (group.find('/') == String::npos) && !isReservedEntry(group),
+        "Invalid resctrl group name");
+    std::error_code ec;
+    return std::filesystem::create_directory(getGroupPath(group), ec) && !ec;
+}
+
+bool ResCtrl::removeGroup(const String& group)
+{
+    XPUINFO_REQUIRE_MSG(!group.empty(), "Cannot remove the default resctrl group");
+    std::error_code ec;
+    // rmdir on resctrl succeeds despite the kernel-provided files in the group directory
+    return std::filesystem::remove(getGroupPath(group), ec) && !ec;
+}
+
+bool ResCtrl::readSchemata(const String& group, Schemata& schemata) const
+{
+    String text;
+    return Sysfs::readString(getGroupPath(group) + "/schemata", text) && parseSchemata(text, schemata);
+}
+
+bool ResCtrl::writeSchemata(const String& group, const Schemata& schemata)
+{
+    // One resource per write, so an error in one line is reported (and the rest still applied)
+    bool bOK = true;
+    for (const auto& res : schemata)
+    {
+        Schemata one;
+        one.insert(res);
+        bOK = Sysfs::writeString(getGroupPath(group) + "/schemata", formatSchemata(one)) && bOK;
+    }
+    return bOK;
+}
+
+bool ResCtrl::setCacheWays(const String& group, UI64 cbm, const String& resource)
+{
+    Schemata cur;
+    if (!readSchemata(group, cur) || !cur.count(resource))
+    {
+        return false;
+    }
+    Schemata s;
+    for (const auto& [domain, value] : cur[resource])
+    {
+        s[resource][domain] = cbm;
+    }
+    return writeSchemata(group, s);
+}
+
+bool ResCtrl::setMemBandwidth(const String& group, UI32 value)
+{
+    Schemata cur;
+    if (!readSchemata(group, cur) || !cur.count("MB"))
+    {
+        return false;
+    }
+    Schemata s;
+    for (const auto& [domain, v] : cur["MB"])
+    {
+        s["MB"][domain] = value;
+    }
+    return writeSchemata(group, s);
+}
+
+std::vector<UI64> ResCtrl::getTasks(const String& group) const
+{
+    std::vector<UI64> tids;
+    std::ifstream ifs(getGroupPath(group) + "/tasks");
+    UI64 tid;
+    while (ifs >> tid)
+    {
+        tids.push_back(tid);
+    }
+    return tids;
+}
+
+std::vector<UI32> ResCtrl::getCPUs(const String& group) const
+{
+    String cpuList;
+    if (Sysfs::readString(getGroupPath(group) + "/cpus_list", cpuList))
+    {
+        return Sysfs::parseCPUList(cpuList);
+    }
+    return {};
+}
+
+bool ResCtrl::assignTasks(const String& group, const std::vector<UI64>& tids)
+{
+    // The kernel accepts a single task id per write
+    bool bOK = true;
+    for (auto tid : tids)
+    {
+        bOK = Sysfs::writeString(getGroupPath(group) + "/tasks", std::to_string(tid)) && bOK;
+    }
+    return bOK;
+}
+
+bool ResCtrl::setCPUs(const String& group, const std::vector<UI32>& cpus)
+{
+    return Sysfs::writeString(getGroupPath(group) + "/cpus_list", Sysfs::formatCPUList(cpus));
+}
+
+std::optional<String> ResCtrl::findGroupOfTask(UI64 tid) const
+{
+    for (const auto& group : getGroups())
+    {
+        auto tids = getTasks(group);
+        if (std::find(tids.begin(), tids.end(), tid) != tids.end())
+        {
+            return group;
+        }
+    }
+    auto tids = getTasks(String());
+    if (std::find(tids.begin(), tids.end(), tid) != tids.end())
+    {
+        return String();
+    }
+    return std::nullopt;
+}
+
+UI64 ResCtrl::getCurrentThreadID()
+{
+#if defined(__linux__)
+    return UI64(syscall(SYS_gettid));
+#elif defined(_WIN32)
+    return GetCurrentThreadId();
+#else
+    return 0;
+#endif
+}
+
+ResCtrlMonitor::ResCtrlMonitor(const std::vector<String>& groups, const String& root) :
+    m_root(root), m_groups(groups), m_counters(groups.size())
+{
+    for (size_t i = 0; i < m_groups.size(); ++i)
+    {
+        const String monDir = (m_groups[i].empty() ? m_root : m_root + "/" + m_groups[i]) + "/mon_data";
+        for (const auto& dom : Sysfs::listEntries(monDir, "mon_L3_"))
+        {
+            m_counters[i].domainDirs.push_back(monDir + "/" + dom);
+        }
+    }
+    // First sample establishes counter baselines
+    sample();
+}
+
+bool ResCtrlMonitor::isSupported() const
+{
+    for (const auto& c : m_counters)
+    {
+        if (c.domainDirs.size())
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+const ResCtrlMonitor::Sample& ResCtrlMonitor::sample()
+{
+    Sample s;
+    TimerTick now = Timer::GetNow();
+    if (m_bHavePrev)
+    {
+        s.intervalSecs = Timer::GetSecsBetween(m_prevTime, now);
+    }
+
+    // MBM counters are cumulative bytes (the kernel extends the hardware counter width);
+    // a decrease means the group was recreated, so no rate is reported for that interval.
+    auto getRate = [&s](const std::optional<UI64>& prev, const std::optional<UI64>& cur)
+    {
+        if (prev.has_value() && cur.has_value() && (cur.value() >= prev.value()) && (s.intervalSecs > 0.))
+        {
+            return (cur.value() - prev.value()) / s.intervalSecs;
+        }
+        return std::numeric_limits<double>::quiet_NaN();
+    };
+
+    s.groups.resize(m_groups.size());
+    for (size_t i = 0; i < m_groups.size(); ++i)
+    {
+        auto& c = m_counters[i];
+        auto& g = s.groups[i];
+        std::optional<UI64> occupancy, mbmTotal, mbmLocal;
+        auto accumulate = [](std::optional<UI64>& sum, const std::optional<UI64>& v)
+        {
+            if (v.has_value())
+            {
+                sum = sum.value_or(0) + v.value();
+            }
+        };
+        for (const auto& dir : c.domainDirs)
+        {
+            // Files contain "Unavailable" or "Error" when an RMID can't be read
+            accumulate(occupancy, Sysfs::readUI64(dir + "/llc_occupancy"));
+            accumulate(mbmTotal, Sysfs::readUI64(dir + "/mbm_total_bytes"));
+            accumulate(mbmLocal, Sysfs::readUI64(dir + "/mbm_local_bytes"));
+        }
+        g.valid = occupancy.has_value() || mbmTotal.has_value() || mbmLocal.has_value();
+        g.llcOccupancyBytes = occupancy.value_or(0);
+        g.mbmTotalBytesPerSec = getRate(c.mbmTotal, mbmTotal);
+        g.mbmLocalBytesPerSec = getRate(c.mbmLocal, mbmLocal);
+        c.mbmTotal = mbmTotal;
+        c.mbmLocal = mbmLocal;
+    }
+
+    m_prevTime = now;
+    m_bHavePrev = true;
+    m_Last = std::move(s);
+    return m_Last;
+}
+
+ResCtrlGroupGuard::ResCtrlGroupGuard(ResCtrl& resctrl, const Params& params) :
+    m_ResCtrl(resctrl), m_group(params.group)
+{
+    bool bOK = true;
+    if (!m_ResCtrl.hasGroup(m_group))
+    {
+        if (!params.createIfMissing || !m_ResCtrl.createGroup(m_group))
+        {
+            return;
+        }
+        m_bCreated = true;
+    }
+
+    if (params.schemata.has_value())
+    {
+        if (!m_bCreated)
+        {
+            ResCtrl::Schemata prev;
+            if (m_ResCtrl.readSchemata(m_group, prev))
+            {
+                m_prevSchemata = prev;
+            }
+        }
+        bOK = m_ResCtrl.writeSchemata(m_group, params.schemata.value()) && bOK;
+    }
+
+    if (params.cpus.size())
+    {
+        // Adding CPUs to a group removes them from other groups, so save all affected lists.
+        // getGroups() omits the default group.
+        for (const auto& g : m_ResCtrl.getGroups())
+        {
+            m_prevCPUs[g] = m_ResCtrl.getCPUs(g);
+        }
+        m_prevCPUs[String()] = m_ResCtrl.getCPUs(String());
+        auto cpus = m_prevCPUs[m_group];
+        cpus.insert(cpus.end(), params.cpus.begin(), params.cpus.end());
+        std::sort(cpus.begin(), cpus.end());
+        cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+        bOK = m_ResCtrl.setCPUs(m_group, cpus) && bOK;
+    }
+
+    for (auto tid : params.tids)
+    {
+        auto prevGroup = m_ResCtrl.findGroupOfTask(tid);
+        m_prevTaskGroups[tid] = prevGroup.value_or(String());
+        bOK = m_ResCtrl.assignTasks(m_group, { tid }) && bOK;
+    }
+    m_bApplied = bOK;
+}
+
+ResCtrlGroupGuard::~ResCtrlGroupGuard()
+{
+    restore();
+}
+
+void ResCtrlGroupGuard::restore()
+{
+    if (m_bRestored)
+    {
+        return;
+    }
+    m_bRestored = true;
+
+    for (const auto& [tid, group] : m_prevTaskGroups)
+    {
+        if (m_ResCtrl.hasGroup(group))
+        {
+            m_ResCtrl.assignTasks(group, { tid });
+        }
+    }
+
+    if (m_bCreated)
+    {
+        // Removing the group returns its CPUs to the default group; tasks were moved back above
+        m_ResCtrl.removeGroup(m_group);
+    }
+    else
+    {
+        // The kernel does not drop CPUs from the default group; they return when the other groups are restored
+        if (!m_group.empty() && m_prevCPUs.count(m_group))
+        {
+            m_ResCtrl.setCPUs(m_group, m_prevCPUs[m_group]);
+        }
+        if (m_prevSchemata.has_value())
+        {
+            m_ResCtrl.writeSchemata(m_group, m_prevSchemata.value());
+        }
+    }
+
+    // Give back CPUs taken from other groups
+    for (const auto& [group, cpus] : m_prevCPUs)
+    {
+        if ((group != m_group) && !group.empty() && m_ResCtrl.hasGroup(group) && (m_ResCtrl.getCPUs(group) != cpus))
+        {
+            m_ResCtrl.setCPUs(group, cpus);
+        }
+    }
+}
+
+} // XI
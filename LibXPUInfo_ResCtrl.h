@@ -0,0 +1,188 @@
+// Copyright (C) 2024 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+// Linux resctrl (Intel RDT / AMD PQoS) cache and memory-bandwidth allocation.
+//
+// Operates on a mounted resctrl filesystem (default /sys/fs/resctrl), or on a directory tree with the
+// same layout.  Writes rely on the kernel's side effects (schemata writes merge, tasks and CPUs move
+// between groups); the modifying operations are virtual so a test can emulate them on a plain tree.
+// Group names are directory names under the root; the empty string refers to the default (root) group.
+// Modifying operations require root privileges on a real system and return false on failure rather
+// than throwing.
+
+#pragma once
+#include "LibXPUInfo.h"
+#include "LibXPUInfo_Util.h"
+
+#ifdef _WIN32
+#pragma warning(push)
+#pragma warning(disable : 4251)
+#endif
+
+namespace XI
+{
+    class XPUINFO_EXPORT ResCtrl : public NoCopyAssign
+    {
+    public:
+        static constexpr const char* kDefaultRoot = "/sys/fs/resctrl";
+
+        ResCtrl(const String& root = kDefaultRoot);
+        virtual ~ResCtrl() = default;
+
+        // Cache allocation (CAT) capabilities, from info/<resource>, i.e. L3, L2, L3CODE/L3DATA (CDP)
+        struct CacheAllocCaps
+        {
+            String resource;
+            UI32 numCLOSIDs = 0;
+            UI64 cbmMask = 0;       // Valid capacity bitmask; one bit per way
+            UI32 numWays = 0;
+            UI32 minCBMBits = 1;
+            UI64 shareableBits = 0; // Ways that may be used by other agents (i.e. I/O)
+        };
+        // Memory bandwidth allocation (MBA) capabilities, from info/MB
+        struct MemBWAllocCaps
+        {
+            UI32 numCLOSIDs = 0;
+            UI32 bandwidthGran = 0; // Percent
+            UI32 minBandwidth = 0;  // Percent
+            bool delayLinear = false;
+        };
+        // Monitoring capabilities, from info/L3_MON
+        struct MonitorCaps
+        {
+            UI32 numRMIDs = 0;
+            std::vector<String> features; // i.e. llc_occupancy, mbm_total_bytes, mbm_local_bytes
+        };
+
+        bool isSupported() const { return m_CacheCaps.size() || m_MBCaps.has_value(); }
+        const std::vector<CacheAllocCaps>& getCacheAllocCaps() const { return m_CacheCaps; }
+        const CacheAllocCaps* getCacheAllocCaps(const String& resource) const;
+        const std::optional<MemBWAllocCaps>& getMemBWAllocCaps() const { return m_MBCaps; }
+        const std::optional<MonitorCaps>& getMonitorCaps() const { return m_MonCaps; }
+        const String& getRoot() const { return m_root; }
+        void printInfo(std::ostream& ostr) const;
+
+        // Per-resource, per-domain (cache id / NUMA node) values, as in the schemata file.
+        // Cache resources hold capacity bitmasks, MB holds a percentage (or MBps with mba_MBps).
+        typedef std::map<UI32, UI64> DomainValues;
+        typedef std::map<String, DomainValues> Schemata;
+        static bool parseSchemata(const String& text, Schemata& schemata);
+        static String formatSchemata(const Schemata& schemata);
+        static bool isBandwidthResource(const String& resource) { return (resource == "MB") || (resource == "SMBA"); }
+
+        // Contiguous bitmask of numWays ways, starting at firstWay.  Returns 0 if it doesn't fit in caps.
+        static UI64 makeCBM(const CacheAllocCaps& caps, UI32 numWays, UI32 firstWay = 0);
+
+        std::vector<String> getGroups() const;
+        bool hasGroup(const String& group) const;
+        bool createGroup(const String& group);
+        virtual bool removeGroup(const String& group); // Tasks and CPUs of the group return to the default group
+
+        bool readSchemata(const String& group, Schemata& schemata) const;
+        // Only the resources/domains present in schemata are changed
+        virtual bool writeSchemata(const String& group, const Schemata& schemata);
+        // Set the same value for all domains of resource
+        bool setCacheWays(const String& group, UI64 cbm, const String& resource = "L3");
+        bool setMemBandwidth(const String& group, UI32 value);
+
+        std::vector<UI64> getTasks(const String& group) const;
+        std::vector<UI32> getCPUs(const String& group) const;
+        // Moves tasks (thread ids) into group, removing them from their current group
+        virtual bool assignTasks(const String& group, const std::vector<UI64>& tids);
+        // Sets the CPUs of group; CPUs removed from a group return to the default group
+        virtual bool setCPUs(const String& group, const std::vector<UI32>& cpus);
+        // Group the task currently belongs to, or std::nullopt if not found
+        std::optional<String> findGroupOfTask(UI64 tid) const;
+
+        static UI64 getCurrentThreadID();
+
+    protected:
+        String getGroupPath(const String& group) const;
+        void readInfo();
+
+        const String m_root;
+        std::vector<CacheAllocCaps> m_CacheCaps;
+        std::optional<MemBWAllocCaps> m_MBCaps;
+        std::optional<MonitorCaps> m_MonCaps;
+    };
+
+    // LLC occupancy and memory bandwidth (MBM) of resctrl monitoring groups, from mon_data/mon_L3_*.
+    // Groups are paths relative to the resctrl root: "" (default group), "<ctrl_group>", or
+    // "<ctrl_group>/mon_groups/<mon_group>".  Values are summed over L3 domains (sockets/SNC nodes).
+    class XPUINFO_EXPORT ResCtrlMonitor : public NoCopyAssign
+    {
+    public:
+        ResCtrlMonitor(const std::vector<String>& groups, const String& root = ResCtrl::kDefaultRoot);
+
+        // True if at least one group has readable mon_data
+        bool isSupported() const;
+        const std::vector<String>& getGroups() const { return m_groups; }
+
+        struct GroupSample
+        {
+            bool valid = false;             // False if group has no readable counters (i.e. "Unavailable")
+            UI64 llcOccupancyBytes = 0;
+            // Rates from counter deltas since previous sample; NaN for first sample or if unsupported
+            double mbmTotalBytesPerSec = std::numeric_limits<double>::quiet_NaN();
+            double mbmLocalBytesPerSec = std::numeric_limits<double>::quiet_NaN();
+        };
+        struct Sample
+        {
+            double intervalSecs = 0.;
+            std::vector<GroupSample> groups; // Same order as getGroups()
+        };
+
+        const Sample& sample();
+        const Sample& getLastSample() const { return m_Last; }
+
+    protected:
+        struct GroupCounters
+        {
+            std::vector<String> domainDirs;  // Absolute mon_data/mon_L3_XX paths
+            std::optional<UI64> mbmTotal, mbmLocal;
+        };
+
+        const String m_root;
+        const std::vector<String> m_groups;
+        std::vector<GroupCounters> m_counters;
+        TimerTick m_prevTime{};
+        bool m_bHavePrev = false;
+        Sample m_Last;
+    };
+
+    // Assigns threads and/or CPUs to a resource group for the lifetime of the guard, optionally
+    // creating the group and setting its schemata.  On destruction, tasks are moved back to their
+    // previous groups, CPU lists and schemata are restored, and a group created by the guard is removed.
+    class XPUINFO_EXPORT ResCtrlGroupGuard : public NoCopyAssign
+    {
+    public:
+        struct Params
+        {
+            String group;
+            std::vector<UI64> tids;             // Threads to assign
+            std::vector<UI32> cpus;             // CPUs to add to the group
+            std::optional<ResCtrl::Schemata> schemata;
+            bool createIfMissing = true;
+        };
+        ResCtrlGroupGuard(ResCtrl& resctrl, const Params& params);
+        ~ResCtrlGroupGuard();
+
+        // True if all requested changes were applied.  Partial changes are still restored.
+        bool isApplied() const { return m_bApplied; }
+        void restore();
+
+    protected:
+        ResCtrl& m_ResCtrl;
+        const String m_group;
+        bool m_bApplied = false;
+        bool m_bCreated = false;
+        bool m_bRestored = false;
+        std::map<UI64, String> m_prevTaskGroups;
+        std::map<String, std::vector<UI32>> m_prevCPUs;    // Groups whose CPU lists were changed
+        std::optional<ResCtrl::Schemata> m_prevSchemata;
+    };
+} // XI
+
+#ifdef _WIN32
+#pragma warning(pop)
+#endif
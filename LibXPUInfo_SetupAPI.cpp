@@ -99,6 +99,17 @@ namespace
 		}
 		return bRet;
 	}
+
+	bool sdiGetProp(HDEVINFO info, std::vector<wchar_t>& tempBuf, PSP_DEVINFO_DATA pDID, const DEVPROPKEY* pDPK, XI::PooledWString& outStr)
+	{
+		XI::WString str;
+		bool bRet = sdiGetProp(info, tempBuf, pDID, pDPK, str);
+		if (bRet)
+		{
+			outStr = str;
+		}
+		return bRet;
+	}
 }
 
 namespace XI
@@ -264,6 +275,21 @@ namespace //private
 				}
 			}
 
+			UI32 numaNode = 0;
+			if (SetupDiGetDevicePropertyW(
+				m_info,
+				&devInfoData,
+				&DEVPKEY_Device_Numa_Node,
+				&PropType,
+				(PBYTE)&numaNode,
+				(DWORD)sizeof(numaNode),
+				&nameSize,
+				0) && (PropType == DEVPROP_TYPE_UINT32))
+			{
+				curInfo->NumaNode = (I32)numaNode;
+				dStr << ", NUMA node " << numaNode;
+			}
+
 			// For Intel, this might be an unofficial way to find the "GT Generation"
 			if (sdiGetProp(m_info, tempStr, &devInfoData, &DEVPKEY_Device_DriverInfSection, curInfo->DriverInfSection))
 			{
@@ -0,0 +1,169 @@
+// Copyright (C) 2024 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#ifdef XPUINFO_USE_TELEMETRYTRACKER
+#include "LibXPUInfo_TelemetryBottleneck.h"
+#include "LibXPUInfo_TelemetryQuery.h"
+#include <algorithm>
+#include <cmath>
+
+namespace XI
+{
+namespace
+{
+    struct Mean
+    {
+        double sum = 0.;
+        UI32 count = 0;
+
+        void add(double value)
+        {
+            if (std::isfinite(value))
+            {
+                sum += value;
+                ++count;
+            }
+        }
+        double get() const { return count ? sum / count : std::numeric_limits<double>::quiet_NaN(); }
+    };
+}
+
+const char* TelemetryBottleneckClassifier::getBottleneckName(Bottleneck bottleneck)
+{
+    switch (bottleneck)
+    {
+    case BOTTLENECK_IDLE: return "Idle";
+    case BOTTLENECK_DEVICE_COMPUTE: return "Device compute";
+    case BOTTLENECK_DEVICE_MEMORY: return "Device memory";
+    case BOTTLENECK_HOST: return "Host";
+    case BOTTLENECK_TRANSFER: return "Transfer";
+    default: return "Unknown";
+    }
+}
+
+TelemetryBottleneckClassifier::TelemetryBottleneckClassifier() : m_Params()
+{
+}
+
+TelemetryBottleneckClassifier::TelemetryBottleneckClassifier(const Params& params) : m_Params(params)
+{
+    XPUINFO_REQUIRE_MSG((params.saturation > 0.) && (params.saturation <= 1.), "saturation must be in (0, 1]");
+}
+
+TelemetryBottleneckClassifier::Result TelemetryBottleneckClassifier::classify(const TelemetryWindow& window) const
+{
+    typedef TelemetryTracker T;
+    const TelemetryTracker& tracker = window.getTracker();
+    const UI32 mask = tracker.m_ResultMask;
+    const DevicePtr& pDevice = tracker.getDevice();
+
+    double peakBW = m_Params.peakMemBWBytesPerSec;
+    double freqMax = -1.;
+    if (pDevice)
+    {
+        if (peakBW <= 0.)
+        {
+            peakBW = double(pDevice->getProperties().MemoryBandWidthMax);
+        }
+        freqMax = pDevice->getProperties().FreqMaxMHz;
+    }
+
+    Mean compute, global, media, memBW, freq, host;
+    window.forEach([&](const T::TimedRecord& rec)
+        {
+            compute.add(rec.activityComputePct);
+            global.add(rec.activityGlobalPct);
+            media.add(rec.activityMediaPct);
+            if (peakBW > 0.)
+            {
+                memBW.add((rec.readBWBytesPerSec + rec.writeBWBytesPerSec) / peakBW);
+            }
+            if ((mask & T::TELEMETRYITEM_FREQUENCY) && (freqMax > 0.))
+            {
+                freq.add(rec.freq / freqMax);
+            }
+#if defined(_WIN32) && !defined(_M_ARM64)
+            host.add(rec.pctCPU);
+#else
+            if (mask & T::TELEMETRYITEM_CPU_IDLE)
+            {
+                host.add(rec.cpuBusiestPct);
+            }
+#endif
+        });
+
+    Result result;
+    result.numSamples = UI32(window.size());
+    // Without separate compute activity (i.e. NVML), global activity stands in for it
+    result.deviceComputeUtil = (compute.count ? compute.get() : global.get()) / 100.;
+    result.deviceMemBWUtil = memBW.get();
+    result.deviceCopyUtil = (compute.count && global.count) ?
+        std::max(0., global.get() - std::max(compute.get(), media.count ? media.get() : 0.)) / 100. :
+        std::numeric_limits<double>::quiet_NaN();
+    result.deviceFreqRatio = freq.get();
+    result.hostUtil = host.get() / 100.;
+    if (!compute.count && !global.count && !memBW.count && !host.count)
+    {
+        return result; // Nothing measured, so not even idle
+    }
+
+    // Unknown features do not contribute
+    const auto saturated = [this](double util)
+    {
+        return std::isfinite(util) ? std::min(1., std::max(0., util / m_Params.saturation)) : 0.;
+    };
+    const double computeScore = saturated(result.deviceComputeUtil);
+    const double memoryScore = saturated(result.deviceMemBWUtil);
+    const double copyScore = saturated(result.deviceCopyUtil);
+    const double hostScore = saturated(result.hostUtil);
+    const double deviceScore = std::max({ computeScore, memoryScore, copyScore });
+
+    double scores[BOTTLENECK_COUNT];
+    scores[BOTTLENECK_DEVICE_COMPUTE] = computeScore;
+    scores[BOTTLENECK_DEVICE_MEMORY] = memoryScore;
+    scores[BOTTLENECK_TRANSFER] = copyScore;
+    scores[BOTTLENECK_HOST] = hostScore * (1. - deviceScore);
+    scores[BOTTLENECK_IDLE] = (1. - hostScore) * (1. - deviceScore);
+
+    double total = 0.;
+    for (double s : scores)
+    {
+        total += s;
+    }
+    if (total <= 0.)
+    {
+        return result;
+    }
+    UI32 best = 0;
+    for (UI32 i = 0; i < BOTTLENECK_COUNT; ++i)
+    {
+        result.scores[i] = scores[i] / total;
+        if (result.scores[i] > result.scores[best])
+        {
+            best = i;
+        }
+    }
+    result.verdict = Bottleneck(best);
+    result.confidence = result.scores[best] * std::min(1., double(result.numSamples) / std::max(1U, m_Params.minSamples));
+    return result;
+}
+
+std::ostream& operator<<(std::ostream& ostr, const TelemetryBottleneckClassifier::Result& result)
+{
+    typedef TelemetryBottleneckClassifier C;
+    const bool bBound = (result.verdict != C::BOTTLENECK_IDLE) && (result.verdict != C::BOTTLENECK_UNKNOWN);
+    ostr << C::getBottleneckName(result.verdict) << (bBound ? " bound" : "")
+        << " (confidence " << result.confidence << ", "
+        << result.numSamples << " samples):";
+    for (UI32 i = 0; i < C::BOTTLENECK_COUNT; ++i)
+    {
+        ostr << " " << C::getBottleneckName(C::Bottleneck(i)) << "=" << result.scores[i];
+    }
+    ostr << std::endl;
+    ostr << "\tDevice compute " << result.deviceComputeUtil << ", memory BW " << result.deviceMemBWUtil
+        << ", copy " << result.deviceCopyUtil << ", freq " << result.deviceFreqRatio
+        << "; host " << result.hostUtil << std::endl;
+    return ostr;
+}
+} // XI
+#endif // XPUINFO_USE_TELEMETRYTRACKER
@@ -0,0 +1,78 @@
+// Copyright (C) 2024 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+// Host-versus-device bottleneck classification of a window of TelemetryTracker records.
+//
+// Window means of device compute activity, device memory bandwidth (relative to peak), copy activity
+// and host CPU utilization are each scored by how close they are to saturation.  Host and idle scores
+// also require the device to be underutilized.  The verdict is the highest score, and its confidence
+// is its share of all scores, reduced for windows with few samples.  With nothing measured (i.e. an
+// empty window, or no device or host counters), the verdict is unknown with zero confidence.
+//
+// There are no PCIe counters, so transfer-bound is inferred from global engine activity not explained
+// by compute or media engines (i.e. copy engines), which needs IGCL activity counters.
+
+#pragma once
+#include "LibXPUInfo.h"
+
+#ifdef _WIN32
+#pragma warning(push)
+#pragma warning(disable : 4251)
+#endif
+
+#ifdef XPUINFO_USE_TELEMETRYTRACKER
+namespace XI
+{
+    class TelemetryWindow;
+
+    class XPUINFO_EXPORT TelemetryBottleneckClassifier
+    {
+    public:
+        enum Bottleneck : UI32
+        {
+            BOTTLENECK_IDLE = 0,
+            BOTTLENECK_DEVICE_COMPUTE,
+            BOTTLENECK_DEVICE_MEMORY,
+            BOTTLENECK_HOST,
+            BOTTLENECK_TRANSFER,
+            BOTTLENECK_COUNT,
+            BOTTLENECK_UNKNOWN = BOTTLENECK_COUNT // No features measured; has no score
+        };
+        static const char* getBottleneckName(Bottleneck bottleneck);
+
+        struct Params
+        {
+            double saturation = 0.8;            // Utilization scored as saturated
+            double peakMemBWBytesPerSec = 0.;   // 0 to use DeviceProperties::MemoryBandWidthMax
+            UI32 minSamples = 5;                // Confidence is reduced below this
+        };
+        struct Result
+        {
+            Bottleneck verdict = BOTTLENECK_UNKNOWN;
+            double confidence = 0.;             // [0, 1], 0 if BOTTLENECK_UNKNOWN
+            double scores[BOTTLENECK_COUNT] = {}; // Normalized to sum to 1
+            UI32 numSamples = 0;
+
+            // Window means in [0, 1]; NaN if not tracked
+            double deviceComputeUtil = 0.;
+            double deviceMemBWUtil = 0.;
+            double deviceCopyUtil = 0.;
+            double deviceFreqRatio = 0.;        // Relative to DeviceProperties::FreqMaxMHz, i.e. to spot throttling
+            double hostUtil = 0.;               // Busiest single CPU; overall CPU utilization on Windows x86
+        };
+
+        TelemetryBottleneckClassifier();
+        TelemetryBottleneckClassifier(const Params& params);
+
+        Result classify(const TelemetryWindow& window) const;
+
+    protected:
+        const Params m_Params;
+    };
+    XPUINFO_EXPORT std::ostream& operator<<(std::ostream& ostr, const TelemetryBottleneckClassifier::Result& result);
+} // XI
+#endif // XPUINFO_USE_TELEMETRYTRACKER
+
+#ifdef _WIN32
+#pragma warning(pop)
+#endif
@@ -0,0 +1,118 @@
+// Copyright (C) 2024 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#ifdef XPUINFO_USE_TELEMETRYTRACKER
+#include "LibXPUInfo_TelemetryChange.h"
+#include <algorithm>
+#include <cmath>
+
+namespace XI
+{
+void TelemetryChangeDetector::RunningStats::add(UI64 timeNs, double value)
+{
+    if (!count)
+    {
+        startNs = timeNs;
+    }
+    ++count;
+    const double delta = value - mean;
+    mean += delta / count;
+    m2 += delta * (value - mean);
+}
+
+double TelemetryChangeDetector::RunningStats::getStdDev() const
+{
+    return (count > 1) ? std::sqrt(m2 / (count - 1)) : 0.;
+}
+
+TelemetryChangeDetector::TelemetryChangeDetector(const Params& params) : m_Params(params)
+{
+    XPUINFO_REQUIRE_MSG(params.warmupSamples >= 2, "Change detection needs at least 2 warmup samples");
+    XPUINFO_REQUIRE_MSG((params.ewmaLambda > 0.) && (params.ewmaLambda <= 1.), "ewmaLambda must be in (0, 1]");
+    XPUINFO_REQUIRE_MSG(params.threshold > 0., "Change detection threshold must be positive");
+}
+
+void TelemetryChangeDetector::restart()
+{
+    m_warmup = RunningStats();
+    m_bWarmedUp = false;
+    m_cusumHigh = m_cusumLow = 0.;
+    m_runHigh = m_runLow = RunningStats();
+}
+
+bool TelemetryChangeDetector::update(UI64 timeNs, double value, ChangeEvent& event)
+{
+    if (!std::isfinite(value))
+    {
+        return false;
+    }
+    if (!m_bWarmedUp)
+    {
+        m_warmup.add(timeNs, value);
+        if (m_warmup.count == m_Params.warmupSamples)
+        {
+            m_baselineMean = m_warmup.mean;
+            // Floor so that a perfectly steady baseline (i.e. a pinned frequency) does not alarm on noise
+            m_baselineStdDev = std::max({ m_warmup.getStdDev(), m_Params.minRelStdDev * std::abs(m_baselineMean), 1e-9 });
+            m_ewma = m_baselineMean;
+            m_bWarmedUp = true;
+        }
+        return false;
+    }
+
+    const double z = (value - m_baselineMean) / m_baselineStdDev;
+    bool bHigh = false;
+    bool bLow = false;
+    if (m_Params.method == TelemetryTracker::CHANGE_DETECTOR_EWMA)
+    {
+        const double lambda = m_Params.ewmaLambda;
+        const double prevSide = m_ewma - m_baselineMean;
+        m_ewma = lambda * value + (1. - lambda) * m_ewma;
+        const double side = m_ewma - m_baselineMean;
+        // Runs restart when the EWMA crosses the baseline
+        if ((side > 0.) && (prevSide <= 0.))
+            m_runHigh = RunningStats();
+        if ((side < 0.) && (prevSide >= 0.))
+            m_runLow = RunningStats();
+        (side > 0. ? m_runHigh : m_runLow).add(timeNs, value);
+        const double limit = m_Params.threshold * m_baselineStdDev * std::sqrt(lambda / (2. - lambda));
+        bHigh = side > limit;
+        bLow = side < -limit;
+    }
+    else
+    {
+        if (m_cusumHigh == 0.)
+            m_runHigh = RunningStats();
+        if (m_cusumLow == 0.)
+            m_runLow = RunningStats();
+        m_cusumHigh = std::max(0., m_cusumHigh + z - m_Params.cusumSlack);
+        m_cusumLow = std::max(0., m_cusumLow - z - m_Params.cusumSlack);
+        if (m_cusumHigh > 0.)
+            m_runHigh.add(timeNs, value);
+        if (m_cusumLow > 0.)
+            m_runLow.add(timeNs, value);
+        bHigh = m_cusumHigh > m_Params.threshold;
+        bLow = m_cusumLow > m_Params.threshold;
+    }
+    if (!bHigh && !bLow)
+    {
+        return false;
+    }
+
+    const RunningStats& run = bHigh ? m_runHigh : m_runLow;
+    event = ChangeEvent();
+    event.counterName = m_Params.counterName;
+    event.method = m_Params.method;
+    event.timeNs = timeNs;
+    event.onsetNs = run.startNs;
+    event.bIncrease = bHigh;
+    event.beforeMean = m_baselineMean;
+    event.beforeStdDev = m_baselineStdDev;
+    event.afterMean = run.mean;
+    event.afterStdDev = run.getStdDev();
+    event.afterSamples = run.count;
+    restart();
+    return true;
+}
+} // XI
+#endif // XPUINFO_USE_TELEMETRYTRACKER
@@ -0,0 +1,69 @@
+// Copyright (C) 2024 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+// Online change-point detection on a telemetry counter, to flag gradual regressions (i.e. sustained
+// frequency drifting down with heat soak) that fixed thresholds miss.
+//
+// A baseline mean and standard deviation are estimated over warmup samples.  Then each sample updates
+// either a two-sided CUSUM of standardized deviations (Page, 1954) or an EWMA control chart (Roberts,
+// 1959) in O(1).  On a change, the baseline restarts from the new regime.
+
+#pragma once
+#include "LibXPUInfo.h"
+
+#ifdef _WIN32
+#pragma warning(push)
+#pragma warning(disable : 4251)
+#endif
+
+#ifdef XPUINFO_USE_TELEMETRYTRACKER
+namespace XI
+{
+    class XPUINFO_EXPORT TelemetryChangeDetector : public NoCopyAssign
+    {
+    public:
+        typedef TelemetryTracker::ChangeDetectorParams Params;
+        typedef TelemetryTracker::ChangeEvent ChangeEvent;
+
+        TelemetryChangeDetector(const Params& params);
+        const Params& getParams() const { return m_Params; }
+
+        // True with event filled in if value completes a change
+        bool update(UI64 timeNs, double value, ChangeEvent& event);
+
+        bool isWarmedUp() const { return m_bWarmedUp; }
+        double getBaselineMean() const { return m_baselineMean; }
+        double getBaselineStdDev() const { return m_baselineStdDev; }
+
+    protected:
+        struct RunningStats // Welford
+        {
+            UI32 count = 0;
+            double mean = 0.;
+            double m2 = 0.;
+            UI64 startNs = 0;
+
+            void add(UI64 timeNs, double value);
+            double getStdDev() const;
+        };
+        void restart();
+
+        const Params m_Params;
+        RunningStats m_warmup;
+        bool m_bWarmedUp = false;
+        double m_baselineMean = 0.;
+        double m_baselineStdDev = 0.;
+
+        double m_cusumHigh = 0.;
+        double m_cusumLow = 0.;
+        double m_ewma = 0.;
+        // Samples since the statistic last left the baseline, upward and downward
+        RunningStats m_runHigh;
+        RunningStats m_runLow;
+    };
+} // XI
+#endif // XPUINFO_USE_TELEMETRYTRACKER
+
+#ifdef _WIN32
+#pragma warning(pop)
+#endif
@@ -0,0 +1,97 @@
+// Copyright (C) 2024 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#ifdef XPUINFO_USE_TELEMETRYTRACKER
+#include "LibXPUInfo_TelemetryClock.h"
+#include <algorithm>
+#include <cmath>
+
+namespace XI
+{
+TelemetryClockCorrelator::TelemetryClockCorrelator(const Params& params) : m_Params(params)
+{
+    XPUINFO_REQUIRE_MSG(params.minFitSpanSec > 0., "minFitSpanSec must be positive");
+    XPUINFO_REQUIRE_MSG(params.maxDriftPPM >= 0., "maxDriftPPM must not be negative");
+}
+
+bool TelemetryClockCorrelator::addPair(double deviceSec, UI64 hostBeforeNs, UI64 hostAfterNs)
+{
+    if (!std::isfinite(deviceSec) || (hostAfterNs < hostBeforeNs))
+    {
+        return false;
+    }
+    if (m_corr.numPairs && (hostBeforeNs < m_lastPairHostNs + UI64(m_Params.intervalMs) * 1000000ULL))
+    {
+        return false;
+    }
+    const UI64 bracketNs = hostAfterNs - hostBeforeNs;
+    const UI64 hostNs = hostBeforeNs + bracketNs / 2;
+    if (!m_corr.numPairs)
+    {
+        m_refDeviceSec = deviceSec;
+        m_refHostNs = hostNs;
+        m_corr.minBracketNs = double(bracketNs);
+    }
+    m_lastPairHostNs = hostBeforeNs;
+
+    const double x = deviceSec - m_refDeviceSec;
+    const double y = double(I64(hostNs - m_refHostNs));
+    // 1 us floor, so a few lucky fast reads do not dominate
+    const double w = 1. / std::pow(double(bracketNs) + 1000., 2.);
+    if (m_corr.numPairs)
+    {
+        // Residual against the fit so far, so it reflects prediction error; weighted as the fit
+        const double residual = y - (m_intercept + m_slope * x);
+        m_residualSq = 0.9 * m_residualSq + w * residual * residual;
+        m_residualWeights = 0.9 * m_residualWeights + w;
+        m_corr.residualNs = std::sqrt(m_residualSq / m_residualWeights);
+    }
+    m_sumWeights += w;
+    const double dx = x - m_meanX;
+    m_meanX += (w / m_sumWeights) * dx;
+    const double dy = y - m_meanY;
+    m_meanY += (w / m_sumWeights) * dy;
+    m_sxx += w * dx * (x - m_meanX);
+    m_sxy += w * dx * (y - m_meanY);
+
+    ++m_corr.numPairs;
+    m_corr.minBracketNs = std::min(m_corr.minBracketNs, double(bracketNs));
+    updateFit();
+    return true;
+}
+
+void TelemetryClockCorrelator::updateFit()
+{
+    // Drift is only fitted once pairs span enough device time, else jitter dominates the slope
+    const double spanSec = std::sqrt(m_sxx / m_sumWeights);
+    double slope = 1e9;
+    if (spanSec >= m_Params.minFitSpanSec)
+    {
+        const double maxDrift = m_Params.maxDriftPPM * 1e-6;
+        slope = std::min(std::max(m_sxy / m_sxx, 1e9 * (1. - maxDrift)), 1e9 * (1. + maxDrift));
+    }
+    m_slope = slope;
+    m_intercept = m_meanY - slope * m_meanX;
+    m_corr.driftPPM = (1e9 / slope - 1.) * 1e6;
+    m_corr.offsetNs = double(m_refHostNs) + m_intercept - slope * m_refDeviceSec;
+}
+
+UI64 TelemetryClockCorrelator::toHostNs(double deviceSec) const
+{
+    // Saturates rather than wrapping for times far from the reference
+    const double deltaNs = std::round(m_intercept + m_slope * (deviceSec - m_refDeviceSec));
+    if (deltaNs < 0.)
+    {
+        return (-deltaNs >= double(m_refHostNs)) ? 0 : m_refHostNs - UI64(-deltaNs);
+    }
+    return (deltaNs >= double(~0ULL - m_refHostNs)) ? ~0ULL : m_refHostNs + UI64(deltaNs);
+}
+
+double TelemetryClockCorrelator::toDeviceSec(UI64 hostNs) const
+{
+    // Unsigned difference in each direction, as hostNs may be far past the reference (i.e. ~0ULL)
+    const double y = (hostNs >= m_refHostNs) ? double(hostNs - m_refHostNs) : -double(m_refHostNs - hostNs);
+    return m_refDeviceSec + (y - m_intercept) / m_slope;
+}
+} // XI
+#endif // XPUINFO_USE_TELEMETRYTRACKER
@@ -0,0 +1,66 @@
+// Copyright (C) 2024 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+// Correlation of a device clock (i.e. IGCL telemetry timestamps) with the host monotonic clock, so that
+// records from different devices, trackers and processes can be merged on one time base.
+//
+// Each pair is a device timestamp read between two host clock readings.  Host time is fitted as offset
+// plus drift (a linear function of device time) by weighted least squares, updated in O(1) per pair.
+// Pairs are weighted by the inverse square of their host bracket, so reads delayed by preemption barely
+// move the fit.
+
+#pragma once
+#include "LibXPUInfo.h"
+
+#ifdef _WIN32
+#pragma warning(push)
+#pragma warning(disable : 4251)
+#endif
+
+#ifdef XPUINFO_USE_TELEMETRYTRACKER
+namespace XI
+{
+    class XPUINFO_EXPORT TelemetryClockCorrelator : public NoCopyAssign
+    {
+    public:
+        typedef TelemetryTracker::ClockCorrelationParams Params;
+        typedef TelemetryTracker::ClockCorrelation Correlation;
+
+        TelemetryClockCorrelator(const Params& params);
+
+        // deviceSec was read between host times hostBeforeNs and hostAfterNs.  Pairs closer than
+        // Params::intervalMs to the previous one are ignored; returns true if used.
+        bool addPair(double deviceSec, UI64 hostBeforeNs, UI64 hostAfterNs);
+
+        bool isValid() const { return m_corr.numPairs != 0; }
+        const Correlation& getCorrelation() const { return m_corr; }
+        UI64 toHostNs(double deviceSec) const;
+        double toDeviceSec(UI64 hostNs) const;
+
+    protected:
+        void updateFit();
+
+        const Params m_Params;
+        Correlation m_corr;
+        // Coordinates relative to the first pair, for precision
+        double m_refDeviceSec = 0.;
+        UI64 m_refHostNs = 0;
+        UI64 m_lastPairHostNs = 0;
+        // Weighted running means and co-moments (West, 1979)
+        double m_sumWeights = 0.;
+        double m_meanX = 0.;    // Device, s
+        double m_meanY = 0.;    // Host, ns
+        double m_sxx = 0.;
+        double m_sxy = 0.;
+        double m_residualSq = 0.;   // Weighted, decaying
+        double m_residualWeights = 0.;
+        // Fit: host ns = m_refHostNs + m_intercept + m_slope * (deviceSec - m_refDeviceSec)
+        double m_intercept = 0.;
+        double m_slope = 1e9;
+    };
+} // XI
+#endif // XPUINFO_USE_TELEMETRYTRACKER
+
+#ifdef _WIN32
+#pragma warning(pop)
+#endif
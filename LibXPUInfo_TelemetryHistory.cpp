@@ -0,0 +1,349 @@
+// Copyright (C) 2024 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#ifdef XPUINFO_USE_TELEMETRYTRACKER
+#include "LibXPUInfo_TelemetryHistory.h"
+#include "LibXPUInfo_Util.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <iomanip>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace XI
+{
+namespace
+{
+    typedef TelemetryHistory::TimedRecord TimedRecord;
+    const UI32 kNumWords = TelemetryHistory::kWordsPerRecord;
+    const UI32 kNoWindow = 64;
+
+    // Integer words (timestamp and counters) are delta-of-delta encoded, all others XOR encoded
+    struct WordEncodings
+    {
+        bool deltaOfDelta[kNumWords] = {};
+
+        WordEncodings()
+        {
+            const size_t offsets[] = {
+                offsetof(TimedRecord, timeStampUI64),
+                offsetof(TimedRecord, bw_read),
+                offsetof(TimedRecord, bw_write),
+                offsetof(TimedRecord, deviceMemoryUsedBytes),
+                offsetof(TimedRecord, deviceMemoryBudgetBytes),
+            };
+            for (size_t offset : offsets)
+            {
+                deltaOfDelta[offset / sizeof(UI64)] = true;
+            }
+            for (UI32 i = 0; i < TelemetryTracker::kMaxResCtrlGroups; ++i)
+            {
+                deltaOfDelta[(offsetof(TimedRecord, llcOccupancyBytes) + i * sizeof(UI64)) / sizeof(UI64)] = true;
+            }
+        }
+    };
+    const WordEncodings g_Encodings;
+
+    inline UI64 lowMask(UI32 n)
+    {
+        return (n >= 64) ? ~0ULL : ((1ULL << n) - 1);
+    }
+
+    inline UI32 countLeadingZeros(UI64 x) // x != 0
+    {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanReverse64(&index, x);
+        return 63 - index;
+#else
+        return __builtin_clzll(x);
+#endif
+    }
+
+    inline UI32 countTrailingZeros(UI64 x) // x != 0
+    {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward64(&index, x);
+        return index;
+#else
+        return __builtin_ctzll(x);
+#endif
+    }
+
+    // Low n bits of value, most significant first
+    void writeBits(std::vector<UI64>& bits, size_t& numBits, UI64 value, UI32 n)
+    {
+        while (n)
+        {
+            const size_t word = numBits / 64;
+            const UI32 space = 64 - UI32(numBits % 64);
+            const UI32 take = std::min(space, n);
+            if (word == bits.size())
+            {
+                bits.push_back(0);
+            }
+            const UI64 chunk = (value >> (n - take)) & lowMask(take);
+            bits[word] |= chunk << (space - take);
+            n -= take;
+            numBits += take;
+        }
+    }
+
+    UI64 readBits(const std::vector<UI64>& bits, size_t& pos, UI32 n)
+    {
+        UI64 value = 0;
+        while (n)
+        {
+            const size_t word = pos / 64;
+            const UI32 space = 64 - UI32(pos % 64);
+            const UI32 take = std::min(space, n);
+            const UI64 chunk = (bits[word] >> (space - take)) & lowMask(take);
+            value = (take == 64) ? chunk : ((value << take) | chunk);
+            n -= take;
+            pos += take;
+        }
+        return value;
+    }
+
+    // Delta-of-delta buckets: prefix of 1s terminated by 0 (except the last), then zigzag value bits
+    const UI32 kDoDBits[] = { 0, 7, 12, 20, 32, 64 };
+    const UI32 kNumDoDBuckets = sizeof(kDoDBits) / sizeof(kDoDBits[0]);
+}
+
+TelemetryHistory::TelemetryHistory(size_t maxBytes) : m_maxBytes(maxBytes)
+{
+}
+
+void TelemetryHistory::clear()
+{
+    m_blocks.clear();
+    m_size = 0;
+    m_numDropped = 0;
+    m_nextIndex = 0;
+    m_bytes = 0;
+}
+
+size_t TelemetryHistory::getBytes() const
+{
+    size_t bytes = m_bytes + m_blocks.size() * sizeof(Block);
+    if (m_blocks.size())
+    {
+        bytes += m_blocks.back().bits.capacity() * sizeof(UI64);
+    }
+    return bytes;
+}
+
+void TelemetryHistory::closeBlock()
+{
+    auto& block = m_blocks.back();
+    block.bits.shrink_to_fit();
+    m_bytes += block.bits.capacity() * sizeof(UI64);
+
+    // Keep at least the block being started
+    while (m_maxBytes && (m_bytes + (m_blocks.size() + 1) * sizeof(Block) > m_maxBytes) && m_blocks.size())
+    {
+        const auto& oldest = m_blocks.front();
+        m_bytes -= oldest.bits.capacity() * sizeof(UI64);
+        m_size -= oldest.count;
+        m_numDropped += oldest.count;
+        m_blocks.pop_front();
+    }
+}
+
+void TelemetryHistory::append(const TimedRecord& rec)
+{
+    if (m_blocks.empty() || (m_blocks.back().count == kRecordsPerBlock))
+    {
+        if (m_blocks.size())
+        {
+            closeBlock();
+        }
+        m_blocks.emplace_back();
+        m_blocks.back().firstIndex = m_nextIndex;
+        m_blocks.back().firstTime = rec.timeStampUI64;
+    }
+    Block& block = m_blocks.back();
+
+    UI64 words[kNumWords];
+    std::memcpy(words, &rec, sizeof(words));
+    for (UI32 w = 0; w < kNumWords; ++w)
+    {
+        const UI64 v = words[w];
+        WordState& state = m_state[w];
+        if (block.count == 0)
+        {
+            writeBits(block.bits, block.numBits, v, 64);
+            state = WordState();
+            state.leading = kNoWindow;
+        }
+        else if (g_Encodings.deltaOfDelta[w])
+        {
+            const UI64 delta = v - state.prev;
+            const I64 dod = I64(delta - UI64(state.prevDelta));
+            const UI64 zz = (UI64(dod) << 1) ^ UI64(dod >> 63);
+            UI32 bucket = 0;
+            while ((bucket < kNumDoDBuckets - 1) && (zz > lowMask(kDoDBits[bucket])))
+            {
+                ++bucket;
+            }
+            // bucket 1s, then a 0 unless it is the last bucket
+            const UI32 prefixBits = (bucket < kNumDoDBuckets - 1) ? bucket + 1 : bucket;
+            writeBits(block.bits, block.numBits, lowMask(bucket) << (prefixBits - bucket), prefixBits);
+            if (kDoDBits[bucket])
+            {
+                writeBits(block.bits, block.numBits, zz, kDoDBits[bucket]);
+            }
+            state.prevDelta = I64(delta);
+        }
+        else
+        {
+            const UI64 x = v ^ state.prev;
+            if (!x)
+            {
+                writeBits(block.bits, block.numBits, 0, 1);
+            }
+            else
+            {
+                const UI32 leading = std::min(countLeadingZeros(x), 31U); // 5 bits
+                const UI32 trailing = countTrailingZeros(x);
+                if ((state.leading != kNoWindow) && (leading >= state.leading) && (trailing >= state.trailing))
+                {
+                    // Fits in the previous window
+                    writeBits(block.bits, block.numBits, 0b10, 2);
+                    writeBits(block.bits, block.numBits, x >> state.trailing, 64 - state.leading - state.trailing);
+                }
+                else
+                {
+                    const UI32 meaningful = 64 - leading - trailing;
+                    writeBits(block.bits, block.numBits, 0b11, 2);
+                    writeBits(block.bits, block.numBits, leading, 5);
+                    writeBits(block.bits, block.numBits, meaningful - 1, 6);
+                    writeBits(block.bits, block.numBits, x >> trailing, meaningful);
+                    state.leading = leading;
+                    state.trailing = trailing;
+                }
+            }
+        }
+        state.prev = v;
+    }
+    ++block.count;
+    block.lastTime = rec.timeStampUI64;
+    ++m_size;
+    ++m_nextIndex;
+}
+
+TelemetryHistory::const_iterator TelemetryHistory::end() const
+{
+    return const_iterator(this, m_blocks.size());
+}
+
+TelemetryHistory::const_iterator TelemetryHistory::lowerBound(UI64 timeStampUI64) const
+{
+    auto blockIt = std::partition_point(m_blocks.begin(), m_blocks.end(),
+        [timeStampUI64](const Block& b) { return b.lastTime < timeStampUI64; });
+    const_iterator it(this, blockIt - m_blocks.begin());
+    const auto itEnd = end();
+    while ((it != itEnd) && (it->timeStampUI64 < timeStampUI64))
+    {
+        ++it;
+    }
+    return it;
+}
+
+void TelemetryHistory::printInfo(std::ostream& ostr) const
+{
+    const size_t bytes = getBytes();
+    SaveRestoreIOSFlags sr(ostr);
+    ostr << "Telemetry history: " << m_size << " records in " << m_blocks.size() << " blocks, "
+        << bytes / 1024.0 << " KB (" << getUncompressedBytes() / 1024.0 << " KB uncompressed";
+    if (bytes)
+    {
+        ostr << ", " << std::fixed << std::setprecision(1) << double(getUncompressedBytes()) / bytes << "x";
+    }
+    ostr << ")";
+    if (m_numDropped)
+    {
+        ostr << ", " << m_numDropped << " dropped";
+    }
+    ostr << std::endl;
+}
+
+TelemetryHistory::const_iterator::const_iterator(const TelemetryHistory* pHistory, size_t block) :
+    m_pHistory(pHistory), m_block(block)
+{
+    if (m_block < m_pHistory->m_blocks.size())
+    {
+        decode();
+    }
+}
+
+UI64 TelemetryHistory::const_iterator::getIndex() const
+{
+    if (m_block < m_pHistory->m_blocks.size())
+    {
+        return m_pHistory->m_blocks[m_block].firstIndex + m_inBlock;
+    }
+    return m_pHistory->m_nextIndex;
+}
+
+TelemetryHistory::const_iterator& TelemetryHistory::const_iterator::operator++()
+{
+    if (++m_inBlock == m_pHistory->m_blocks[m_block].count)
+    {
+        ++m_block;
+        m_inBlock = 0;
+        m_bitPos = 0;
+    }
+    if (m_block < m_pHistory->m_blocks.size())
+    {
+        decode();
+    }
+    return *this;
+}
+
+void TelemetryHistory::const_iterator::decode()
+{
+    const auto& bits = m_pHistory->m_blocks[m_block].bits;
+    UI64 words[kNumWords];
+    for (UI32 w = 0; w < kNumWords; ++w)
+    {
+        WordState& state = m_state[w];
+        if (m_inBlock == 0)
+        {
+            state = WordState();
+            state.leading = kNoWindow;
+            state.prev = readBits(bits, m_bitPos, 64);
+        }
+        else if (g_Encodings.deltaOfDelta[w])
+        {
+            UI32 bucket = 0;
+            while ((bucket < kNumDoDBuckets - 1) && readBits(bits, m_bitPos, 1))
+            {
+                ++bucket;
+            }
+            const UI64 zz = kDoDBits[bucket] ? readBits(bits, m_bitPos, kDoDBits[bucket]) : 0;
+            const UI64 dod = (zz >> 1) ^ (0 - (zz & 1));
+            const UI64 delta = UI64(state.prevDelta) + dod;
+            state.prev += delta;
+            state.prevDelta = I64(delta);
+        }
+        else if (readBits(bits, m_bitPos, 1))
+        {
+            if (readBits(bits, m_bitPos, 1))
+            {
+                state.leading = UI32(readBits(bits, m_bitPos, 5));
+                const UI32 meaningful = UI32(readBits(bits, m_bitPos, 6)) + 1;
+                state.trailing = 64 - state.leading - meaningful;
+            }
+            const UI32 meaningful = 64 - state.leading - state.trailing;
+            state.prev ^= readBits(bits, m_bitPos, meaningful) << state.trailing;
+        }
+        words[w] = state.prev;
+    }
+    std::memcpy(&m_rec, words, sizeof(words));
+}
+} // XI
+#endif // XPUINFO_USE_TELEMETRYTRACKER
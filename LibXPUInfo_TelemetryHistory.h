@@ -0,0 +1,119 @@
+// Copyright (C) 2024 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+// Compressed in-memory TelemetryTracker history, using the Gorilla scheme (Pelkonen et al., VLDB 2015):
+// delta-of-delta encoding of the timestamp and integer counters, and XOR encoding of doubles against
+// the previous value of the same field.  Slowly-changing and unused fields take 1 bit per record.
+//
+// Records are stored in independently-decodable blocks, so the oldest can be dropped to stay within a
+// memory budget and range queries can skip blocks by timestamp.  Iterators decode on the fly.
+
+#pragma once
+#include "LibXPUInfo.h"
+#include <deque>
+#include <iterator>
+
+#ifdef _WIN32
+#pragma warning(push)
+#pragma warning(disable : 4251)
+#endif
+
+#ifdef XPUINFO_USE_TELEMETRYTRACKER
+namespace XI
+{
+    class XPUINFO_EXPORT TelemetryHistory : public NoCopyAssign
+    {
+    public:
+        typedef TelemetryTracker::TimedRecord TimedRecord;
+        static constexpr UI32 kRecordsPerBlock = 256;
+        static constexpr UI32 kWordsPerRecord = sizeof(TimedRecord) / sizeof(UI64);
+        static_assert(sizeof(TimedRecord) % sizeof(UI64) == 0, "TimedRecord is encoded as 64-bit words");
+
+    protected:
+        struct Block
+        {
+            UI64 firstIndex = 0;
+            UI32 count = 0;
+            UI64 firstTime = 0;         // timeStampUI64 (also ordered for positive double timestamps)
+            UI64 lastTime = 0;
+            std::vector<UI64> bits;
+            size_t numBits = 0;
+        };
+        struct WordState
+        {
+            UI64 prev = 0;
+            I64 prevDelta = 0;          // Delta-of-delta words
+            UI32 leading = 0;           // XOR words: previous window of meaningful bits
+            UI32 trailing = 0;
+        };
+
+    public:
+        // Decodes records in order.  Invalidated by append().
+        class XPUINFO_EXPORT const_iterator
+        {
+        public:
+            typedef std::forward_iterator_tag iterator_category;
+            typedef TimedRecord value_type;
+            typedef std::ptrdiff_t difference_type;
+            typedef const TimedRecord* pointer;
+            typedef const TimedRecord& reference;
+
+            const_iterator() = default;
+            reference operator*() const { return m_rec; }
+            pointer operator->() const { return &m_rec; }
+            const_iterator& operator++();
+            const_iterator operator++(int) { const_iterator tmp(*this); ++*this; return tmp; }
+            bool operator==(const const_iterator& other) const { return (m_block == other.m_block) && (m_inBlock == other.m_inBlock); }
+            bool operator!=(const const_iterator& other) const { return !(*this == other); }
+            // Index since the first record appended, including dropped blocks
+            UI64 getIndex() const;
+
+        protected:
+            friend class TelemetryHistory;
+            const_iterator(const TelemetryHistory* pHistory, size_t block);
+            void decode();
+
+            const TelemetryHistory* m_pHistory = nullptr;
+            size_t m_block = 0;
+            UI32 m_inBlock = 0;
+            size_t m_bitPos = 0;
+            WordState m_state[kWordsPerRecord];
+            TimedRecord m_rec{};
+        };
+
+        // maxBytes of 0 is unbounded, else the oldest blocks are dropped once compressed size exceeds it
+        TelemetryHistory(size_t maxBytes = 0);
+
+        void append(const TimedRecord& rec);
+        void clear();
+
+        const_iterator begin() const { return const_iterator(this, 0); }
+        const_iterator end() const;
+        // First record with timeStampUI64 >= timeStampUI64 (same clock as the tracker's records)
+        const_iterator lowerBound(UI64 timeStampUI64) const;
+
+        UI64 size() const { return m_size; }
+        bool empty() const { return m_size == 0; }
+        UI64 getNumDropped() const { return m_numDropped; }
+        size_t getNumBlocks() const { return m_blocks.size(); }
+        size_t getBytes() const;
+        size_t getUncompressedBytes() const { return size_t(m_size) * sizeof(TimedRecord); }
+        void printInfo(std::ostream& ostr) const;
+
+    protected:
+        void closeBlock();
+
+        const size_t m_maxBytes;
+        std::deque<Block> m_blocks;
+        WordState m_state[kWordsPerRecord]; // Encoder state of the last block
+        UI64 m_size = 0;
+        UI64 m_numDropped = 0;
+        UI64 m_nextIndex = 0;
+        size_t m_bytes = 0;         // Bits of closed blocks
+    };
+} // XI
+#endif // XPUINFO_USE_TELEMETRYTRACKER
+
+#ifdef _WIN32
+#pragma warning(pop)
+#endif
@@ -0,0 +1,133 @@
+// Copyright (C) 2024 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#ifdef XPUINFO_USE_TELEMETRYTRACKER
+#include "LibXPUInfo_TelemetryQuery.h"
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+
+namespace XI
+{
+TelemetryWindow::TelemetryWindow(const TelemetryTracker& tracker, UI64 t0Ns, UI64 t1Ns) :
+    m_tracker(tracker), m_lock(tracker.m_RecordMutex)
+{
+    if (t1Ns <= t0Ns)
+    {
+        return;
+    }
+    if (tracker.m_pHistory)
+    {
+        if (!tracker.m_pHistory->empty())
+        {
+            m_historyBegin = historyLowerBound(t0Ns);
+            m_historyEnd = historyLowerBound(t1Ns);
+            m_size = size_t(m_historyEnd.getIndex() - m_historyBegin.getIndex());
+        }
+        return;
+    }
+
+    const auto& records = tracker.m_records;
+    const auto lowerBound = [&tracker, &records](UI64 timeNs)
+    {
+        return std::partition_point(records.begin(), records.end(),
+            [&tracker, timeNs](const TimedRecord& rec) { return tracker.getHostTimeNs(rec) < timeNs; });
+    };
+    m_pBegin = records.data() + (lowerBound(t0Ns) - records.begin());
+    m_pEnd = records.data() + (lowerBound(t1Ns) - records.begin());
+    m_size = size_t(m_pEnd - m_pBegin);
+}
+
+TelemetryWindow TelemetryWindow::latest(const TelemetryTracker& tracker, UI64 durationNs)
+{
+    const UI64 now = TelemetryTracker::getCurrentHostTimeNs();
+    // Device timestamps may run slightly ahead of the host clock, so include everything after the start
+    return TelemetryWindow(tracker, (now > durationNs) ? now - durationNs : 0, ~0ULL);
+}
+
+TelemetryHistory::const_iterator TelemetryWindow::historyLowerBound(UI64 timeNs) const
+{
+    const auto& history = *m_tracker.m_pHistory;
+    // Past the latest record, i.e. an unbounded window end (~0ULL), whose timestamp conversion would overflow.
+    // With history enabled, m_records holds the latest record.
+    const auto& records = m_tracker.m_records;
+    if (records.size() && (timeNs > m_tracker.getHostTimeNs(records.back())))
+    {
+        return history.end();
+    }
+
+    // History is searched by raw timestamp, so convert slightly before timeNs then step to the exact bound
+    UI64 key = 0;
+    if (m_tracker.m_ResultMask & TelemetryTracker::TELEMETRYITEM_TIMESTAMP_DOUBLE)
+    {
+        const double ts = m_tracker.hostToDeviceSec(timeNs) - 1e-6;
+        if (ts > 0.)
+        {
+            std::memcpy(&key, &ts, sizeof(key)); // Ordered as UI64 for positive doubles
+        }
+    }
+    else
+    {
+        const UI64 freq = m_tracker.m_timestamp_freq;
+        const UI64 ticks = (timeNs / 1000000000ULL) * freq + ((timeNs % 1000000000ULL) * freq) / 1000000000ULL;
+        key = ticks ? ticks - 1 : 0;
+    }
+
+    auto it = history.lowerBound(key);
+    const auto itEnd = history.end();
+    while ((it != itEnd) && (m_tracker.getHostTimeNs(*it) < timeNs))
+    {
+        ++it;
+    }
+    return it;
+}
+
+void TelemetryWindow::forEach(const std::function<void(const TimedRecord& rec)>& func) const
+{
+    if (m_tracker.m_pHistory)
+    {
+        for (auto it = m_historyBegin; it != m_historyEnd; ++it)
+        {
+            func(*it);
+        }
+        return;
+    }
+    for (const TimedRecord* pRec = m_pBegin; pRec != m_pEnd; ++pRec)
+    {
+        func(*pRec);
+    }
+}
+
+std::vector<TelemetryWindow::CounterStats> TelemetryWindow::getCounterStats() const
+{
+    std::vector<CounterStats> stats;
+    std::unordered_map<String, size_t> indices;
+    forEach([&](const TimedRecord& rec)
+        {
+            m_tracker.getRecordCounters(rec, [&](const String& name, double value)
+                {
+                    auto it = indices.find(name);
+                    if (it == indices.end())
+                    {
+                        it = indices.emplace(name, stats.size()).first;
+                        CounterStats s;
+                        s.name = name;
+                        s.min = s.max = value;
+                        stats.push_back(s);
+                    }
+                    CounterStats& s = stats[it->second];
+                    s.mean += value; // Sum until the end
+                    s.min = std::min(s.min, value);
+                    s.max = std::max(s.max, value);
+                    s.last = value;
+                    ++s.count;
+                });
+        });
+    for (auto& s : stats)
+    {
+        s.mean /= s.count;
+    }
+    return stats;
+}
+} // XI
+#endif // XPUINFO_USE_TELEMETRYTRACKER
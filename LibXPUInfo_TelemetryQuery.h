@@ -0,0 +1,72 @@
+// Copyright (C) 2024 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+// Time-window queries over TelemetryTracker records, i.e. for dashboards and triggers reading recent
+// telemetry while recording continues.
+//
+// Window boundaries are found by binary search, as record timestamps are monotonic.  Records are not
+// copied: without compressed history the window is a span of the tracker's records, else it iterates
+// the compressed history, decoding only the blocks in the window.
+
+#pragma once
+#include "LibXPUInfo.h"
+#include "LibXPUInfo_TelemetryHistory.h"
+
+#ifdef _WIN32
+#pragma warning(push)
+#pragma warning(disable : 4251)
+#endif
+
+#ifdef XPUINFO_USE_TELEMETRYTRACKER
+namespace XI
+{
+    class XPUINFO_EXPORT TelemetryWindow : public NoCopyAssign
+    {
+    public:
+        typedef TelemetryTracker::TimedRecord TimedRecord;
+        struct CounterStats
+        {
+            String name;            // As in TelemetryTracker::getLog()
+            UI32 count = 0;
+            double mean = 0.;       // Of samples
+            double min = 0.;
+            double max = 0.;
+            double last = 0.;
+        };
+
+        // Records with host time (see TelemetryTracker::getHostTimeNs()) in [t0Ns, t1Ns).  Holds tracker's
+        // record mutex until destroyed, so recording waits for it; keep windows short-lived.
+        TelemetryWindow(const TelemetryTracker& tracker, UI64 t0Ns, UI64 t1Ns);
+        // Records of the last durationNs, up to now
+        static TelemetryWindow latest(const TelemetryTracker& tracker, UI64 durationNs);
+
+        const TelemetryTracker& getTracker() const { return m_tracker; }
+        size_t size() const { return m_size; }
+        bool empty() const { return m_size == 0; }
+        // Contiguous records, or nullptr if compressed history is enabled (use forEach)
+        const TimedRecord* data() const { return m_pBegin; }
+        const TimedRecord* begin() const { return m_pBegin; }
+        const TimedRecord* end() const { return m_pEnd; }
+
+        // Each record in order, from either storage
+        void forEach(const std::function<void(const TimedRecord& rec)>& func) const;
+        // Aggregates of each counter reported in the window, in column order
+        std::vector<CounterStats> getCounterStats() const;
+
+    protected:
+        TelemetryHistory::const_iterator historyLowerBound(UI64 timeNs) const;
+
+        const TelemetryTracker& m_tracker;
+        std::unique_lock<std::mutex> m_lock;
+        const TimedRecord* m_pBegin = nullptr;
+        const TimedRecord* m_pEnd = nullptr;
+        TelemetryHistory::const_iterator m_historyBegin;
+        TelemetryHistory::const_iterator m_historyEnd;
+        size_t m_size = 0;
+    };
+} // XI
+#endif // XPUINFO_USE_TELEMETRYTRACKER
+
+#ifdef _WIN32
+#pragma warning(pop)
+#endif
@@ -0,0 +1,171 @@
+// Copyright (C) 2024 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#ifdef XPUINFO_USE_TELEMETRYTRACKER
+#include "LibXPUInfo_TelemetryRealtime.h"
+#include <sstream>
+
+namespace XI
+{
+TelemetryRealtimeWriter::TelemetryRealtimeWriter(const TelemetryTracker& tracker, std::ostream& ostr, const Params& params) :
+    m_tracker(tracker), m_ostr(ostr), m_Params(params), m_queue(params.queueCapacity)
+{
+    XPUINFO_REQUIRE(params.queueCapacity);
+    m_batch.reserve(params.queueCapacity);
+    m_buffer.reserve(size_t(params.batchBytes) + 1024);
+    m_thread = std::thread([this]() { threadFunc(); });
+}
+
+TelemetryRealtimeWriter::~TelemetryRealtimeWriter()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_bStop = true;
+    }
+    m_cvWork.notify_all();
+    m_thread.join();
+}
+
+bool TelemetryRealtimeWriter::push(const TimedRecord& rec, const RecordFormat& format)
+{
+    String header;
+    if (!m_bHeaderCaptured)
+    {
+        std::ostringstream ostr;
+        m_tracker.printRecordHeader(ostr);
+        header = ostr.str();
+        m_bHeaderCaptured = true;
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (header.size())
+    {
+        m_header = std::move(header);
+    }
+    if ((m_count == m_queue.size()) && (m_Params.dropPolicy == TelemetryTracker::REALTIME_BLOCK))
+    {
+        m_cvSpace.wait(lock, [this]() { return (m_count < m_queue.size()) || m_bStop; });
+    }
+    if (m_count == m_queue.size())
+    {
+        if (m_Params.dropPolicy != TelemetryTracker::REALTIME_DROP_OLDEST)
+        {
+            ++m_numDropped;
+            return false;
+        }
+        m_head = (m_head + 1) % m_queue.size();
+        --m_count;
+        ++m_numDone;
+        ++m_numDropped;
+    }
+    auto& queued = m_queue[(m_head + m_count) % m_queue.size()];
+    queued.rec = rec;
+    queued.format = format;
+    ++m_count;
+    ++m_numQueued;
+    lock.unlock();
+    m_cvWork.notify_one();
+    return true;
+}
+
+void TelemetryRealtimeWriter::flush()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    const UI64 target = m_numQueued;
+    m_bFlushRequested = true;
+    m_cvWork.notify_one();
+    m_cvDone.wait(lock, [this, target]() { return m_numFlushed >= target; });
+}
+
+UI64 TelemetryRealtimeWriter::getNumWritten() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_numWritten;
+}
+
+UI64 TelemetryRealtimeWriter::getNumDropped() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_numDropped;
+}
+
+void TelemetryRealtimeWriter::threadFunc()
+{
+    const auto flushInterval = std::chrono::milliseconds(m_Params.flushIntervalMs);
+    auto lastFlush = std::chrono::steady_clock::now();
+    bool bUnflushed = false;
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;)
+    {
+        const auto hasWork = [this]() { return m_count || m_bFlushRequested || m_bStop; };
+        if (bUnflushed && m_Params.flushIntervalMs)
+        {
+            // Flush written records within the interval even if no more arrive
+            m_cvWork.wait_until(lock, lastFlush + flushInterval, hasWork);
+        }
+        else
+        {
+            m_cvWork.wait(lock, hasWork);
+        }
+
+        m_batch.clear();
+        while (m_count)
+        {
+            m_batch.push_back(m_queue[m_head]);
+            m_head = (m_head + 1) % m_queue.size();
+            --m_count;
+        }
+        if (m_header.size())
+        {
+            m_buffer += m_header;
+            m_header.clear();
+        }
+        bool bFlush = m_bFlushRequested || m_bStop;
+        m_bFlushRequested = false;
+        const bool bStop = m_bStop;
+        lock.unlock();
+        m_cvSpace.notify_all();
+
+        // Records are formatted with the state queued with them, not the tracker's
+        for (const auto& queued : m_batch)
+        {
+            m_tracker.appendRecordCSV(queued.rec, queued.format, m_buffer);
+            if (m_buffer.size() >= m_Params.batchBytes)
+            {
+                m_ostr.write(m_buffer.data(), m_buffer.size());
+                m_buffer.clear();
+            }
+        }
+        if (m_buffer.size())
+        {
+            m_ostr.write(m_buffer.data(), m_buffer.size());
+            m_buffer.clear();
+        }
+        bUnflushed = bUnflushed || m_batch.size();
+
+        const auto now = std::chrono::steady_clock::now();
+        bFlush = bFlush || (bUnflushed && (now - lastFlush >= flushInterval));
+        if (bFlush)
+        {
+            m_ostr.flush();
+            lastFlush = now;
+            bUnflushed = false;
+        }
+
+        lock.lock();
+        m_numDone += m_batch.size();
+        m_numWritten += m_batch.size();
+        if (bFlush)
+        {
+            m_numFlushed = m_numDone;
+        }
+        m_cvDone.notify_all();
+        if (bStop && !m_count)
+        {
+            break;
+        }
+    }
+}
+} // XI
+#endif // XPUINFO_USE_TELEMETRYTRACKER
@@ -0,0 +1,83 @@
+// Copyright (C) 2024 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+// Background writer for TelemetryTracker realtime CSV output, so a slow terminal or file does not stall
+// sampling.  The sampler only copies each record into a bounded queue; a writer thread formats queued
+// records into a reused buffer and writes them in batches, flushing the stream at most every
+// flushIntervalMs (see TelemetryTracker::RealtimeOutputParams).
+
+#pragma once
+#include "LibXPUInfo.h"
+#include <condition_variable>
+
+#ifdef _WIN32
+#pragma warning(push)
+#pragma warning(disable : 4251)
+#endif
+
+#ifdef XPUINFO_USE_TELEMETRYTRACKER
+namespace XI
+{
+    class XPUINFO_EXPORT TelemetryRealtimeWriter : public NoCopyAssign
+    {
+    public:
+        typedef TelemetryTracker::TimedRecord TimedRecord;
+        typedef TelemetryTracker::RealtimeOutputParams Params;
+        typedef TelemetryTracker::RecordFormat RecordFormat;
+
+        // tracker and ostr must outlive the writer
+        TelemetryRealtimeWriter(const TelemetryTracker& tracker, std::ostream& ostr, const Params& params);
+        // Writes queued records and flushes
+        ~TelemetryRealtimeWriter();
+
+        // Queue a record and the tracker state to format it with, with the tracker's record mutex held.
+        // The first call also captures the header.  False if dropped.
+        bool push(const TimedRecord& rec, const RecordFormat& format);
+        // Wait until records queued so far are written and the stream is flushed
+        void flush();
+
+        UI64 getNumWritten() const;
+        UI64 getNumDropped() const;
+
+    protected:
+        struct QueuedRecord
+        {
+            TimedRecord rec;
+            RecordFormat format;
+        };
+        void threadFunc();
+
+        const TelemetryTracker& m_tracker;
+        std::ostream& m_ostr;
+        const Params m_Params;
+
+        mutable std::mutex m_mutex;
+        std::condition_variable m_cvWork;   // Writer: records queued, flush or stop requested
+        std::condition_variable m_cvSpace;  // Producer (REALTIME_BLOCK): queue has space
+        std::condition_variable m_cvDone;   // flush(): records written
+        std::vector<QueuedRecord> m_queue;  // Ring of queueCapacity
+        String m_header;                    // Captured by the first push()
+        size_t m_head = 0;
+        size_t m_count = 0;
+        UI64 m_numQueued = 0;               // Including those later dropped by REALTIME_DROP_OLDEST
+        UI64 m_numDone = 0;                 // Written or dropped from the queue
+        UI64 m_numFlushed = 0;              // m_numDone at the last flush
+        UI64 m_numWritten = 0;
+        UI64 m_numDropped = 0;
+        bool m_bFlushRequested = false;
+        bool m_bStop = false;
+
+        // Producer only, with the tracker's record mutex held
+        bool m_bHeaderCaptured = false;
+
+        // Writer thread only
+        std::vector<QueuedRecord> m_batch;
+        String m_buffer;
+        std::thread m_thread;
+    };
+} // XI
+#endif // XPUINFO_USE_TELEMETRYTRACKER
+
+#ifdef _WIN32
+#pragma warning(pop)
+#endif
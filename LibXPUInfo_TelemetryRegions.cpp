@@ -0,0 +1,254 @@
+// Copyright (C) 2024 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#ifdef XPUINFO_USE_TELEMETRYTRACKER
+#include "LibXPUInfo_TelemetryRegions.h"
+#include "LibXPUInfo_Util.h"
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <unordered_map>
+
+namespace XI
+{
+const TelemetryRegionSummary::CounterStats* TelemetryRegionSummary::getCounter(const String& counterName) const
+{
+    for (const auto& c : counters)
+    {
+        if (c.name == counterName)
+        {
+            return &c;
+        }
+    }
+    return nullptr;
+}
+
+std::ostream& operator<<(std::ostream& ostr, const TelemetryRegionSummary& summary)
+{
+    ostr << "Region " << summary.name << "[" << summary.instance << "]: " << summary.getDurationMs() << " ms, "
+        << summary.numSamples << " samples" << (summary.isOpen ? " (open)" : "") << std::endl;
+    for (const auto& c : summary.counters)
+    {
+        ostr << "\t" << c.name << ": " << c.mean << " (" << c.min << " - " << c.max << ")" << std::endl;
+    }
+    return ostr;
+}
+
+TelemetryRegionLog::TelemetryRegionLog(UI32 maxMarkers) :
+    m_maxMarkers(maxMarkers), m_markers(new Marker[maxMarkers])
+{
+    XPUINFO_REQUIRE(maxMarkers);
+}
+
+bool TelemetryRegionLog::append(const char* name, UI64 instance, bool isBegin)
+{
+    const UI64 timeNs = TelemetryTracker::getCurrentHostTimeNs();
+    const UI64 index = m_next.fetch_add(1, std::memory_order_relaxed);
+    if (index >= m_maxMarkers)
+    {
+        m_numDropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    Marker& marker = m_markers[index];
+    marker.name = name;
+    marker.instance = instance;
+    marker.isBegin = isBegin;
+    marker.timeNs.store(timeNs ? timeNs : 1, std::memory_order_release);
+    return true;
+}
+
+UI32 TelemetryRegionLog::getNumMarkers() const
+{
+    return UI32(std::min<UI64>(m_next.load(std::memory_order_relaxed), m_maxMarkers));
+}
+
+std::vector<TelemetryRegionSummary> TelemetryRegionLog::summarize(const TelemetryTracker& tracker) const
+{
+    // Markers from different threads may be appended slightly out of time order
+    std::vector<std::pair<UI64, const Marker*>> markers;
+    const UI32 numMarkers = getNumMarkers();
+    markers.reserve(numMarkers);
+    for (UI32 i = 0; i < numMarkers; ++i)
+    {
+        const UI64 timeNs = m_markers[i].timeNs.load(std::memory_order_acquire);
+        if (timeNs) // Else still being written
+        {
+            markers.emplace_back(timeNs, &m_markers[i]);
+        }
+    }
+    std::stable_sort(markers.begin(), markers.end(),
+        [](const auto& a, const auto& b) { return a.first < b.first; });
+
+    std::vector<TelemetryRegionSummary> summaries;
+    std::map<std::pair<String, UI64>, std::vector<size_t>> openRegions;
+    for (const auto& [timeNs, pMarker] : markers)
+    {
+        auto& open = openRegions[std::make_pair(String(pMarker->name), pMarker->instance)];
+        if (pMarker->isBegin)
+        {
+            open.push_back(summaries.size());
+            TelemetryRegionSummary summary;
+            summary.name = pMarker->name;
+            summary.instance = pMarker->instance;
+            summary.beginNs = summary.endNs = timeNs;
+            summary.isOpen = true;
+            summaries.push_back(summary);
+        }
+        else if (open.size()) // Ignore unmatched end
+        {
+            auto& summary = summaries[open.back()];
+            summary.endNs = timeNs;
+            summary.isOpen = false;
+            open.pop_back();
+        }
+    }
+
+    struct Accum
+    {
+        double integral = 0.;   // Value * seconds
+        double covered = 0.;    // Seconds
+        double pointSum = 0.;   // Samples within the region, if no covered time
+        UI32 numPoints = 0;
+        double min = std::numeric_limits<double>::max();
+        double max = std::numeric_limits<double>::lowest();
+
+        void addPoint(double v)
+        {
+            pointSum += v;
+            ++numPoints;
+            min = std::min(min, v);
+            max = std::max(max, v);
+        }
+    };
+    struct Point
+    {
+        bool bValid = false;    // No sample yet
+        UI64 recordIndex = 0;
+        UI64 timeNs = 0;
+        double value = 0.;
+    };
+    std::unordered_map<String, UI32> counterIndices;
+    std::vector<String> counterNames;
+    std::vector<Point> prevPoints;
+    std::vector<std::vector<Accum>> accums(summaries.size());
+
+    std::lock_guard<std::mutex> lock(tracker.m_RecordMutex);
+    if (tracker.m_records.size())
+    {
+        // Open regions end at the latest record
+        const UI64 lastNs = tracker.getHostTimeNs(tracker.m_records.back());
+        for (auto& summary : summaries)
+        {
+            if (summary.isOpen)
+            {
+                summary.endNs = std::max(summary.beginNs, lastNs);
+            }
+        }
+    }
+
+    // Regions are in order of beginning.  Active regions may overlap the segment ending at the current record.
+    std::vector<size_t> active;
+    size_t nextRegion = 0;
+    UI64 recordIndex = 0;
+    tracker.forEachRecord([&](const TelemetryTracker::TimedRecord& rec, const TelemetryTracker::TimedRecord*)
+        {
+            const UI64 t = tracker.getHostTimeNs(rec);
+            while ((nextRegion < summaries.size()) && (summaries[nextRegion].beginNs <= t))
+            {
+                active.push_back(nextRegion++);
+            }
+            for (size_t r : active)
+            {
+                if (t <= summaries[r].endNs && t >= summaries[r].beginNs)
+                {
+                    ++summaries[r].numSamples;
+                }
+            }
+
+            tracker.getRecordCounters(rec, [&](const String& name, double value)
+                {
+                    if (!std::isfinite(value))
+                    {
+                        return;
+                    }
+                    auto itIndex = counterIndices.find(name);
+                    if (itIndex == counterIndices.end())
+                    {
+                        itIndex = counterIndices.emplace(name, UI32(counterNames.size())).first;
+                        counterNames.push_back(name);
+                        prevPoints.emplace_back();
+                    }
+                    const UI32 c = itIndex->second;
+                    const Point& p = prevPoints[c];
+                    const bool bSegment = p.bValid && (p.recordIndex + 1 == recordIndex) && (t > p.timeNs);
+
+                    for (size_t r : active)
+                    {
+                        const auto& summary = summaries[r];
+                        auto& acc = accums[r];
+                        if (acc.size() <= c)
+                        {
+                            acc.resize(c + 1);
+                        }
+                        if (t >= summary.beginNs && t <= summary.endNs)
+                        {
+                            acc[c].addPoint(value);
+                        }
+                        if (!bSegment)
+                        {
+                            continue;
+                        }
+
+                        // Linear between the previous sample and this one
+                        const UI64 a = std::max(p.timeNs, summary.beginNs);
+                        const UI64 b = std::min(t, summary.endNs);
+                        if (a > b)
+                        {
+                            continue;
+                        }
+                        const double slope = (value - p.value) / double(t - p.timeNs);
+                        const double va = p.value + slope * double(a - p.timeNs);
+                        const double vb = p.value + slope * double(b - p.timeNs);
+                        if (b > a)
+                        {
+                            const double secs = (b - a) * 1e-9;
+                            acc[c].integral += 0.5 * (va + vb) * secs;
+                            acc[c].covered += secs;
+                            acc[c].min = std::min({ acc[c].min, va, vb });
+                            acc[c].max = std::max({ acc[c].max, va, vb });
+                        }
+                        else if (summary.beginNs == summary.endNs)
+                        {
+                            acc[c].addPoint(va);
+                        }
+                    }
+                    prevPoints[c] = { true, recordIndex, t, value };
+                });
+
+            // Later segments start at t
+            active.erase(std::remove_if(active.begin(), active.end(),
+                [&summaries, t](size_t r) { return summaries[r].endNs <= t; }), active.end());
+            ++recordIndex;
+        });
+
+    for (size_t r = 0; r < summaries.size(); ++r)
+    {
+        for (UI32 c = 0; c < accums[r].size(); ++c)
+        {
+            const Accum& acc = accums[r][c];
+            if ((acc.covered <= 0.) && !acc.numPoints)
+            {
+                continue;
+            }
+            TelemetryRegionSummary::CounterStats stats;
+            stats.name = counterNames[c];
+            stats.mean = (acc.covered > 0.) ? acc.integral / acc.covered : acc.pointSum / acc.numPoints;
+            stats.min = acc.min;
+            stats.max = acc.max;
+            summaries[r].counters.push_back(stats);
+        }
+    }
+    return summaries;
+}
+} // XI
+#endif // XPUINFO_USE_TELEMETRYTRACKER
@@ -0,0 +1,104 @@
+// Copyright (C) 2024 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+// Application region markers for TelemetryTracker, and per-region telemetry summaries.
+//
+// Markers are timestamped on the tracker's host clock (TelemetryTracker::getCurrentHostTimeNs()) and
+// appended lock-free to a fixed-capacity log, so they can be placed on hot paths from any thread.
+// Summaries treat each tracker counter as linear between samples, so values are interpolated at region
+// boundaries and regions shorter than the sampling period still get a value.
+
+#pragma once
+#include "LibXPUInfo.h"
+#include <atomic>
+#include <memory>
+
+#ifdef _WIN32
+#pragma warning(push)
+#pragma warning(disable : 4251)
+#endif
+
+#ifdef XPUINFO_USE_TELEMETRYTRACKER
+namespace XI
+{
+    struct XPUINFO_EXPORT TelemetryRegionSummary
+    {
+        struct CounterStats
+        {
+            String name;            // As in TelemetryTracker::getLog()
+            double mean = 0.;       // Time-weighted
+            double min = 0.;
+            double max = 0.;
+        };
+
+        String name;
+        UI64 instance = 0;
+        UI64 beginNs = 0;           // Host clock
+        UI64 endNs = 0;
+        bool isOpen = false;        // No endRegion() yet; ends at the last record
+        UI32 numSamples = 0;        // Records within [beginNs, endNs]
+        std::vector<CounterStats> counters;
+
+        double getDurationMs() const { return (endNs - beginNs) * 1e-6; }
+        const CounterStats* getCounter(const String& counterName) const;
+    };
+    XPUINFO_EXPORT std::ostream& operator<<(std::ostream& ostr, const TelemetryRegionSummary& summary);
+
+    class XPUINFO_EXPORT TelemetryRegionLog : public NoCopyAssign
+    {
+    public:
+        // name must outlive the log (i.e. a string literal); it is not copied.  Regions are matched by
+        // name and instance, innermost first if nested.
+        TelemetryRegionLog(UI32 maxMarkers);
+
+        // False if the log is full
+        bool begin(const char* name, UI64 instance = 0) { return append(name, instance, true); }
+        bool end(const char* name, UI64 instance = 0) { return append(name, instance, false); }
+
+        UI32 getNumMarkers() const;
+        UI64 getNumDropped() const { return m_numDropped.load(std::memory_order_relaxed); }
+
+        // Regions in order of beginning, with aggregates over tracker's records
+        std::vector<TelemetryRegionSummary> summarize(const TelemetryTracker& tracker) const;
+
+    protected:
+        struct Marker
+        {
+            const char* name = nullptr;
+            UI64 instance = 0;
+            bool isBegin = false;
+            std::atomic<UI64> timeNs{ 0 }; // Set last; 0 while being written
+        };
+        bool append(const char* name, UI64 instance, bool isBegin);
+
+        const UI32 m_maxMarkers;
+        std::unique_ptr<Marker[]> m_markers;
+        std::atomic<UI64> m_next{ 0 };
+        std::atomic<UI64> m_numDropped{ 0 };
+    };
+
+    // Region for the lifetime of this object; no-op if tracker's region markers are not enabled
+    class XPUINFO_EXPORT ScopedTelemetryRegion : public NoCopyAssign
+    {
+    public:
+        ScopedTelemetryRegion(TelemetryTracker& tracker, const char* name, UI64 instance = 0) :
+            m_tracker(tracker), m_name(name), m_instance(instance)
+        {
+            m_tracker.beginRegion(m_name, m_instance);
+        }
+        ~ScopedTelemetryRegion()
+        {
+            m_tracker.endRegion(m_name, m_instance);
+        }
+
+    protected:
+        TelemetryTracker& m_tracker;
+        const char* const m_name;
+        const UI64 m_instance;
+    };
+} // XI
+#endif // XPUINFO_USE_TELEMETRYTRACKER
+
+#ifdef _WIN32
+#pragma warning(pop)
+#endif
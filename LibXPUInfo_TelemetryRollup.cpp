@@ -0,0 +1,196 @@
+// Copyright (C) 2024 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#ifdef XPUINFO_USE_TELEMETRYTRACKER
+#include "LibXPUInfo_TelemetryRollup.h"
+#include <algorithm>
+#include <cmath>
+
+namespace XI
+{
+namespace
+{
+    void mergeStats(TelemetryRollup::CounterStats& dst, const TelemetryRollup::CounterStats& src)
+    {
+        if (!dst.count)
+        {
+            dst = src;
+            return;
+        }
+        dst.count += src.count;
+        dst.min = std::min(dst.min, src.min);
+        dst.max = std::max(dst.max, src.max);
+        dst.sum += src.sum;
+        dst.last = src.last;
+    }
+}
+
+TelemetryRollup::TelemetryRollup(const std::vector<Tier>& tiers, UI32 maxCounters) :
+    m_maxCounters(maxCounters)
+{
+    XPUINFO_REQUIRE_MSG(tiers.size() && maxCounters, "TelemetryRollup needs tiers and counters");
+    m_tiers.resize(tiers.size());
+    for (size_t i = 0; i < tiers.size(); ++i)
+    {
+        XPUINFO_REQUIRE_MSG(tiers[i].bucketMs && tiers[i].numBuckets, "Rollup tiers need a bucket duration and count");
+        XPUINFO_REQUIRE_MSG(!i || (tiers[i].bucketMs % tiers[i - 1].bucketMs == 0),
+            "Rollup bucket durations must be multiples of the previous tier's");
+        TierState& ts = m_tiers[i];
+        ts.tier = tiers[i];
+        ts.bucketNs = UI64(tiers[i].bucketMs) * 1000000ULL;
+        ts.startNs.resize(tiers[i].numBuckets);
+        ts.numSamples.resize(tiers[i].numBuckets);
+        ts.counters.resize(size_t(tiers[i].numBuckets) * maxCounters);
+    }
+}
+
+UI32 TelemetryRollup::getNumCounters() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return UI32(m_counterNames.size());
+}
+
+std::vector<String> TelemetryRollup::getCounterNames() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_counterNames;
+}
+
+I32 TelemetryRollup::getCounterIndex(const String& name) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_counterIndices.find(name);
+    return (it != m_counterIndices.end()) ? I32(it->second) : -1;
+}
+
+UI64 TelemetryRollup::getNumIgnoredValues() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_numIgnored;
+}
+
+size_t TelemetryRollup::getBytes() const
+{
+    size_t bytes = sizeof(*this);
+    for (const auto& ts : m_tiers)
+    {
+        bytes += sizeof(ts) + ts.startNs.size() * (sizeof(UI64) + sizeof(UI32)) + ts.counters.size() * sizeof(CounterStats);
+    }
+    return bytes;
+}
+
+size_t TelemetryRollup::currentBucket(UI32 tier, UI64 timeNs)
+{
+    TierState& ts = m_tiers[tier];
+    const UI64 startNs = timeNs - timeNs % ts.bucketNs;
+    if (ts.count && (startNs <= ts.startNs[ts.newest()]))
+    {
+        // Current bucket, or late samples which are kept in it
+        return ts.newest();
+    }
+
+    if (ts.count)
+    {
+        const size_t closing = ts.newest();
+        if (tier + 1 < m_tiers.size())
+        {
+            merge(tier + 1, ts.startNs[closing], ts.numSamples[closing], &ts.counters[closing * m_maxCounters]);
+        }
+    }
+    if (ts.count == ts.startNs.size())
+    {
+        ts.head = (ts.head + 1) % ts.startNs.size();
+    }
+    else
+    {
+        ++ts.count;
+    }
+    const size_t bucket = ts.newest();
+    ts.startNs[bucket] = startNs;
+    ts.numSamples[bucket] = 0;
+    std::fill_n(ts.counters.begin() + bucket * m_maxCounters, m_maxCounters, CounterStats());
+    return bucket;
+}
+
+void TelemetryRollup::merge(UI32 tier, UI64 startNs, UI32 numSamples, const CounterStats* counters)
+{
+    TierState& ts = m_tiers[tier];
+    const size_t bucket = currentBucket(tier, startNs);
+    ts.numSamples[bucket] += numSamples;
+    CounterStats* dst = &ts.counters[bucket * m_maxCounters];
+    for (size_t c = 0; c < m_counterNames.size(); ++c)
+    {
+        if (counters[c].count)
+        {
+            mergeStats(dst[c], counters[c]);
+        }
+    }
+}
+
+void TelemetryRollup::add(const TelemetryTracker& tracker, const TelemetryTracker::TimedRecord& rec)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    TierState& ts = m_tiers[0];
+    const size_t bucket = currentBucket(0, tracker.getHostTimeNs(rec));
+    ++ts.numSamples[bucket];
+    CounterStats* counters = &ts.counters[bucket * m_maxCounters];
+    tracker.getRecordCounters(rec, [this, counters](const String& name, double value)
+        {
+            if (!std::isfinite(value))
+            {
+                return;
+            }
+            auto it = m_counterIndices.find(name);
+            if (it == m_counterIndices.end())
+            {
+                if (m_counterNames.size() == m_maxCounters)
+                {
+                    ++m_numIgnored;
+                    return;
+                }
+                it = m_counterIndices.emplace(name, UI32(m_counterNames.size())).first;
+                m_counterNames.push_back(name);
+            }
+            CounterStats sample;
+            sample.count = 1;
+            sample.min = sample.max = sample.sum = sample.last = value;
+            mergeStats(counters[it->second], sample);
+        });
+}
+
+void TelemetryRollup::forEachBucket(UI32 tier, UI64 t0Ns, UI64 t1Ns, const BucketFunc& func) const
+{
+    XPUINFO_REQUIRE(tier < m_tiers.size());
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const TierState& ts = m_tiers[tier];
+    const size_t n = ts.startNs.size();
+    // Buckets are in time order from head; first bucket ending after t0Ns
+    size_t lo = 0, hi = ts.count;
+    while (lo < hi)
+    {
+        const size_t mid = (lo + hi) / 2;
+        if (ts.startNs[(ts.head + mid) % n] + ts.bucketNs <= t0Ns)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+    for (size_t i = lo; i < ts.count; ++i)
+    {
+        const size_t b = (ts.head + i) % n;
+        if (ts.startNs[b] >= t1Ns)
+        {
+            break;
+        }
+        Bucket bucket;
+        bucket.startNs = ts.startNs[b];
+        bucket.numSamples = ts.numSamples[b];
+        bucket.counters = &ts.counters[b * m_maxCounters];
+        func(bucket);
+    }
+}
+} // XI
+#endif // XPUINFO_USE_TELEMETRYTRACKER
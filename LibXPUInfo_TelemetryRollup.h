@@ -0,0 +1,93 @@
+// Copyright (C) 2024 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+// Multi-resolution rollups of TelemetryTracker counters, for long-running retention in fixed memory.
+//
+// Each tier is a ring of fixed-duration buckets holding the min, max, mean and last value of each
+// counter (as in TelemetryTracker::getLog()).  Records update the current bucket of the finest tier;
+// when a bucket closes it is merged into the current bucket of the next tier, so coarser tiers include
+// finer buckets once they close.  Bucket storage is allocated up front for maxCounters counters.
+
+#pragma once
+#include "LibXPUInfo.h"
+#include <unordered_map>
+
+#ifdef _WIN32
+#pragma warning(push)
+#pragma warning(disable : 4251)
+#endif
+
+#ifdef XPUINFO_USE_TELEMETRYTRACKER
+namespace XI
+{
+    class XPUINFO_EXPORT TelemetryRollup : public NoCopyAssign
+    {
+    public:
+        typedef TelemetryTracker::RollupTier Tier;
+        struct CounterStats
+        {
+            UI32 count = 0;         // Samples of this counter
+            double min = 0.;
+            double max = 0.;
+            double sum = 0.;
+            double last = 0.;
+            double getMean() const { return count ? sum / count : std::numeric_limits<double>::quiet_NaN(); }
+        };
+        struct Bucket
+        {
+            UI64 startNs = 0;               // Host clock, aligned to the tier's bucket duration
+            UI32 numSamples = 0;            // Records
+            const CounterStats* counters = nullptr; // getNumCounters(), indexed as getCounterNames()
+        };
+
+        // Each tier's bucket duration must be a multiple of the previous tier's
+        TelemetryRollup(const std::vector<Tier>& tiers, UI32 maxCounters);
+
+        UI32 getNumTiers() const { return UI32(m_tiers.size()); }
+        const Tier& getTier(UI32 tier) const { return m_tiers[tier].tier; }
+        UI32 getNumCounters() const;
+        std::vector<String> getCounterNames() const;
+        // -1 if not recorded
+        I32 getCounterIndex(const String& name) const;
+        // Counters beyond maxCounters are not rolled up
+        UI64 getNumIgnoredValues() const;
+        size_t getBytes() const;
+
+        // Buckets of tier overlapping [t0Ns, t1Ns) that have samples, oldest first.  The newest bucket may
+        // still be open.  Called with the rollup locked; do not call other methods from func.
+        typedef std::function<void(const Bucket& bucket)> BucketFunc;
+        void forEachBucket(UI32 tier, UI64 t0Ns, UI64 t1Ns, const BucketFunc& func) const;
+
+    protected:
+        friend class TelemetryTracker;
+        // Called with tracker's record mutex held
+        void add(const TelemetryTracker& tracker, const TelemetryTracker::TimedRecord& rec);
+
+        struct TierState
+        {
+            Tier tier;
+            UI64 bucketNs = 0;
+            std::vector<UI64> startNs;          // Ring of tier.numBuckets
+            std::vector<UI32> numSamples;
+            std::vector<CounterStats> counters; // maxCounters per bucket
+            size_t head = 0;                    // Oldest
+            size_t count = 0;
+            size_t newest() const { return (head + count - 1) % startNs.size(); }
+        };
+        // Current bucket of tier for timeNs, opening (and cascading) as needed
+        size_t currentBucket(UI32 tier, UI64 timeNs);
+        void merge(UI32 tier, UI64 startNs, UI32 numSamples, const CounterStats* counters);
+
+        const UI32 m_maxCounters;
+        mutable std::mutex m_mutex;
+        std::vector<TierState> m_tiers;
+        std::vector<String> m_counterNames;
+        std::unordered_map<String, UI32> m_counterIndices;
+        UI64 m_numIgnored = 0;
+    };
+} // XI
+#endif // XPUINFO_USE_TELEMETRYTRACKER
+
+#ifdef _WIN32
+#pragma warning(pop)
+#endif
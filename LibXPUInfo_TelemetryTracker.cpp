@@ -4,12 +4,24 @@
 #ifdef XPUINFO_USE_TELEMETRYTRACKER
 #include "LibXPUInfo.h"
 #include "LibXPUInfo_Util.h"
+#include "LibXPUInfo_HostTelemetry.h"
+#include "LibXPUInfo_ResCtrl.h"
+#include "LibXPUInfo_TraceExport.h"
+#include "LibXPUInfo_TelemetryHistory.h"
+#include "LibXPUInfo_TelemetryRegions.h"
+#include "LibXPUInfo_TelemetryRealtime.h"
+#include "LibXPUInfo_TelemetryRollup.h"
+#include "LibXPUInfo_TelemetryChange.h"
+#include "LibXPUInfo_TelemetryClock.h"
 #ifdef _WIN32
 #include <Pdh.h>
 #include <PdhMsg.h>
 #pragma comment(lib, "pdh")
 #endif // _WIN32
 
+#include <algorithm>
+#include <charconv>
+#include <cmath>
 #include <iomanip>
 
 namespace XI
@@ -18,34 +30,45 @@ namespace XI
 void TelemetryTracker::printRecordHeader(std::ostream& ostr) const
 {
 	ostr << "Time(s)";
-#if defined(_WIN32) && !defined(_M_ARM64)
-	ostr << ", %CPU, CPU Freq (MHz)";
-#endif
-	if (m_ResultMask & TELEMETRYITEM_FREQUENCY)
-		ostr << ", Freq(MHz)";
-	bool haveBW = (m_ResultMask & (TELEMETRYITEM_READ_BW | TELEMETRYITEM_WRITE_BW)) == (TELEMETRYITEM_READ_BW | TELEMETRYITEM_WRITE_BW);
-	if (haveBW)
+	// Column names come from the counter table so that they match getRecordCounters()
+	for (const auto& desc : m_counterDescs)
 	{
-		ostr << ",Rd BW(MB/s),Wr BW(MB/s),BW(MB/s)";
-	}
-	if (m_ResultMask & TELEMETRYITEM_GLOBAL_ACTIVITY)
-		ostr << ",% Global";
-	if (m_ResultMask & TELEMETRYITEM_RENDER_COMPUTE_ACTIVITY)
-		ostr << ",% Compute";
-	if (m_ResultMask & TELEMETRYITEM_MEDIA_ACTIVITY)
-		ostr << ",% Media";
-	if (m_ResultMask & TELEMETRYITEM_MEMORY_USAGE)
-		ostr << ",Device Memory Used (MB)";
-	if (m_ResultMask & TELEMETRYITEM_FREQUENCY_MEDIA)
-		ostr << ",Media Freq (MHz)";
-	if (m_ResultMask & TELEMETRYITEM_FREQUENCY_MEMORY)
-		ostr << ",Memory Freq (GT/s)";
+		if ((m_ResultMask & desc.mask) == desc.mask)
+		{
+			ostr << ',' << desc.name;
+		}
+	}
 	ostr << std::endl;
 }
 
+UI32 TelemetryTracker::getCPUCoreTypeIndex(short coreType)
+{
+#if XPUINFO_CPU_X86_64
+	if (coreType == HybridDetect::CoreTypes::INTEL_ATOM)
+	{
+		return 1;
+	}
+#else
+	if (coreType == HybridDetect::CoreTypes::PERFLEVEL1)
+	{
+		return 1;
+	}
+#endif
+	return 0;
+}
+
 UI64 TelemetryTracker::getMaxMemUsage() const 
 {
+	std::lock_guard<std::mutex> lock(m_RecordMutex);
 	UI64 maxMemUsage = 0;
+	if (m_pHistory)
+	{
+		for (const auto& rec : *m_pHistory)
+		{
+			maxMemUsage = std::max(maxMemUsage, rec.deviceMemoryUsedBytes);
+		}
+		return maxMemUsage;
+	}
 	for (const auto& rec : m_records)
 	{
 		maxMemUsage = std::max(maxMemUsage, rec.deviceMemoryUsedBytes);
@@ -55,135 +78,609 @@ UI64 TelemetryTracker::getMaxMemUsage() const
 
 UI64 TelemetryTracker::getInitialMemUsage() const
 {
+	std::lock_guard<std::mutex> lock(m_RecordMutex);
 	UI64 memUsage = 0;
-	if (m_records.size())
+	if (m_pHistory)
+	{
+		if (!m_pHistory->empty())
+		{
+			memUsage = m_pHistory->begin()->deviceMemoryUsedBytes;
+		}
+	}
+	else if (m_records.size())
 	{
 		memUsage = m_records.front().deviceMemoryUsedBytes;
 	}
 	return memUsage;
 }
 
+void TelemetryTracker::enableCompressedHistory(size_t maxBytes)
+{
+	std::lock_guard<std::mutex> lock(m_RecordMutex);
+	XPUINFO_REQUIRE_MSG(m_records.empty(), "enableCompressedHistory must be called before start()");
+	m_pHistory.reset(new TelemetryHistory(maxBytes));
+}
+
+void TelemetryTracker::setRealtimeOutputParams(const RealtimeOutputParams& params)
+{
+	XPUINFO_REQUIRE_MSG(params.queueCapacity, "queueCapacity must be non-zero");
+	std::lock_guard<std::mutex> lock(m_RecordMutex);
+	XPUINFO_REQUIRE_MSG(m_records.empty(), "setRealtimeOutputParams must be called before start()");
+	if (m_pRealtime_ostr)
+	{
+		m_pRealtimeWriter.reset();
+		m_pRealtimeWriter.reset(new TelemetryRealtimeWriter(*this, *m_pRealtime_ostr, params));
+	}
+}
+
+void TelemetryTracker::enableRollups(const std::vector<RollupTier>& tiers, UI32 maxCounters, UI32 rawRetentionMs)
+{
+	std::lock_guard<std::mutex> lock(m_RecordMutex);
+	XPUINFO_REQUIRE_MSG(m_records.empty(), "enableRollups must be called before start()");
+	m_pRollup.reset(new TelemetryRollup(tiers, maxCounters));
+	m_rawRetentionNs = UI64(rawRetentionMs) * 1000000ULL;
+}
+
+bool TelemetryTracker::addChangeDetector(const ChangeDetectorParams& params)
+{
+	std::lock_guard<std::mutex> lock(m_RecordMutex);
+	XPUINFO_REQUIRE_MSG(m_records.empty(), "addChangeDetector must be called before start()");
+	auto it = std::find_if(m_counterDescs.begin(), m_counterDescs.end(),
+		[&params](const CounterDesc& desc) { return desc.name == params.counterName; });
+	if (it == m_counterDescs.end())
+	{
+		return false;
+	}
+	m_changeDetectors.push_back({ *it, SharedPtr<TelemetryChangeDetector>(new TelemetryChangeDetector(params)) });
+	return true;
+}
+
+void TelemetryTracker::setChangeEventCallback(const ChangeEventFunc& func)
+{
+	std::lock_guard<std::mutex> lock(m_RecordMutex);
+	m_changeEventFunc = func;
+}
+
+std::vector<TelemetryTracker::ChangeEvent> TelemetryTracker::getChangeEvents() const
+{
+	std::lock_guard<std::mutex> lock(m_RecordMutex);
+	return m_changeEvents;
+}
+
+void TelemetryTracker::detectChanges(const TimedRecord& rec, std::vector<ChangeEvent>& newEvents)
+{
+	static constexpr size_t kMaxChangeEvents = 4096;
+	const UI64 timeNs = getHostTimeNs(rec);
+	for (auto& entry : m_changeDetectors)
+	{
+		double value;
+		ChangeEvent event;
+		if (getCounter(entry.counter, rec, value) && entry.pDetector->update(timeNs, value, event))
+		{
+			if (m_changeEvents.size() < kMaxChangeEvents)
+			{
+				m_changeEvents.push_back(event);
+			}
+			else
+			{
+				++m_numChangeEventsDropped;
+			}
+			if (m_changeEventFunc)
+			{
+				newEvents.push_back(event);
+			}
+		}
+	}
+}
+
+void TelemetryTracker::printChangeEvents(std::ostream& ostr) const
+{
+	if (m_changeEvents.empty())
+	{
+		return;
+	}
+	ostr << "Change points:" << std::endl;
+	for (const auto& event : m_changeEvents)
+	{
+		const auto secs = [this](UI64 timeNs) { return (timeNs > m_startHostTimeNs) ? (timeNs - m_startHostTimeNs) * 1e-9 : 0.; };
+		ostr << "\t" << secs(event.timeNs) << "s " << event.counterName << ": "
+			<< event.beforeMean << " (sd " << event.beforeStdDev << ") -> "
+			<< event.afterMean << " (sd " << event.afterStdDev << ") since " << secs(event.onsetNs) << "s, "
+			<< ((event.method == CHANGE_DETECTOR_EWMA) ? "EWMA" : "CUSUM") << std::endl;
+	}
+	if (m_numChangeEventsDropped)
+	{
+		ostr << "\t" << m_numChangeEventsDropped << " more not listed" << std::endl;
+	}
+}
+
+void TelemetryTracker::enableRegionMarkers(UI32 maxMarkers)
+{
+	std::lock_guard<std::mutex> lock(m_RecordMutex);
+	XPUINFO_REQUIRE_MSG(m_records.empty(), "enableRegionMarkers must be called before start()");
+	m_pRegionLog.reset(new TelemetryRegionLog(maxMarkers));
+}
+
+bool TelemetryTracker::beginRegion(const char* name, UI64 instance)
+{
+	return m_pRegionLog && m_pRegionLog->begin(name, instance);
+}
+
+bool TelemetryTracker::endRegion(const char* name, UI64 instance)
+{
+	return m_pRegionLog && m_pRegionLog->end(name, instance);
+}
+
+void TelemetryTracker::forEachRecord(const RecordFunc& func) const
+{
+	if (m_pHistory)
+	{
+		TimedRecord prev{};
+		bool bHavePrev = false;
+		for (const auto& rec : *m_pHistory)
+		{
+			func(rec, bHavePrev ? &prev : nullptr);
+			prev = rec;
+			bHavePrev = true;
+		}
+		return;
+	}
+	const TimedRecord* pPrev = nullptr;
+	for (const auto& rec : m_records)
+	{
+		func(rec, pPrev);
+		pPrev = &rec;
+	}
+}
+
 const DevicePtr& TelemetryTracker::getDevice() const
 {
     return m_Device;
 }
 
-void TelemetryTracker::printRecord(TimedRecords::const_iterator it, std::ostream& ostr) const
+Result<TelemetryTracker::TimedRecord> TelemetryTracker::tryGetLatestRecord() const noexcept
 {
-	const auto& rec = *it;
-	const auto default_precision{ ostr.precision() };
-
-	if (m_ResultMask & TELEMETRYITEM_TIMESTAMP_DOUBLE)
+	std::lock_guard<std::mutex> lock(m_RecordMutex);
+	if (m_records.empty())
 	{
-		ostr << rec.timeStamp - m_startTime;
+		return Status::UNAVAILABLE;
 	}
-	else
+	return m_records.back();
+}
+
+namespace
+{
+	UI64 ticksToNs(UI64 ticks, UI64 freq)
 	{
-		XPUINFO_REQUIRE(m_timestamp_freq != 0);
-		auto elapsed_Secs = (rec.timeStampUI64 - m_startTimeUI64) / double(m_timestamp_freq);
-		ostr << elapsed_Secs;
+		// Split to avoid overflow of ticks * 1e9
+		return (ticks / freq) * 1000000000ULL + ((ticks % freq) * 1000000000ULL) / freq;
 	}
+}
 
-#if defined(_WIN32) && !defined(_M_ARM64)
-	ostr << "," << rec.pctCPU << "," << rec.cpu_freq / (100.0);
+UI64 TelemetryTracker::getCurrentHostTimeNs()
+{
+#ifdef _WIN32
+	LARGE_INTEGER ticks, freq;
+	QueryPerformanceCounter(&ticks);
+	QueryPerformanceFrequency(&freq);
+	return ticksToNs(UI64(ticks.QuadPart), UI64(freq.QuadPart));
+#else
+	return (UI64)std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
 #endif
+}
 
-	if (m_ResultMask & TELEMETRYITEM_FREQUENCY)
+UI64 TelemetryTracker::getHostTimeNs(const TimedRecord& rec) const
+{
+	if (m_ResultMask & TELEMETRYITEM_TIMESTAMP_DOUBLE)
 	{
-		ostr << "," << rec.freq;
+		return deviceToHostNs(rec.timeStamp);
 	}
-	bool haveBW = (m_ResultMask & (TELEMETRYITEM_READ_BW | TELEMETRYITEM_WRITE_BW)) == (TELEMETRYITEM_READ_BW | TELEMETRYITEM_WRITE_BW);
-	if ((it - m_records.begin()) > 0)
+	XPUINFO_REQUIRE(m_timestamp_freq != 0);
+	return ticksToNs(rec.timeStampUI64, m_timestamp_freq);
+}
+
+void TelemetryTracker::setClockCorrelationParams(const ClockCorrelationParams& params)
+{
+	XPUINFO_REQUIRE_MSG(params.minFitSpanSec > 0., "minFitSpanSec must be positive");
+	XPUINFO_REQUIRE_MSG(params.maxDriftPPM >= 0., "maxDriftPPM must not be negative");
+	std::lock_guard<std::mutex> lock(m_RecordMutex);
+	XPUINFO_REQUIRE_MSG(m_records.empty(), "setClockCorrelationParams must be called before start()");
+	m_ClockParams = params;
+}
+
+TelemetryTracker::ClockCorrelation TelemetryTracker::getClockCorrelation() const
+{
+	std::lock_guard<std::mutex> lock(m_RecordMutex);
+	return m_pClockCorrelator ? m_pClockCorrelator->getCorrelation() : ClockCorrelation();
+}
+
+void TelemetryTracker::correlateClock(double deviceSec, UI64 hostBeforeNs, UI64 hostAfterNs)
+{
+	if (!m_pClockCorrelator)
 	{
-		const auto& prev = *(it - 1);
-		double tDelta = rec.timeStamp - prev.timeStamp;
+		m_pClockCorrelator.reset(new TelemetryClockCorrelator(m_ClockParams));
+	}
+	m_pClockCorrelator->addPair(deviceSec, hostBeforeNs, hostAfterNs);
+}
 
-		if (haveBW)
-		{
-			UI64 rdDelta = rec.bw_read - prev.bw_read;
-			UI64 wrDelta = rec.bw_write - prev.bw_write;
-			UI64 bwDelta = rdDelta + wrDelta;
-			ostr << "," << rdDelta / (tDelta * (1024 * 1024));
-			ostr << "," << wrDelta / (tDelta * (1024 * 1024));
-			ostr << "," << bwDelta / (tDelta * (1024 * 1024));
-		}
-		if ((m_ResultMask & (TELEMETRYITEM_GLOBAL_ACTIVITY | TELEMETRYITEM_TIMESTAMP_DOUBLE)) == (TELEMETRYITEM_GLOBAL_ACTIVITY | TELEMETRYITEM_TIMESTAMP_DOUBLE))
-		{
-			ostr << "," << (rec.activity_global - prev.activity_global) * 100. / tDelta;
-		}
-		if ((m_ResultMask & (TELEMETRYITEM_RENDER_COMPUTE_ACTIVITY | TELEMETRYITEM_TIMESTAMP_DOUBLE)) == (TELEMETRYITEM_RENDER_COMPUTE_ACTIVITY | TELEMETRYITEM_TIMESTAMP_DOUBLE))
+UI64 TelemetryTracker::deviceToHostNs(double deviceSec) const
+{
+	if (m_pClockCorrelator && m_pClockCorrelator->isValid())
+	{
+		return m_pClockCorrelator->toHostNs(deviceSec);
+	}
+	return m_startHostTimeNs + UI64(std::max(0., deviceSec - m_startTime) * 1e9);
+}
+
+double TelemetryTracker::hostToDeviceSec(UI64 hostNs) const
+{
+	if (m_pClockCorrelator && m_pClockCorrelator->isValid())
+	{
+		return m_pClockCorrelator->toDeviceSec(hostNs);
+	}
+	return m_startTime + ((hostNs > m_startHostTimeNs) ? (hostNs - m_startHostTimeNs) * 1e-9 : 0.);
+}
+
+void TelemetryTracker::setTraceWriter(TelemetryTraceWriter* pWriter)
+{
+	std::lock_guard<std::mutex> lock(m_RecordMutex);
+	m_pTraceWriter = pWriter;
+}
+
+namespace
+{
+	// Delta of a counter of the given width.  A decrease is a wrap if the previous value was in the top
+	// quarter of the range and the new one in the bottom quarter, else the counter was reset to 0.
+	UI64 counterDelta(UI64 cur, UI64 prev, UI32 bits, UI32 item, UI32& wrapMask, UI32& resetMask)
+	{
+		const UI64 mask = (bits >= 64) ? ~0ULL : ((1ULL << bits) - 1);
+		cur &= mask;
+		prev &= mask;
+		if (cur >= prev)
 		{
-			ostr << "," << (rec.activity_compute - prev.activity_compute) * 100. / tDelta;
+			return cur - prev;
 		}
-		if ((m_ResultMask & (TELEMETRYITEM_MEDIA_ACTIVITY | TELEMETRYITEM_TIMESTAMP_DOUBLE)) == (TELEMETRYITEM_MEDIA_ACTIVITY | TELEMETRYITEM_TIMESTAMP_DOUBLE))
+		const UI64 quarter = (mask >> 2) + 1;
+		if ((prev > mask - quarter) && (cur < quarter))
 		{
-			ostr << "," << (rec.activity_media - prev.activity_media) * 100. / tDelta;
+			wrapMask |= item;
+			return (cur - prev) & mask;
 		}
+		resetMask |= item;
+		return cur;
 	}
-	else
+
+	double counterDelta(double cur, double prev, UI32 item, UI32& resetMask)
 	{
-		if (haveBW)
+		if (cur >= prev)
 		{
-			ostr << ",,,";
+			return cur - prev;
 		}
+		resetMask |= item;
+		return cur;
+	}
+}
+
+void TelemetryTracker::setDerivedMetricsParams(const DerivedMetricsParams& params)
+{
+	XPUINFO_REQUIRE_MSG((params.smoothingAlpha > 0.) && (params.smoothingAlpha <= 1.), "smoothingAlpha must be in (0, 1]");
+	XPUINFO_REQUIRE_MSG((params.bwCounterBits >= 8) && (params.bwCounterBits <= 64), "bwCounterBits must be in [8, 64]");
+	std::lock_guard<std::mutex> lock(m_RecordMutex);
+	XPUINFO_REQUIRE_MSG(m_records.empty(), "setDerivedMetricsParams must be called before start()");
+	m_DerivedParams = params;
+}
+
+void TelemetryTracker::computeDerivedMetrics(TimedRecord& rec, const TimedRecord* pPrev, double smoothingAlpha) const
+{
+	const double nan = std::numeric_limits<double>::quiet_NaN();
+	rec.readBWBytesPerSec = rec.writeBWBytesPerSec = nan;
+	rec.activityGlobalPct = rec.activityComputePct = rec.activityMediaPct = nan;
+	rec.devicePowerW = nan;
+	rec.counterWrapMask = rec.counterResetMask = 0;
+
+	// Activity is cumulative with IGCL timestamps, else already a percentage
+	const bool bDoubleTS = !!(m_ResultMask & TELEMETRYITEM_TIMESTAMP_DOUBLE);
+	if (!bDoubleTS)
+	{
+		if (m_ResultMask & TELEMETRYITEM_GLOBAL_ACTIVITY)
+			rec.activityGlobalPct = rec.activity_global;
+		if (m_ResultMask & TELEMETRYITEM_RENDER_COMPUTE_ACTIVITY)
+			rec.activityComputePct = rec.activity_compute;
+		if (m_ResultMask & TELEMETRYITEM_MEDIA_ACTIVITY)
+			rec.activityMediaPct = rec.activity_media;
 	}
-	if (m_ResultMask & TELEMETRYITEM_GLOBAL_ACTIVITY)
+	if (!pPrev || (!bDoubleTS && !m_timestamp_freq))
 	{
-		if (!(m_ResultMask & TELEMETRYITEM_TIMESTAMP_DOUBLE))
-		{
-			ostr << "," << rec.activity_global;
-		}
-		else if ((it - m_records.begin()) == 0)
+		return;
+	}
+
+	const auto& prev = *pPrev;
+	const UI64 t = getHostTimeNs(rec);
+	const UI64 tPrev = getHostTimeNs(prev);
+	if (t > tPrev)
+	{
+		const double tDelta = double(t - tPrev) * 1e-9;
+		const UI32 bits = m_DerivedParams.bwCounterBits;
+		if (m_ResultMask & TELEMETRYITEM_READ_BW)
+			rec.readBWBytesPerSec = counterDelta(rec.bw_read, prev.bw_read, bits, TELEMETRYITEM_READ_BW, rec.counterWrapMask, rec.counterResetMask) / tDelta;
+		if (m_ResultMask & TELEMETRYITEM_WRITE_BW)
+			rec.writeBWBytesPerSec = counterDelta(rec.bw_write, prev.bw_write, bits, TELEMETRYITEM_WRITE_BW, rec.counterWrapMask, rec.counterResetMask) / tDelta;
+		if (bDoubleTS && (m_ResultMask & TELEMETRYITEM_GLOBAL_ACTIVITY))
+			rec.activityGlobalPct = counterDelta(rec.activity_global, prev.activity_global, TELEMETRYITEM_GLOBAL_ACTIVITY, rec.counterResetMask) * 100. / tDelta;
+		if (bDoubleTS && (m_ResultMask & TELEMETRYITEM_RENDER_COMPUTE_ACTIVITY))
+			rec.activityComputePct = counterDelta(rec.activity_compute, prev.activity_compute, TELEMETRYITEM_RENDER_COMPUTE_ACTIVITY, rec.counterResetMask) * 100. / tDelta;
+		if (bDoubleTS && (m_ResultMask & TELEMETRYITEM_MEDIA_ACTIVITY))
+			rec.activityMediaPct = counterDelta(rec.activity_media, prev.activity_media, TELEMETRYITEM_MEDIA_ACTIVITY, rec.counterResetMask) * 100. / tDelta;
+		if (m_ResultMask & TELEMETRYITEM_DEVICE_ENERGY)
+			rec.devicePowerW = counterDelta(rec.deviceEnergyJ, prev.deviceEnergyJ, TELEMETRYITEM_DEVICE_ENERGY, rec.counterResetMask) / tDelta;
+	}
+
+	if (smoothingAlpha < 1.)
+	{
+		const auto smooth = [smoothingAlpha](double& value, double prevValue)
 		{
-			ostr << ",";
-		}
+			if (std::isfinite(value) && std::isfinite(prevValue))
+			{
+				value = smoothingAlpha * value + (1. - smoothingAlpha) * prevValue;
+			}
+		};
+		smooth(rec.readBWBytesPerSec, prev.readBWBytesPerSec);
+		smooth(rec.writeBWBytesPerSec, prev.writeBWBytesPerSec);
+		smooth(rec.activityGlobalPct, prev.activityGlobalPct);
+		smooth(rec.activityComputePct, prev.activityComputePct);
+		smooth(rec.activityMediaPct, prev.activityMediaPct);
+		smooth(rec.devicePowerW, prev.devicePowerW);
+	}
+}
+
+void TelemetryTracker::buildCounterDescs()
+{
+	m_counterDescs.clear();
+	const auto add = [this](const String& name, UI32 mask, bool bFiniteOnly, std::function<double(const TimedRecord&)> get)
+	{
+		m_counterDescs.push_back({ name, mask, bFiniteOnly, std::move(get) });
+	};
+#if defined(_WIN32) && !defined(_M_ARM64)
+	add("%CPU", 0, false, [](const TimedRecord& rec) { return rec.pctCPU; });
+	add("CPU Freq (MHz)", 0, false, [](const TimedRecord& rec) { return rec.cpu_freq / 100.0; });
+#endif
+	add("Freq(MHz)", TELEMETRYITEM_FREQUENCY, false, [](const TimedRecord& rec) { return rec.freq; });
+	// Derived values are NaN when not available
+	const UI32 bwMask = TELEMETRYITEM_READ_BW | TELEMETRYITEM_WRITE_BW;
+	add("Rd BW(MB/s)", bwMask, true, [](const TimedRecord& rec) { return rec.readBWBytesPerSec / (1024 * 1024); });
+	add("Wr BW(MB/s)", bwMask, true, [](const TimedRecord& rec) { return rec.writeBWBytesPerSec / (1024 * 1024); });
+	add("BW(MB/s)", bwMask, true, [](const TimedRecord& rec) { return (rec.readBWBytesPerSec + rec.writeBWBytesPerSec) / (1024 * 1024); });
+	add("% Global", TELEMETRYITEM_GLOBAL_ACTIVITY, true, [](const TimedRecord& rec) { return rec.activityGlobalPct; });
+	add("% Compute", TELEMETRYITEM_RENDER_COMPUTE_ACTIVITY, true, [](const TimedRecord& rec) { return rec.activityComputePct; });
+	add("% Media", TELEMETRYITEM_MEDIA_ACTIVITY, true, [](const TimedRecord& rec) { return rec.activityMediaPct; });
+	add("Device Memory Used (MB)", TELEMETRYITEM_MEMORY_USAGE, false, [](const TimedRecord& rec) { return rec.deviceMemoryUsedBytes / (1024.0 * 1024); });
+	add("Media Freq (MHz)", TELEMETRYITEM_FREQUENCY_MEDIA, false, [](const TimedRecord& rec) { return rec.freq_media; });
+	add("Memory Freq (GT/s)", TELEMETRYITEM_FREQUENCY_MEMORY, false, [](const TimedRecord& rec) { return rec.freq_memory / 1000.0; });
+	add("Power (W)", TELEMETRYITEM_DEVICE_ENERGY, true, [](const TimedRecord& rec) { return rec.devicePowerW; });
+	for (UI32 i = 0; i < m_numCPUCoreTypes; ++i)
+	{
+		const String label = (m_numCPUCoreTypes > 1) ? ((i == 0) ? "P-Core" : "E-Core") : "CPU";
+		add(label + " Throttle Events", TELEMETRYITEM_CPU_THERMAL, false, [i](const TimedRecord& rec) { return rec.cpuThrottleEvents[i]; });
+		add(label + " Throttle (ms)", TELEMETRYITEM_CPU_THERMAL, false, [i](const TimedRecord& rec) { return rec.cpuThrottleTimeMs[i]; });
 	}
-	if (m_ResultMask & TELEMETRYITEM_RENDER_COMPUTE_ACTIVITY)
+	add("Package Throttle Events", TELEMETRYITEM_CPU_THERMAL, false, [](const TimedRecord& rec) { return rec.cpuPackageThrottleEvents; });
+	add("Package Throttle (ms)", TELEMETRYITEM_CPU_THERMAL, false, [](const TimedRecord& rec) { return rec.cpuPackageThrottleTimeMs; });
+	add("CPU Temp (C)", TELEMETRYITEM_CPU_THERMAL, false, [](const TimedRecord& rec) { return rec.cpuTempC; });
+	add("CPU Thermal Headroom (C)", TELEMETRYITEM_CPU_THERMAL, false, [](const TimedRecord& rec) { return rec.cpuThermalHeadroomC; });
+	for (UI32 i = 0; i < m_numCPUCoreTypes; ++i)
 	{
-		if (!(m_ResultMask & TELEMETRYITEM_TIMESTAMP_DOUBLE))
+		const String label = (m_numCPUCoreTypes > 1) ? ((i == 0) ? "P-Core" : "E-Core") : "CPU";
+		add("% " + label + " Idle", TELEMETRYITEM_CPU_IDLE, false, [i](const TimedRecord& rec) { return rec.cpuIdlePct[i]; });
+		add("% " + label + " Deepest C-State", TELEMETRYITEM_CPU_IDLE, false, [i](const TimedRecord& rec) { return rec.cpuDeepestIdlePct[i]; });
+	}
+	add("% Busiest CPU", TELEMETRYITEM_CPU_IDLE, false, [](const TimedRecord& rec) { return rec.cpuBusiestPct; });
+	if (m_pResCtrlMon)
+	{
+		const auto& groups = m_pResCtrlMon->getGroups();
+		for (UI32 i = 0; i < groups.size(); ++i)
 		{
-			ostr << "," << rec.activity_compute;
+			const String label = groups[i].empty() ? String("Default") : groups[i];
+			add(label + " LLC (MB)", TELEMETRYITEM_RESCTRL_MON, false, [i](const TimedRecord& rec) { return rec.llcOccupancyBytes[i] / (1024.0 * 1024); });
+			add(label + " Mem BW(MB/s)", TELEMETRYITEM_RESCTRL_MON, true, [i](const TimedRecord& rec) { return rec.hostMemBWTotal[i] / (1024.0 * 1024); });
+			add(label + " Local Mem BW(MB/s)", TELEMETRYITEM_RESCTRL_MON, true, [i](const TimedRecord& rec) { return rec.hostMemBWLocal[i] / (1024.0 * 1024); });
 		}
-		else if ((it - m_records.begin()) == 0)
+	}
+}
+
+bool TelemetryTracker::getCounter(const CounterDesc& desc, const TimedRecord& rec, double& value) const
+{
+	if ((m_ResultMask & desc.mask) != desc.mask)
+	{
+		return false;
+	}
+	value = desc.get(rec);
+	return !desc.bFiniteOnly || std::isfinite(value);
+}
+
+void TelemetryTracker::getRecordCounters(const TimedRecord& rec, const CounterFunc& func) const
+{
+	for (const auto& desc : m_counterDescs)
+	{
+		double value;
+		if (getCounter(desc, rec, value))
 		{
-			ostr << ",";
+			func(desc.name, value);
 		}
 	}
-	if (m_ResultMask & TELEMETRYITEM_MEDIA_ACTIVITY)
+}
+
+namespace
+{
+	// Same text as ostream's default formatting (%g with precision 6), without locale or stream state
+	void appendNumber(String& buf, double value, int precision = 6)
 	{
-		if ((it - m_records.begin()) == 0)
+		char tmp[64];
+		const auto res = std::to_chars(tmp, tmp + sizeof(tmp), value, std::chars_format::general, precision);
+		buf.append(tmp, res.ptr);
+	}
+
+	void appendNumber(String& buf, UI64 value)
+	{
+		char tmp[32];
+		const auto res = std::to_chars(tmp, tmp + sizeof(tmp), value);
+		buf.append(tmp, res.ptr);
+	}
+}
+
+TelemetryTracker::RecordFormat TelemetryTracker::getRecordFormat() const
+{
+	RecordFormat format;
+	format.resultMask = m_ResultMask;
+	format.startTime = m_startTime;
+	format.startTimeUI64 = m_startTimeUI64;
+	format.numResCtrlGroups = m_pResCtrlMon ? UI32(m_pResCtrlMon->getGroups().size()) : 0;
+	return format;
+}
+
+void TelemetryTracker::appendRecordCSV(const TimedRecord& rec, String& buf) const
+{
+	appendRecordCSV(rec, getRecordFormat(), buf);
+}
+
+void TelemetryTracker::appendRecordCSV(const TimedRecord& rec, const RecordFormat& format, String& buf) const
+{
+	const auto appendValue = [&buf](double value)
+	{
+		buf += ',';
+		appendNumber(buf, value);
+	};
+	// Derived values are NaN when not available, i.e. rates for the first record
+	const auto appendIfFinite = [&buf](double value)
+	{
+		buf += ',';
+		if (std::isfinite(value))
 		{
-			ostr << ",";
+			appendNumber(buf, value);
 		}
+	};
+
+	if (format.resultMask & TELEMETRYITEM_TIMESTAMP_DOUBLE)
+	{
+		appendNumber(buf, rec.timeStamp - format.startTime);
 	}
-	if (m_ResultMask & TELEMETRYITEM_MEMORY_USAGE)
+	else
 	{
-		//ostr << "," << 100.0 * rec.deviceMemoryUsedBytes / (rec.deviceMemoryBudgetBytes);
-		ostr << "," << (rec.deviceMemoryUsedBytes) / (1024.0 * 1024);
+		XPUINFO_REQUIRE(m_timestamp_freq != 0);
+		auto elapsed_Secs = (rec.timeStampUI64 - format.startTimeUI64) / double(m_timestamp_freq);
+		appendNumber(buf, elapsed_Secs);
 	}
 
-	if (m_ResultMask & TELEMETRYITEM_FREQUENCY_MEDIA)
+#if defined(_WIN32) && !defined(_M_ARM64)
+	appendValue(rec.pctCPU);
+	appendValue(rec.cpu_freq / (100.0));
+#endif
+
+	if (format.resultMask & TELEMETRYITEM_FREQUENCY)
+	{
+		appendValue(rec.freq);
+	}
+	bool haveBW = (format.resultMask & (TELEMETRYITEM_READ_BW | TELEMETRYITEM_WRITE_BW)) == (TELEMETRYITEM_READ_BW | TELEMETRYITEM_WRITE_BW);
+	if (haveBW)
+	{
+		appendIfFinite(rec.readBWBytesPerSec / (1024 * 1024));
+		appendIfFinite(rec.writeBWBytesPerSec / (1024 * 1024));
+		appendIfFinite((rec.readBWBytesPerSec + rec.writeBWBytesPerSec) / (1024 * 1024));
+	}
+	if (format.resultMask & TELEMETRYITEM_GLOBAL_ACTIVITY)
+	{
+		appendIfFinite(rec.activityGlobalPct);
+	}
+	if (format.resultMask & TELEMETRYITEM_RENDER_COMPUTE_ACTIVITY)
 	{
-		ostr << "," << (rec.freq_media);
+		appendIfFinite(rec.activityComputePct);
 	}
-	if (m_ResultMask & TELEMETRYITEM_FREQUENCY_MEMORY)
+	if (format.resultMask & TELEMETRYITEM_MEDIA_ACTIVITY)
 	{
-		ostr << "," << std::setprecision(3) << (rec.freq_memory / 1000.0) << std::setprecision(default_precision);
+		appendIfFinite(rec.activityMediaPct);
+	}
+	if (format.resultMask & TELEMETRYITEM_MEMORY_USAGE)
+	{
+		appendValue((rec.deviceMemoryUsedBytes) / (1024.0 * 1024));
 	}
 
-	ostr << std::endl;
+	if (format.resultMask & TELEMETRYITEM_FREQUENCY_MEDIA)
+	{
+		appendValue(rec.freq_media);
+	}
+	if (format.resultMask & TELEMETRYITEM_FREQUENCY_MEMORY)
+	{
+		buf += ',';
+		appendNumber(buf, rec.freq_memory / 1000.0, 3);
+	}
+	if (format.resultMask & TELEMETRYITEM_DEVICE_ENERGY)
+	{
+		appendIfFinite(rec.devicePowerW);
+	}
+	if (format.resultMask & TELEMETRYITEM_CPU_THERMAL)
+	{
+		for (UI32 i = 0; i < m_numCPUCoreTypes; ++i)
+		{
+			buf += ',';
+			appendNumber(buf, UI64(rec.cpuThrottleEvents[i]));
+			buf += ',';
+			appendNumber(buf, UI64(rec.cpuThrottleTimeMs[i]));
+		}
+		buf += ',';
+		appendNumber(buf, UI64(rec.cpuPackageThrottleEvents));
+		buf += ',';
+		appendNumber(buf, UI64(rec.cpuPackageThrottleTimeMs));
+		appendValue(rec.cpuTempC);
+		appendValue(rec.cpuThermalHeadroomC);
+	}
+	if (format.resultMask & TELEMETRYITEM_CPU_IDLE)
+	{
+		for (UI32 i = 0; i < m_numCPUCoreTypes; ++i)
+		{
+			appendValue(rec.cpuIdlePct[i]);
+			appendValue(rec.cpuDeepestIdlePct[i]);
+		}
+		appendValue(rec.cpuBusiestPct);
+	}
+	if (format.resultMask & TELEMETRYITEM_RESCTRL_MON)
+	{
+		for (UI32 i = 0; i < format.numResCtrlGroups; ++i)
+		{
+			appendValue(rec.llcOccupancyBytes[i] / (1024.0 * 1024));
+			// Rates are NaN for the first record
+			appendIfFinite(rec.hostMemBWTotal[i] / (1024.0 * 1024));
+			appendIfFinite(rec.hostMemBWLocal[i] / (1024.0 * 1024));
+		}
+	}
+
+	buf += '\n';
+}
+
+void TelemetryTracker::printRecord(const TimedRecord& rec, std::ostream& ostr) const
+{
+	String line;
+	appendRecordCSV(rec, line);
+	ostr << line;
 }
 
 String TelemetryTracker::getLog() const
 {
 	std::ostringstream ostr;
-	ostr << "Stats for " << convert(m_Device->name()) << " (" << m_msPeriod << "ms interval):" << std::endl;
+	ostr << "Stats for " << (m_Device ? convert(m_Device->name()) : String("Host")) << " (" << m_msPeriod << "ms interval):" << std::endl;
 	printRecordHeader(ostr);
 	if (m_records.size())
 	{
-		for (TimedRecords::const_iterator it = m_records.begin(); it != m_records.end(); ++it)
+		std::lock_guard<std::mutex> lock(m_RecordMutex);
+		forEachRecord([this, &ostr](const TimedRecord& rec, const TimedRecord*)
+			{
+				printRecord(rec, ostr);
+			});
+		printChangeEvents(ostr);
+		if (m_pClockCorrelator && m_pClockCorrelator->isValid())
 		{
-			printRecord(it, ostr);
+			const auto& corr = m_pClockCorrelator->getCorrelation();
+			ostr << "Device clock: drift " << corr.driftPPM << " ppm, residual " << corr.residualNs * 1e-3
+				<< " us, read within " << corr.minBracketNs * 1e-3 << " us (" << corr.numPairs << " pairs)" << std::endl;
 		}
 	}
 	else
@@ -202,7 +699,7 @@ TelemetryTracker::TelemetryTracker(const DevicePtr& deviceToTrack, UI32 msPeriod
 #if defined(_WIN32) && !defined(_M_ARM64)
 	InitPDH();
 
-	if (m_Device->getCurrentAPIs() & (API_TYPE_IGCL|API_TYPE_LEVELZERO|API_TYPE_DXCORE))
+	if (!m_Device || (getDeviceAPIs() & (API_TYPE_IGCL|API_TYPE_LEVELZERO|API_TYPE_DXCORE)))
 	{
 		m_records.reserve(1024);
 
@@ -222,27 +719,42 @@ TelemetryTracker::TelemetryTracker(const DevicePtr& deviceToTrack, UI32 msPeriod
 		}
 	}
 
-	if ((m_Device->getCurrentAPIs() & API_TYPE_IGCL) == 0)
+	if ((getDeviceAPIs() & API_TYPE_IGCL) == 0)
 	{
 		BOOL bRet = QueryPerformanceFrequency((LARGE_INTEGER*)&m_timestamp_freq);
 		XPUINFO_REQUIRE(bRet);
 	}
 
 #ifdef XPUINFO_USE_IGCL
-    if ((m_Device->getCurrentAPIs() & (API_TYPE_IGCL|API_TYPE_IGCL_L0)) == (API_TYPE_IGCL|API_TYPE_IGCL_L0))
+    if ((getDeviceAPIs() & (API_TYPE_IGCL|API_TYPE_IGCL_L0)) == (API_TYPE_IGCL|API_TYPE_IGCL_L0))
 	{
 		InitIGCL();
 	}
 #endif
 
+#elif !defined(_WIN32)
+	m_records.reserve(1024);
+	m_timestamp_freq = 1000000000ULL; // steady_clock nanoseconds, see RecordCPUTimestamp
 #endif // Win32
 
 #ifdef XPUINFO_USE_LEVELZERO
-	if (m_Device->getCurrentAPIs() & API_TYPE_LEVELZERO)
+	if (getDeviceAPIs() & API_TYPE_LEVELZERO)
 	{
 		InitL0();
 	}
 #endif
+
+#ifdef __linux__
+	InitCPUThermal();
+	InitCPUIdle();
+#endif
+
+	buildCounterDescs();
+
+	if (m_pRealtime_ostr)
+	{
+		m_pRealtimeWriter.reset(new TelemetryRealtimeWriter(*this, *m_pRealtime_ostr, RealtimeOutputParams()));
+	}
 }
 
 TelemetryTracker::~TelemetryTracker() noexcept(false)
@@ -271,9 +783,8 @@ TelemetryTracker::~TelemetryTracker() noexcept(false)
 		CloseThreadpoolCleanupGroup(m_cleanupgroup);
 	}
 #endif
-    if (m_pRealtime_ostr) {
-        (*m_pRealtime_ostr) << std::flush;
-    }
+	// Writes and flushes queued records
+	m_pRealtimeWriter.reset();
 }
 
 void TelemetryTracker::start()
@@ -289,6 +800,15 @@ void TelemetryTracker::start()
 			m_msPeriod,
 			0);
 	}
+#elif !defined(_WIN32)
+	if (m_msPeriod && !m_samplerThread.joinable())
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_samplerMutex);
+			m_bSamplerStop = false;
+		}
+		m_samplerThread = std::thread([this]() { SamplerThreadFunc(); });
+	}
 #endif
 }
 
@@ -302,30 +822,212 @@ void TelemetryTracker::stop()
 			0,
 			0);
 	}
+#elif !defined(_WIN32)
+	if (m_samplerThread.joinable())
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_samplerMutex);
+			m_bSamplerStop = true;
+		}
+		m_samplerCV.notify_all();
+		m_samplerThread.join();
+	}
 #endif
 }
 
-bool TelemetryTracker::RecordCPUTimestamp(TimedRecord& rec)
+#ifndef _WIN32
+void TelemetryTracker::SamplerThreadFunc()
+{
+	auto nextTick = std::chrono::steady_clock::now();
+	std::unique_lock<std::mutex> lock(m_samplerMutex);
+	while (!m_bSamplerStop)
+	{
+		lock.unlock();
+		RecordNow();
+		lock.lock();
+		// Fixed-rate schedule like the threadpool timer, skipping ticks missed while recording
+		const auto period = std::chrono::milliseconds(m_msPeriod);
+		nextTick += period;
+		auto now = std::chrono::steady_clock::now();
+		if (nextTick < now)
+		{
+			nextTick = now + period;
+		}
+		m_samplerCV.wait_until(lock, nextTick, [this]() { return m_bSamplerStop; });
+	}
+}
+#endif
+
+bool TelemetryTracker::readCPUTimestamp(UI64& ticks)
 {
-    // See std::chrono
 #if defined(_WIN32) && !defined(_M_ARM64)
-	BOOL bRet = QueryPerformanceCounter((LARGE_INTEGER*)&rec.timeStampUI64);
+	BOOL bRet = QueryPerformanceCounter((LARGE_INTEGER*)&ticks);
 	XPUINFO_REQUIRE(bRet);
+#elif !defined(_WIN32)
+	ticks = (UI64)std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+	bool bRet = true;
 #else
-    bool bRet = false;
+	(void)ticks;
+	bool bRet = false;
 #endif
+	return !!bRet;
+}
+
+bool TelemetryTracker::RecordCPUTimestamp(TimedRecord& rec)
+{
+	bool bRet = readCPUTimestamp(rec.timeStampUI64);
 
 	if (m_records.size() == 0)
 	{
 		m_startTimeUI64 = rec.timeStampUI64;
 	}
 
-	return !!bRet;
+	return bRet;
+}
+
+TelemetryTracker::SampleResult TelemetryTracker::sampleNow(UI32 mask)
+{
+	const auto tStart = std::chrono::steady_clock::now();
+	SampleResult result;
+	TimedRecord& rec = result.record;
+	result.hostTimeNs = getCurrentHostTimeNs();
+
+	if ((mask & TELEMETRYITEM_MEMORY_USAGE) && m_Device)
+	{
+		auto memUsage = m_Device->tryGetMemUsage();
+		if (memUsage && memUsage->currentUsage)
+		{
+			rec.deviceMemoryUsedBytes = memUsage->currentUsage;
+			rec.deviceMemoryBudgetBytes = memUsage->budget;
+			result.items |= TELEMETRYITEM_MEMORY_USAGE;
+		}
+	}
+
+	std::unique_lock<std::mutex> lock(m_RecordMutex, std::defer_lock);
+	bool bIGCLTimestamp = false;
+	const UI32 kDeviceItems = TELEMETRYITEM_FREQUENCY | TELEMETRYITEM_READ_BW | TELEMETRYITEM_WRITE_BW |
+		TELEMETRYITEM_GLOBAL_ACTIVITY | TELEMETRYITEM_RENDER_COMPUTE_ACTIVITY | TELEMETRYITEM_MEDIA_ACTIVITY |
+		TELEMETRYITEM_FREQUENCY_MEDIA | TELEMETRYITEM_FREQUENCY_MEMORY | TELEMETRYITEM_DEVICE_ENERGY;
+	if ((mask & kDeviceItems) && (getDeviceAPIs() & (API_TYPE_IGCL | API_TYPE_LEVELZERO | API_TYPE_NVML)))
+	{
+		lock.lock();
+		// Record* add to the result mask (and set the start time) for the first record; keep the tracker's
+		const TelemetryItem savedMask = m_ResultMask;
+		const double savedStartTime = m_startTime;
+		bool bSampled = false;
+#ifdef XPUINFO_USE_IGCL
+		if (getDeviceAPIs() & API_TYPE_IGCL)
+		{
+			bIGCLTimestamp = RecordIGCL(rec);
+			bSampled = bIGCLTimestamp;
+		}
+#endif
+#ifdef XPUINFO_USE_LEVELZERO
+		if (getDeviceAPIs() & API_TYPE_LEVELZERO)
+		{
+			bSampled = RecordL0(rec) || bSampled;
+		}
+#endif
+#ifdef XPUINFO_USE_NVML
+		if (getDeviceAPIs() & API_TYPE_NVML)
+		{
+			bSampled = RecordNVML(rec) || bSampled;
+		}
+#endif
+		if (bSampled)
+		{
+			result.items |= mask & kDeviceItems & (m_ResultMask | savedMask);
+		}
+		// Record* only change these before the first record.  Restore only then, so a sample of a running
+		// tracker never writes fields that other threads read.
+		if (m_ResultMask != savedMask)
+		{
+			m_ResultMask = savedMask;
+		}
+		if (m_startTime != savedStartTime)
+		{
+			m_startTime = savedStartTime;
+		}
+	}
+
+	const UI32 kPeriodItems = TELEMETRYITEM_CPU_THERMAL | TELEMETRYITEM_CPU_IDLE | TELEMETRYITEM_RESCTRL_MON;
+	if (mask & kPeriodItems)
+	{
+		if (!lock.owns_lock())
+		{
+			lock.lock();
+		}
+		if (m_records.size())
+		{
+			const TimedRecord& latest = m_records.back();
+			result.itemsFromLatestRecord = mask & kPeriodItems & m_ResultMask;
+			if (result.itemsFromLatestRecord & TELEMETRYITEM_CPU_THERMAL)
+			{
+				std::copy(std::begin(latest.cpuThrottleEvents), std::end(latest.cpuThrottleEvents), std::begin(rec.cpuThrottleEvents));
+				std::copy(std::begin(latest.cpuThrottleTimeMs), std::end(latest.cpuThrottleTimeMs), std::begin(rec.cpuThrottleTimeMs));
+				rec.cpuPackageThrottleEvents = latest.cpuPackageThrottleEvents;
+				rec.cpuPackageThrottleTimeMs = latest.cpuPackageThrottleTimeMs;
+				rec.cpuTempC = latest.cpuTempC;
+				rec.cpuThermalHeadroomC = latest.cpuThermalHeadroomC;
+			}
+			if (result.itemsFromLatestRecord & TELEMETRYITEM_CPU_IDLE)
+			{
+				std::copy(std::begin(latest.cpuIdlePct), std::end(latest.cpuIdlePct), std::begin(rec.cpuIdlePct));
+				std::copy(std::begin(latest.cpuDeepestIdlePct), std::end(latest.cpuDeepestIdlePct), std::begin(rec.cpuDeepestIdlePct));
+				rec.cpuBusiestPct = latest.cpuBusiestPct;
+			}
+			if (result.itemsFromLatestRecord & TELEMETRYITEM_RESCTRL_MON)
+			{
+				std::copy(std::begin(latest.llcOccupancyBytes), std::end(latest.llcOccupancyBytes), std::begin(rec.llcOccupancyBytes));
+				std::copy(std::begin(latest.hostMemBWTotal), std::end(latest.hostMemBWTotal), std::begin(rec.hostMemBWTotal));
+				std::copy(std::begin(latest.hostMemBWLocal), std::end(latest.hostMemBWLocal), std::begin(rec.hostMemBWLocal));
+			}
+		}
+	}
+
+	// L0 sets a double timestamp; as in RecordNow, use the CPU's unless IGCL provided one
+	if (!bIGCLTimestamp)
+	{
+		readCPUTimestamp(rec.timeStampUI64);
+	}
+	// Rates against the latest record need timestamps on the same clock, and only cover items read now
+	const bool bComparable = bIGCLTimestamp || !(m_ResultMask & TELEMETRYITEM_TIMESTAMP_DOUBLE);
+	const bool bRates = lock.owns_lock() && m_records.size() && bComparable && (result.items & kDeviceItems);
+	computeDerivedMetrics(rec, bRates ? &m_records.back() : nullptr, 1.);
+	const double nan = std::numeric_limits<double>::quiet_NaN();
+	if (!(result.items & TELEMETRYITEM_READ_BW))
+		rec.readBWBytesPerSec = nan;
+	if (!(result.items & TELEMETRYITEM_WRITE_BW))
+		rec.writeBWBytesPerSec = nan;
+	if (!(result.items & TELEMETRYITEM_GLOBAL_ACTIVITY))
+		rec.activityGlobalPct = nan;
+	if (!(result.items & TELEMETRYITEM_RENDER_COMPUTE_ACTIVITY))
+		rec.activityComputePct = nan;
+	if (!(result.items & TELEMETRYITEM_MEDIA_ACTIVITY))
+		rec.activityMediaPct = nan;
+	if (!(result.items & TELEMETRYITEM_DEVICE_ENERGY))
+		rec.devicePowerW = nan;
+	rec.counterWrapMask &= result.items;
+	rec.counterResetMask &= result.items;
+	result.usedRecordMutex = lock.owns_lock();
+	if (lock.owns_lock())
+	{
+		lock.unlock();
+	}
+
+	result.latencyUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - tStart).count();
+	return result;
 }
 
 bool TelemetryTracker::RecordMemoryUsage(TimedRecord& rec)
 {
-	auto memusage = m_Device->getMemUsage();
+	auto result = m_Device->tryGetMemUsage();
+	if (!result)
+	{
+		return false;
+	}
+	const DXCoreAdapterMemoryBudget& memusage = result.value();
 	if (memusage.currentUsage)
 	{
 		rec.deviceMemoryUsedBytes = memusage.currentUsage;
@@ -343,7 +1045,8 @@ void TelemetryTracker::RecordNow()
 {
 	TimedRecord rec{};
 	bool bUpdate = false;
-	std::lock_guard<std::mutex> lock(m_RecordMutex); // for now, only support one at a time
+	std::unique_lock<std::mutex> lock(m_RecordMutex); // for now, only support one at a time
+	std::vector<ChangeEvent> changeEvents;
 
 	// Frequency, throttleReason (L0, IGCL)
 	// Memory (VRAM) read/write/timestamp (IGCL)
@@ -355,13 +1058,13 @@ void TelemetryTracker::RecordNow()
 	// * VRAM Read BW
 	// * VRAM Write BW
 
-	if (m_Device->getCurrentAPIs() & API_TYPE_DXCORE)
+	if (getDeviceAPIs() & API_TYPE_DXCORE)
 	{
 		bUpdate = RecordMemoryUsage(rec) || bUpdate;
 	}
 
 #ifdef XPUINFO_USE_IGCL
-	if (m_Device->getCurrentAPIs() & API_TYPE_IGCL)
+	if (getDeviceAPIs() & API_TYPE_IGCL)
 	{
 		bUpdate = RecordIGCL(rec) || bUpdate;
 	}
@@ -371,8 +1074,23 @@ void TelemetryTracker::RecordNow()
 	bUpdate = RecordCPU_PDH(rec) || bUpdate;
 #endif
 
+	if (m_pCPUThermal)
+	{
+		bUpdate = RecordCPUThermal(rec) || bUpdate;
+	}
+
+	if (m_pCPUIdle)
+	{
+		bUpdate = RecordCPUIdle(rec) || bUpdate;
+	}
+
+	if (m_pResCtrlMon)
+	{
+		bUpdate = RecordResCtrl(rec) || bUpdate;
+	}
+
 #ifdef XPUINFO_USE_LEVELZERO
-	if (m_Device->getCurrentAPIs() & API_TYPE_LEVELZERO)
+	if (getDeviceAPIs() & API_TYPE_LEVELZERO)
 	{
 		bool bL0 = RecordL0(rec);
 		bUpdate = bL0 || bUpdate;
@@ -380,7 +1098,7 @@ void TelemetryTracker::RecordNow()
 #endif
 
 #ifdef XPUINFO_USE_NVML
-	if (m_Device->getCurrentAPIs() & API_TYPE_NVML)
+	if (getDeviceAPIs() & API_TYPE_NVML)
 	{
 		bUpdate = RecordNVML(rec) || bUpdate;
 	}
@@ -388,21 +1106,166 @@ void TelemetryTracker::RecordNow()
 
 	if (bUpdate)
 	{
-		if (!(m_Device->getCurrentAPIs() & API_TYPE_IGCL)) // Need CPU timestamp
+		if (!(getDeviceAPIs() & API_TYPE_IGCL)) // Need CPU timestamp
 		{
 			RecordCPUTimestamp(rec);
 		}
 
+		if (m_records.empty())
+		{
+			m_startHostTimeNs = getCurrentHostTimeNs();
+		}
+		computeDerivedMetrics(rec, m_records.size() ? &m_records.back() : nullptr, m_DerivedParams.smoothingAlpha);
 		m_records.push_back(rec);
-		if (m_pRealtime_ostr)
+		if (m_pRealtimeWriter)
+		{
+			m_pRealtimeWriter->push(rec, getRecordFormat());
+		}
+		if (m_pTraceWriter)
 		{
-			if (m_records.size() == 1)
+			m_pTraceWriter->writeRecord(*this, rec);
+		}
+		if (m_pRollup)
+		{
+			m_pRollup->add(*this, rec);
+		}
+		if (m_changeDetectors.size())
+		{
+			detectChanges(rec, changeEvents);
+		}
+		if (m_pHistory)
+		{
+			m_pHistory->append(rec);
+			m_records.erase(m_records.begin(), m_records.end() - 1);
+		}
+		else if (m_rawRetentionNs)
+		{
+			// Erase expired records once they are half of the vector, so the cost is amortized
+			const UI64 timeNs = getHostTimeNs(rec);
+			if (timeNs > m_rawRetentionNs)
 			{
-				printRecordHeader(*m_pRealtime_ostr);
+				const UI64 cutoffNs = timeNs - m_rawRetentionNs;
+				auto itKeep = std::partition_point(m_records.begin(), m_records.end(),
+					[this, cutoffNs](const TimedRecord& r) { return getHostTimeNs(r) < cutoffNs; });
+				if (size_t(itKeep - m_records.begin()) * 2 >= m_records.size())
+				{
+					m_records.erase(m_records.begin(), itKeep);
+				}
 			}
-			printRecord(m_records.end()-1, *m_pRealtime_ostr);
 		}
 	}
+
+	if (changeEvents.size())
+	{
+		// Callback may use the tracker, so not with m_RecordMutex held
+		const ChangeEventFunc func = m_changeEventFunc;
+		lock.unlock();
+		for (const auto& event : changeEvents)
+		{
+			func(event);
+		}
+	}
+}
+
+void TelemetryTracker::InitCPUThermal()
+{
+	m_pCPUThermal.reset(new CPUThermalMonitor);
+	if (!m_pCPUThermal->isSupported())
+	{
+		m_pCPUThermal.reset();
+		return;
+	}
+	// First sample establishes counter baselines
+	const auto& s = m_pCPUThermal->sample();
+	for (const auto& ct : s.coreTypes)
+	{
+		m_numCPUCoreTypes = std::max(m_numCPUCoreTypes, getCPUCoreTypeIndex(ct.first) + 1);
+	}
+	m_numCPUCoreTypes = std::min(m_numCPUCoreTypes, kMaxCPUCoreTypes);
+	m_ResultMask = (TelemetryItem)(m_ResultMask | TELEMETRYITEM_CPU_THERMAL);
+}
+
+bool TelemetryTracker::RecordCPUThermal(TimedRecord& rec)
+{
+	const auto& s = m_pCPUThermal->sample();
+	for (const auto& [coreType, ct] : s.coreTypes)
+	{
+		UI32 idx = getCPUCoreTypeIndex(coreType);
+		if (idx < kMaxCPUCoreTypes)
+		{
+			rec.cpuThrottleEvents[idx] += UI32(ct.coreThrottleEvents);
+			rec.cpuThrottleTimeMs[idx] += UI32(ct.coreThrottleTimeMs);
+		}
+	}
+	rec.cpuPackageThrottleEvents = UI32(s.packageThrottleEvents);
+	rec.cpuPackageThrottleTimeMs = UI32(s.packageThrottleTimeMs);
+	rec.cpuTempC = s.maxTempC;
+	rec.cpuThermalHeadroomC = s.thermalHeadroomC;
+	return true;
+}
+
+void TelemetryTracker::InitCPUIdle()
+{
+	m_pCPUIdle.reset(new CPUIdleMonitor);
+	if (!m_pCPUIdle->isSupported())
+	{
+		m_pCPUIdle.reset();
+		return;
+	}
+	// First sample establishes counter baselines
+	const auto& s = m_pCPUIdle->sample();
+	for (const auto& ct : s.coreTypes)
+	{
+		m_numCPUCoreTypes = std::max(m_numCPUCoreTypes, getCPUCoreTypeIndex(ct.first) + 1);
+	}
+	m_numCPUCoreTypes = std::min(m_numCPUCoreTypes, kMaxCPUCoreTypes);
+	m_ResultMask = (TelemetryItem)(m_ResultMask | TELEMETRYITEM_CPU_IDLE);
+}
+
+bool TelemetryTracker::RecordCPUIdle(TimedRecord& rec)
+{
+	const auto& s = m_pCPUIdle->sample();
+	for (const auto& [coreType, ct] : s.coreTypes)
+	{
+		UI32 idx = getCPUCoreTypeIndex(coreType);
+		if (idx < kMaxCPUCoreTypes)
+		{
+			rec.cpuIdlePct[idx] = 100.0 * ct.idleFraction;
+			rec.cpuDeepestIdlePct[idx] = 100.0 * ct.deepestFraction;
+		}
+		rec.cpuBusiestPct = std::max(rec.cpuBusiestPct, 100.0 * (1.0 - ct.minIdleFraction));
+	}
+	return true;
+}
+
+bool TelemetryTracker::setResCtrlMonitorGroups(const std::vector<String>& groups, const String& resctrlRoot)
+{
+	XPUINFO_REQUIRE_MSG(groups.size() <= kMaxResCtrlGroups, "Too many resctrl monitoring groups");
+	std::lock_guard<std::mutex> lock(m_RecordMutex);
+	XPUINFO_REQUIRE_MSG(m_records.empty(), "setResCtrlMonitorGroups must be called before start()");
+	m_pResCtrlMon.reset(new ResCtrlMonitor(groups, resctrlRoot.empty() ? String(ResCtrl::kDefaultRoot) : resctrlRoot));
+	if (!m_pResCtrlMon->isSupported())
+	{
+		m_pResCtrlMon.reset();
+		m_ResultMask = (TelemetryItem)(m_ResultMask & ~TELEMETRYITEM_RESCTRL_MON);
+		buildCounterDescs();
+		return false;
+	}
+	m_ResultMask = (TelemetryItem)(m_ResultMask | TELEMETRYITEM_RESCTRL_MON);
+	buildCounterDescs();
+	return true;
+}
+
+bool TelemetryTracker::RecordResCtrl(TimedRecord& rec)
+{
+	const auto& s = m_pResCtrlMon->sample();
+	for (size_t i = 0; i < s.groups.size(); ++i)
+	{
+		rec.llcOccupancyBytes[i] = s.groups[i].llcOccupancyBytes;
+		rec.hostMemBWTotal[i] = s.groups[i].mbmTotalBytesPerSec;
+		rec.hostMemBWLocal[i] = s.groups[i].mbmLocalBytesPerSec;
+	}
+	return true;
 }
 
 #if defined(_WIN32) && !defined(_M_ARM64)
@@ -0,0 +1,274 @@
+// Copyright (C) 2024 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+#ifdef XPUINFO_USE_TELEMETRYTRACKER
+#include "LibXPUInfo_TraceExport.h"
+#include "LibXPUInfo_Util.h"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+namespace XI
+{
+namespace
+{
+    // Minimal protobuf encoding of the Perfetto trace fields used here (see perfetto/protos/perfetto/trace)
+    namespace PB
+    {
+        enum WireType : UI32 { VARINT = 0, FIXED64 = 1, LEN = 2 };
+
+        // TracePacket
+        const UI32 kTrace_Packet = 1;
+        const UI32 kPacket_Timestamp = 8;
+        const UI32 kPacket_TrustedPacketSequenceId = 10;
+        const UI32 kPacket_TrackEvent = 11;
+        const UI32 kPacket_SequenceFlags = 13;
+        const UI32 kPacket_TimestampClockId = 58;
+        const UI32 kPacket_TrackDescriptor = 60;
+        const UI32 kSeqIncrementalStateCleared = 1;
+        // TrackDescriptor
+        const UI32 kTrack_UUID = 1;
+        const UI32 kTrack_Name = 2;
+        const UI32 kTrack_Process = 3;
+        const UI32 kTrack_ParentUUID = 5;
+        const UI32 kTrack_Counter = 8;
+        // ProcessDescriptor
+        const UI32 kProcess_Pid = 1;
+        const UI32 kProcess_Name = 6;
+        // TrackEvent
+        const UI32 kEvent_Type = 9;
+        const UI32 kEvent_TrackUUID = 11;
+        const UI32 kEvent_DoubleCounterValue = 44;
+        const UI32 kEventTypeCounter = 4;
+
+        void appendVarint(String& out, UI64 value)
+        {
+            while (value >= 0x80)
+            {
+                out.push_back(char((value & 0x7f) | 0x80));
+                value >>= 7;
+            }
+            out.push_back(char(value));
+        }
+        void appendTag(String& out, UI32 field, WireType wireType)
+        {
+            appendVarint(out, (UI64(field) << 3) | wireType);
+        }
+        void appendVarintField(String& out, UI32 field, UI64 value)
+        {
+            appendTag(out, field, VARINT);
+            appendVarint(out, value);
+        }
+        void appendBytesField(String& out, UI32 field, const String& bytes)
+        {
+            appendTag(out, field, LEN);
+            appendVarint(out, bytes.size());
+            out += bytes;
+        }
+        void appendDoubleField(String& out, UI32 field, double value)
+        {
+            appendTag(out, field, FIXED64);
+            char bytes[sizeof(double)];
+            std::memcpy(bytes, &value, sizeof(double)); // Little-endian on all supported platforms
+            out.append(bytes, sizeof(bytes));
+        }
+    }
+
+    // FNV-1a, for track UUIDs that are stable across runs
+    UI64 hashName(UI64 seed, const String& name)
+    {
+        UI64 h = 0xcbf29ce484222325ULL ^ seed;
+        for (char c : name)
+        {
+            h = (h ^ U8(c)) * 0x100000001b3ULL;
+        }
+        return h ? h : 1;
+    }
+
+    void writeJSONString(std::ostream& ostr, const String& str)
+    {
+        ostr << '"';
+        for (char c : str)
+        {
+            if ((c == '"') || (c == '\\'))
+                ostr << '\\' << c;
+            else if (U8(c) >= 0x20)
+                ostr << c;
+        }
+        ostr << '"';
+    }
+}
+
+UI64 TelemetryTraceWriter::getCurrentProcessID()
+{
+#ifdef _WIN32
+    return GetCurrentProcessId();
+#else
+    return UI64(getpid());
+#endif
+}
+
+TelemetryTraceWriter::TelemetryTraceWriter(std::ostream& ostr, const Params& params) :
+    m_ostr(ostr), m_Params(params),
+    m_pid((params.pid < 0) ? getCurrentProcessID() : UI64(params.pid)),
+    m_processTrackUUID(hashName(m_pid, "process"))
+{
+    if (m_Params.format == FORMAT_CHROME_JSON)
+    {
+        m_ostr << "[\n";
+        if (m_Params.processName.size())
+        {
+            m_ostr << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << m_pid << ",\"args\":{\"name\":";
+            writeJSONString(m_ostr, m_Params.processName);
+            m_ostr << "}}";
+            m_bFirst = false;
+        }
+    }
+    else
+    {
+        // Process track that counters are parented to; merged with the application's by pid
+        String process, track;
+        PB::appendVarintField(process, PB::kProcess_Pid, m_pid);
+        if (m_Params.processName.size())
+        {
+            PB::appendBytesField(process, PB::kProcess_Name, m_Params.processName);
+        }
+        PB::appendVarintField(track, PB::kTrack_UUID, m_processTrackUUID);
+        PB::appendBytesField(track, PB::kTrack_Process, process);
+
+        m_packet.clear();
+        PB::appendVarintField(m_packet, PB::kPacket_TrustedPacketSequenceId, m_Params.perfettoSequenceId);
+        PB::appendVarintField(m_packet, PB::kPacket_SequenceFlags, PB::kSeqIncrementalStateCleared);
+        PB::appendBytesField(m_packet, PB::kPacket_TrackDescriptor, track);
+        writePacket(m_packet);
+    }
+}
+
+TelemetryTraceWriter::TelemetryTraceWriter(std::ostream& ostr) : TelemetryTraceWriter(ostr, Params())
+{
+}
+
+TelemetryTraceWriter::~TelemetryTraceWriter()
+{
+    finish();
+}
+
+void TelemetryTraceWriter::finish()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_bFinished)
+    {
+        return;
+    }
+    m_bFinished = true;
+    if (m_Params.format == FORMAT_CHROME_JSON)
+    {
+        m_ostr << "\n]\n";
+    }
+    m_ostr.flush();
+}
+
+void TelemetryTraceWriter::writePacket(const String& packet)
+{
+    String framed;
+    PB::appendBytesField(framed, PB::kTrace_Packet, packet);
+    m_ostr.write(framed.data(), framed.size());
+}
+
+UI64 TelemetryTraceWriter::getTrackUUID(const String& name)
+{
+    auto it = m_Tracks.find(name);
+    if (it != m_Tracks.end())
+    {
+        return it->second;
+    }
+
+    const UI64 uuid = hashName(m_processTrackUUID, name);
+    m_Tracks.emplace(name, uuid);
+    if (m_Params.format == FORMAT_PERFETTO_PROTO)
+    {
+        String track;
+        PB::appendVarintField(track, PB::kTrack_UUID, uuid);
+        PB::appendBytesField(track, PB::kTrack_Name, name);
+        PB::appendVarintField(track, PB::kTrack_ParentUUID, m_processTrackUUID);
+        PB::appendBytesField(track, PB::kTrack_Counter, String()); // Empty CounterDescriptor
+
+        m_packet.clear();
+        PB::appendVarintField(m_packet, PB::kPacket_TrustedPacketSequenceId, m_Params.perfettoSequenceId);
+        PB::appendBytesField(m_packet, PB::kPacket_TrackDescriptor, track);
+        writePacket(m_packet);
+    }
+    return uuid;
+}
+
+void TelemetryTraceWriter::writeCounterLocked(const String& name, UI64 hostTimeNs, double value)
+{
+    if (m_bFinished || !std::isfinite(value))
+    {
+        return;
+    }
+    const UI64 uuid = getTrackUUID(name);
+    if (m_Params.format == FORMAT_CHROME_JSON)
+    {
+        // ts is in microseconds.  Format numbers here to leave the stream's precision alone.
+        char tsStr[32], valueStr[32];
+        snprintf(tsStr, sizeof(tsStr), "%llu.%03u", (unsigned long long)(hostTimeNs / 1000), UI32(hostTimeNs % 1000));
+        snprintf(valueStr, sizeof(valueStr), "%.10g", value);
+        m_ostr << (m_bFirst ? "" : ",\n") << "{\"name\":";
+        writeJSONString(m_ostr, name);
+        m_ostr << ",\"ph\":\"C\",\"ts\":" << tsStr << ",\"pid\":" << m_pid << ",\"args\":{\"value\":" << valueStr << "}}";
+        m_bFirst = false;
+    }
+    else
+    {
+        String event;
+        PB::appendVarintField(event, PB::kEvent_Type, PB::kEventTypeCounter);
+        PB::appendVarintField(event, PB::kEvent_TrackUUID, uuid);
+        PB::appendDoubleField(event, PB::kEvent_DoubleCounterValue, value);
+
+        m_packet.clear();
+        PB::appendVarintField(m_packet, PB::kPacket_Timestamp, hostTimeNs);
+        if (m_Params.perfettoClockId)
+        {
+            PB::appendVarintField(m_packet, PB::kPacket_TimestampClockId, m_Params.perfettoClockId);
+        }
+        PB::appendVarintField(m_packet, PB::kPacket_TrustedPacketSequenceId, m_Params.perfettoSequenceId);
+        PB::appendBytesField(m_packet, PB::kPacket_TrackEvent, event);
+        writePacket(m_packet);
+    }
+    ++m_numEvents;
+}
+
+void TelemetryTraceWriter::writeCounter(const String& name, UI64 hostTimeNs, double value)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    writeCounterLocked(m_Params.counterPrefix + name, hostTimeNs, value);
+}
+
+void TelemetryTraceWriter::writeRecord(const TelemetryTracker& tracker, const TelemetryTracker::TimedRecord& rec)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const UI64 hostTimeNs = tracker.getHostTimeNs(rec);
+    tracker.getRecordCounters(rec, [this, hostTimeNs](const String& name, double value)
+        {
+            writeCounterLocked(m_Params.counterPrefix + name, hostTimeNs, value);
+        });
+    if (m_Params.flushEachRecord)
+    {
+        m_ostr.flush();
+    }
+}
+
+void TelemetryTraceWriter::writeRecords(const TelemetryTracker& tracker)
+{
+    std::lock_guard<std::mutex> lock(tracker.m_RecordMutex);
+    tracker.forEachRecord([this, &tracker](const TelemetryTracker::TimedRecord& rec, const TelemetryTracker::TimedRecord*)
+        {
+            writeRecord(tracker, rec);
+        });
+}
+} // XI
+#endif // XPUINFO_USE_TELEMETRYTRACKER
@@ -0,0 +1,86 @@
+// Copyright (C) 2024 Intel Corporation
+// SPDX-License-Identifier: Apache-2.0
+
+// Export of TelemetryTracker records as trace counter tracks, to view device telemetry alongside
+// application spans in Perfetto or chrome://tracing.
+//
+// Timestamps are on the host monotonic clock (see TelemetryTracker::getHostTimeNs()).  Counters are
+// placed in the current process by default, so they appear under spans of the same process.
+// Both formats can be streamed: the Chrome JSON array format does not require the closing bracket,
+// and a Perfetto trace is a sequence of independently-framed packets.
+
+#pragma once
+#include "LibXPUInfo.h"
+#include <unordered_map>
+
+#ifdef _WIN32
+#pragma warning(push)
+#pragma warning(disable : 4251)
+#endif
+
+#ifdef XPUINFO_USE_TELEMETRYTRACKER
+namespace XI
+{
+    class XPUINFO_EXPORT TelemetryTraceWriter : public NoCopyAssign
+    {
+    public:
+        enum Format : UI32
+        {
+            FORMAT_CHROME_JSON = 0,     // Trace Event Format, JSON array of "C" (counter) events
+            FORMAT_PERFETTO_PROTO,      // Perfetto TracePacket protobuf with TrackDescriptor/TrackEvent counters
+        };
+        struct Params
+        {
+            Format format = FORMAT_CHROME_JSON;
+            I64 pid = -1;               // -1 for the current process
+            String processName;         // Optional, to name the process track
+            String counterPrefix;       // Prepended to counter names, i.e. to distinguish devices
+            bool flushEachRecord = true;
+#ifdef _WIN32
+            UI32 perfettoClockId = 0;   // QPC has no Perfetto builtin clock; 0 to use the trace default
+#else
+            UI32 perfettoClockId = 3;   // BUILTIN_CLOCK_MONOTONIC
+#endif
+            UI32 perfettoSequenceId = 0x5849; // trusted_packet_sequence_id
+        };
+
+        // ostr must be opened in binary mode for FORMAT_PERFETTO_PROTO
+        TelemetryTraceWriter(std::ostream& ostr, const Params& params);
+        TelemetryTraceWriter(std::ostream& ostr);
+        ~TelemetryTraceWriter();
+
+        // Write all records taken so far by tracker
+        void writeRecords(const TelemetryTracker& tracker);
+        // Single counter value; non-finite values are skipped
+        void writeCounter(const String& name, UI64 hostTimeNs, double value);
+        // Ends the JSON array and flushes.  Called by the destructor.
+        void finish();
+
+        UI64 getNumEvents() const { return m_numEvents; }
+        static UI64 getCurrentProcessID();
+
+    protected:
+        friend class TelemetryTracker;
+        // Called with tracker's record mutex held
+        void writeRecord(const TelemetryTracker& tracker, const TelemetryTracker::TimedRecord& rec);
+        void writeCounterLocked(const String& name, UI64 hostTimeNs, double value);
+        UI64 getTrackUUID(const String& name);
+        void writePacket(const String& packet);
+
+        std::ostream& m_ostr;
+        const Params m_Params;
+        const UI64 m_pid;
+        const UI64 m_processTrackUUID;
+        std::mutex m_mutex;
+        std::unordered_map<String, UI64> m_Tracks;
+        String m_packet; // Reused to encode a packet
+        UI64 m_numEvents = 0;
+        bool m_bFirst = true;
+        bool m_bFinished = false;
+    };
+} // XI
+#endif // XPUINFO_USE_TELEMETRYTRACKER
+
+#ifdef _WIN32
+#pragma warning(pop)
+#endif
@@ -7,9 +7,14 @@
 #define _SILENCE_CXX17_CODECVT_HEADER_DEPRECATION_WARNING
 #endif
 #include "LibXPUInfo.h"
+#include "LibXPUInfo_Util.h"
 #include <locale>
 #include <codecvt>
 #include <cwctype>
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+#include <cstdlib>
 
 namespace XI
 {
@@ -47,6 +52,213 @@ namespace XI
 		return data;
 	}
 
+namespace Sysfs
+{
+bool readString(const String& path, String& outValue)
+{
+	std::ifstream ifs(path);
+	if (!ifs.good())
+	{
+		return false;
+	}
+	std::ostringstream ostr;
+	ostr << ifs.rdbuf();
+	if (ifs.bad())
+	{
+		return false;
+	}
+	outValue = ostr.str();
+	while (outValue.size() && std::isspace((unsigned char)outValue.back()))
+	{
+		outValue.pop_back();
+	}
+	return true;
+}
+
+std::optional<UI64> readUI64(const String& path)
+{
+	String str;
+	if (readString(path, str) && str.size())
+	{
+		char* pEnd = nullptr;
+		UI64 val = std::strtoull(str.c_str(), &pEnd, 0);
+		if (pEnd != str.c_str())
+		{
+			return val;
+		}
+	}
+	return std::nullopt;
+}
+
+std::optional<I64> readI64(const String& path)
+{
+	String str;
+	if (readString(path, str) && str.size())
+	{
+		char* pEnd = nullptr;
+		I64 val = std::strtoll(str.c_str(), &pEnd, 0);
+		if (pEnd != str.c_str())
+		{
+			return val;
+		}
+	}
+	return std::nullopt;
+}
+
+bool writeString(const String& path, const String& value)
+{
+	// sysfs attributes must be written in a single write(), so no buffering/truncation tricks
+	std::ofstream ofs(path, std::ios::out | std::ios::trunc);
+	if (!ofs.good())
+	{
+		return false;
+	}
+	ofs << value;
+	ofs.flush();
+	return ofs.good();
+}
+
+bool exists(const String& path)
+{
+	std::error_code ec;
+	return std::filesystem::exists(path, ec);
+}
+
+std::vector<UI32> parseCPUList(const String& cpuList)
+{
+	std::vector<UI32> cpus;
+	std::istringstream istr(cpuList);
+	String range;
+	while (std::getline(istr, range, ','))
+	{
+		if (range.empty())
+		{
+			continue;
+		}
+		char* pEnd = nullptr;
+		const UI64 first = std::strtoull(range.c_str(), &pEnd, 10);
+		if (pEnd == range.c_str())
+		{
+			continue;
+		}
+		UI64 last = first;
+		if (*pEnd == '-')
+		{
+			const char* pLast = pEnd + 1;
+			last = std::strtoull(pLast, &pEnd, 10);
+			if (pEnd == pLast)
+			{
+				continue;
+			}
+		}
+		// Skip malformed ranges rather than expanding billions of CPUs
+		if ((last < first) || (last >= kMaxCPUs))
+		{
+			continue;
+		}
+		for (UI64 c = first; c <= last; ++c)
+		{
+			cpus.push_back(UI32(c));
+		}
+	}
+	std::sort(cpus.begin(), cpus.end());
+	cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+	return cpus;
+}
+
+String formatCPUList(const std::vector<UI32>& cpus)
+{
+	std::vector<UI32> sorted(cpus);
+	std::sort(sorted.begin(), sorted.end());
+	sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+
+	std::ostringstream ostr;
+	for (size_t i = 0; i < sorted.size();)
+	{
+		size_t j = i;
+		while ((j + 1 < sorted.size()) && (sorted[j + 1] == sorted[j] + 1))
+		{
+			++j;
+		}
+		if (i)
+		{
+			ostr << ",";
+		}
+		ostr << sorted[i];
+		if (j > i)
+		{
+			ostr << "-" << sorted[j];
+		}
+		i = j + 1;
+	}
+	return ostr.str();
+}
+
+std::vector<String> listEntries(const String& dir, const String& prefix)
+{
+	std::vector<String> names;
+	std::error_code ec;
+	for (const auto& entry : std::filesystem::directory_iterator(dir, ec))
+	{
+		String name = entry.path().filename().string();
+		if (name.compare(0, prefix.size(), prefix) == 0)
+		{
+			names.push_back(name);
+		}
+	}
+	std::sort(names.begin(), names.end());
+	return names;
+}
+
+std::vector<UI32> listIndexedEntries(const String& dir, const String& prefix)
+{
+	std::vector<UI32> indices;
+	for (const auto& name : listEntries(dir, prefix))
+	{
+		String suffix = name.substr(prefix.size());
+		if (suffix.size() && std::all_of(suffix.begin(), suffix.end(), [](char c) { return std::isdigit((unsigned char)c); }))
+		{
+			indices.push_back((UI32)std::strtoul(suffix.c_str(), nullptr, 10));
+		}
+	}
+	std::sort(indices.begin(), indices.end());
+	return indices;
+}
+
+std::map<short, std::vector<UI32>> getCPUsByCoreType(const String& sysRoot)
+{
+	std::map<short, std::vector<UI32>> cpusByType;
+	String cpuList;
+#if XPUINFO_CPU_X86_64
+	if (readString(sysRoot + "/devices/cpu_core/cpus", cpuList))
+	{
+		cpusByType[HybridDetect::CoreTypes::INTEL_CORE] = parseCPUList(cpuList);
+	}
+	if (readString(sysRoot + "/devices/cpu_atom/cpus", cpuList))
+	{
+		cpusByType[HybridDetect::CoreTypes::INTEL_ATOM] = parseCPUList(cpuList);
+	}
+#endif
+	if (cpusByType.empty())
+	{
+		std::vector<UI32> cpus;
+		if (readString(sysRoot + "/devices/system/cpu/online", cpuList))
+		{
+			cpus = parseCPUList(cpuList);
+		}
+		else
+		{
+			cpus = listIndexedEntries(sysRoot + "/devices/system/cpu", "cpu");
+		}
+		if (cpus.size())
+		{
+			cpusByType[HybridDetect::CoreTypes::ANY] = std::move(cpus);
+		}
+	}
+	return cpusByType;
+}
+} // Sysfs
+
 #ifdef _WIN32
 namespace Win
 {
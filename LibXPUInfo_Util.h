@@ -14,6 +14,7 @@
 #if XPUINFO_USE_STD_CHRONO
 #include <chrono>
 #endif
+#include <optional>
 
 namespace XI
 {
@@ -180,6 +181,16 @@ typedef UI64 TimerDuration;
         {
             return double(i() / Timer::GetScale());
         }
+
+        // Fractional seconds between two ticks
+        static double GetSecsBetween(TimerTick t0, TimerTick t1)
+        {
+#if !XPUINFO_USE_STD_CHRONO
+            return double(t1 - t0) / double(Timer::GetScale());
+#else
+            return std::chrono::duration<double>(t1 - t0).count();
+#endif
+        }
         TimerTick GetStart() const { return mStart; }
     private:
         TimerTick mStart;
@@ -188,6 +199,34 @@ typedef UI64 TimerDuration;
         double mInvTimerFrequency;
     };
 
+// Helpers for reading/writing Linux sysfs/procfs-style files.  All paths are composed from a
+// caller-provided root so that code using them can be exercised against a fixture directory tree.
+namespace Sysfs
+{
+    static const char kDefaultSysRoot[] = "/sys";
+
+    XPUINFO_EXPORT bool readString(const String& path, String& outValue); // Trailing whitespace removed
+    XPUINFO_EXPORT std::optional<UI64> readUI64(const String& path);
+    XPUINFO_EXPORT std::optional<I64> readI64(const String& path);
+    XPUINFO_EXPORT bool writeString(const String& path, const String& value);
+    XPUINFO_EXPORT bool exists(const String& path);
+
+    // Parse/format kernel cpulist format, i.e. "0-3,8,10-11".  Ranges that are reversed or reach
+    // kMaxCPUs (the kernel's largest NR_CPUS) are skipped.
+    static constexpr UI32 kMaxCPUs = 8192;
+    XPUINFO_EXPORT std::vector<UI32> parseCPUList(const String& cpuList);
+    XPUINFO_EXPORT String formatCPUList(const std::vector<UI32>& cpus);
+
+    // Sorted names of entries in dir beginning with prefix
+    XPUINFO_EXPORT std::vector<String> listEntries(const String& dir, const String& prefix = String());
+    // Numeric suffixes of entries named prefix<N>, i.e. "cpu0".."cpuN" (skips "cpufreq", "cpuidle")
+    XPUINFO_EXPORT std::vector<UI32> listIndexedEntries(const String& dir, const String& prefix);
+
+    // Logical CPUs keyed by HybridDetect::CoreTypes.  Uses the hybrid PMU cpu lists
+    // (devices/cpu_core, devices/cpu_atom) when present, else all online CPUs as CoreTypes::ANY.
+    XPUINFO_EXPORT std::map<short, std::vector<UI32>> getCPUsByCoreType(const String& sysRoot = kDefaultSysRoot);
+} // Sysfs
+
 #ifdef _WIN32
 namespace Win
 {
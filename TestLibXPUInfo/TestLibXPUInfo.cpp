@@ -10,10 +10,16 @@
 #include "LibXPUInfo.h"
 #include "LibXPUInfo_Util.h"
 #include "LibXPUInfo_JSON.h"
+#include "LibXPUInfo_ResCtrl.h"
+#include "LibXPUInfo_HostControl.h"
+#include "LibXPUInfo_TelemetryHistory.h"
 #include <iostream>
 #include <filesystem>
 #include <fstream>
 #include <sstream>
+#include <algorithm>
+#include <random>
+#include <cstring>
 
 using namespace XI;
 
@@ -126,6 +132,455 @@ bool testReadJSON(const std::filesystem::path jsonPath)
 }
 #endif
 
+// Fixture trees for sysfs-based modules: files are written, modified through the library, then compared
+namespace Fixture
+{
+    typedef std::map<String, String> Snapshot; // Relative path -> contents
+
+    void writeFile(const std::filesystem::path& path, const String& contents)
+    {
+        std::filesystem::create_directories(path.parent_path());
+        std::ofstream(path) << contents;
+    }
+
+    String readFile(const std::filesystem::path& path)
+    {
+        String value;
+        Sysfs::readString(path.string(), value);
+        return value;
+    }
+
+    Snapshot snapshot(const std::filesystem::path& root)
+    {
+        Snapshot files;
+        for (const auto& entry : std::filesystem::recursive_directory_iterator(root))
+        {
+            if (entry.is_regular_file())
+            {
+                files[std::filesystem::relative(entry.path(), root).generic_string()] = readFile(entry.path());
+            }
+        }
+        return files;
+    }
+
+    bool check(bool condition, const char* expr)
+    {
+        if (!condition)
+        {
+            std::cout << "Check failed: " << expr << std::endl;
+        }
+        return condition;
+    }
+}
+#define FIXTURE_CHECK(cond) bOK = Fixture::check((cond), #cond) && bOK
+
+namespace Fixture
+{
+    void eraseAll(std::vector<UI32>& cpus, const std::vector<UI32>& toErase)
+    {
+        cpus.erase(std::remove_if(cpus.begin(), cpus.end(),
+            [&toErase](UI32 cpu) { return std::find(toErase.begin(), toErase.end(), cpu) != toErase.end(); }), cpus.end());
+    }
+
+    // Plain files do not have the resctrl kernel's side effects, so emulate them
+    class ResCtrlTree : public ResCtrl
+    {
+    public:
+        ResCtrlTree(const String& root) : ResCtrl(root) {}
+
+        // Tasks and CPUs of the group return to the default group
+        bool removeGroup(const String& group) override
+        {
+            const auto tids = getTasks(group);
+            auto cpus = getCPUs(String());
+            const auto groupCPUs = getCPUs(group);
+            std::error_code ec;
+            if (!std::filesystem::remove_all(getGroupPath(group), ec) || ec)
+            {
+                return false;
+            }
+            cpus.insert(cpus.end(), groupCPUs.begin(), groupCPUs.end());
+            std::sort(cpus.begin(), cpus.end());
+            return assignTasks(String(), tids) && Sysfs::writeString(getGroupPath(String()) + "/cpus_list", Sysfs::formatCPUList(cpus));
+        }
+
+        // Partial writes merge with the current schemata
+        bool writeSchemata(const String& group, const Schemata& schemata) override
+        {
+            Schemata merged;
+            readSchemata(group, merged);
+            for (const auto& [resource, domains] : schemata)
+            {
+                for (const auto& [domain, value] : domains)
+                {
+                    merged[resource][domain] = value;
+                }
+            }
+            return Sysfs::writeString(getGroupPath(group) + "/schemata", formatSchemata(merged));
+        }
+
+        // A task belongs to one group
+        bool assignTasks(const String& group, const std::vector<UI64>& tids) override
+        {
+            auto groups = getGroups();
+            groups.push_back(String());
+            bool bOK = true;
+            for (const auto& g : groups)
+            {
+                auto cur = getTasks(g);
+                const size_t prevSize = cur.size();
+                cur.erase(std::remove_if(cur.begin(), cur.end(),
+                    [&tids](UI64 tid) { return std::find(tids.begin(), tids.end(), tid) != tids.end(); }), cur.end());
+                if (g == group)
+                {
+                    cur.insert(cur.end(), tids.begin(), tids.end());
+                }
+                else if (cur.size() == prevSize)
+                {
+                    continue;
+                }
+                std::ostringstream ostr;
+                for (auto tid : cur)
+                {
+                    ostr << tid << "\n";
+                }
+                bOK = Sysfs::writeString(getGroupPath(g) + "/tasks", ostr.str()) && bOK;
+            }
+            return bOK;
+        }
+
+        // A CPU belongs to one group; those not in other groups belong to the default group, which
+        // cannot drop CPUs
+        bool setCPUs(const String& group, const std::vector<UI32>& cpus) override
+        {
+            auto defaultCPUs = getCPUs(String());
+            if (group.empty())
+            {
+                auto dropped = defaultCPUs;
+                eraseAll(dropped, cpus);
+                if (dropped.size())
+                {
+                    return false;
+                }
+            }
+            bool bOK = true;
+            defaultCPUs.insert(defaultCPUs.end(), cpus.begin(), cpus.end());
+            std::vector<UI32> assigned;
+            for (const auto& g : getGroups())
+            {
+                auto cur = getCPUs(g);
+                defaultCPUs.insert(defaultCPUs.end(), cur.begin(), cur.end());
+                if (g == group)
+                {
+                    cur = cpus;
+                    bOK = Sysfs::writeString(getGroupPath(g) + "/cpus_list", Sysfs::formatCPUList(cur)) && bOK;
+                }
+                else
+                {
+                    const size_t prevSize = cur.size();
+                    eraseAll(cur, cpus);
+                    if (cur.size() != prevSize)
+                    {
+                        bOK = Sysfs::writeString(getGroupPath(g) + "/cpus_list", Sysfs::formatCPUList(cur)) && bOK;
+                    }
+                }
+                assigned.insert(assigned.end(), cur.begin(), cur.end());
+            }
+            eraseAll(defaultCPUs, assigned);
+            std::sort(defaultCPUs.begin(), defaultCPUs.end());
+            defaultCPUs.erase(std::unique(defaultCPUs.begin(), defaultCPUs.end()), defaultCPUs.end());
+            return Sysfs::writeString(getGroupPath(String()) + "/cpus_list", Sysfs::formatCPUList(defaultCPUs)) && bOK;
+        }
+    };
+
+    // Rejects the cpufreq writes intel_pstate would, so write-order bugs show up on plain files
+    bool writeCPUFreqAttribute(const String& path, const String& value)
+    {
+        const size_t slash = path.rfind('/');
+        const String dir = path.substr(0, slash + 1);
+        const String attribute = path.substr(slash + 1);
+        String governor;
+        if ((attribute == "energy_performance_preference") && Sysfs::readString(dir + "scaling_governor", governor) &&
+            (governor == "performance") && (value != "performance"))
+        {
+            return false; // EBUSY
+        }
+        auto other = Sysfs::readUI64(dir + ((attribute == "scaling_min_freq") ? "scaling_max_freq" : "scaling_min_freq"));
+        const UI64 freq = std::strtoull(value.c_str(), nullptr, 10);
+        if (other.has_value() && (((attribute == "scaling_min_freq") && (freq > other.value())) ||
+            ((attribute == "scaling_max_freq") && (freq < other.value()))))
+        {
+            return false; // EINVAL
+        }
+        return Sysfs::writeString(path, value);
+    }
+}
+
+bool testResCtrlFixture()
+{
+    const auto root = std::filesystem::temp_directory_path() / "TestLibXPUInfo_resctrl";
+    std::filesystem::remove_all(root);
+    Fixture::writeFile(root / "info/L3/cbm_mask", "ff\n");
+    Fixture::writeFile(root / "info/L3/num_closids", "16\n");
+    Fixture::writeFile(root / "info/L3/min_cbm_bits", "1\n");
+    Fixture::writeFile(root / "info/L3/shareable_bits", "0\n");
+    Fixture::writeFile(root / "info/MB/num_closids", "8\n");
+    Fixture::writeFile(root / "info/MB/bandwidth_gran", "10\n");
+    Fixture::writeFile(root / "info/MB/min_bandwidth", "10\n");
+    Fixture::writeFile(root / "info/MB/delay_linear", "1\n");
+    Fixture::writeFile(root / "schemata", "L3:0=ff;1=ff\nMB:0=100;1=100\n");
+    Fixture::writeFile(root / "cpus_list", "0-5\n");
+    Fixture::writeFile(root / "tasks", "1\n2\n4242\n");
+    Fixture::writeFile(root / "other/schemata", "L3:0=f0;1=f0\nMB:0=100;1=100\n");
+    Fixture::writeFile(root / "other/cpus_list", "6-7\n");
+    Fixture::writeFile(root / "other/tasks", "77\n");
+    const auto before = Fixture::snapshot(root);
+
+    bool bOK = true;
+    Fixture::ResCtrlTree rc(root.string());
+    FIXTURE_CHECK(rc.getCacheAllocCaps("L3") && (rc.getCacheAllocCaps("L3")->numWays == 8));
+    FIXTURE_CHECK(rc.getMemBWAllocCaps().has_value());
+    FIXTURE_CHECK(rc.getGroups() == std::vector<String>{ "other" });
+
+    {
+        // New group: created, then removed with tasks and CPUs returned to the default group
+        ResCtrlGroupGuard::Params params;
+        params.group = "test";
+        params.tids = { 4242 };
+        params.cpus = { 2, 3 };
+        params.schemata = ResCtrl::Schemata{ { "L3", { { 0, 0x3 }, { 1, 0x3 } } } };
+        ResCtrlGroupGuard guard(rc, params);
+        FIXTURE_CHECK(guard.isApplied());
+        FIXTURE_CHECK(rc.getCPUs("test") == std::vector<UI32>({ 2, 3 }));
+        FIXTURE_CHECK(rc.getCPUs("") == std::vector<UI32>({ 0, 1, 4, 5 }));
+        FIXTURE_CHECK(rc.findGroupOfTask(4242) == String("test"));
+        ResCtrl::Schemata schemata;
+        FIXTURE_CHECK(rc.readSchemata("test", schemata) && (schemata["L3"][1] == 0x3));
+        guard.restore();
+        FIXTURE_CHECK(!rc.hasGroup("test"));
+        FIXTURE_CHECK(rc.findGroupOfTask(4242) == String());
+    }
+    FIXTURE_CHECK(Fixture::snapshot(root) == before);
+
+    {
+        // Existing group: CPUs, schemata and tasks restored
+        ResCtrlGroupGuard::Params params;
+        params.group = "other";
+        params.tids = { 4242 };
+        params.cpus = { 4 };
+        params.schemata = ResCtrl::Schemata{ { "MB", { { 0, 50 }, { 1, 50 } } } };
+        ResCtrlGroupGuard guard(rc, params);
+        FIXTURE_CHECK(guard.isApplied());
+        FIXTURE_CHECK(rc.getCPUs("other") == std::vector<UI32>({ 4, 6, 7 }));
+        ResCtrl::Schemata schemata;
+        FIXTURE_CHECK(rc.readSchemata("other", schemata) && (schemata["MB"][0] == 50) && (schemata["L3"][0] == 0xf0));
+    }
+    const auto after = Fixture::snapshot(root);
+    FIXTURE_CHECK(after.at("other/cpus_list") == "6-7");
+    FIXTURE_CHECK(after.at("cpus_list") == "0-5");
+    FIXTURE_CHECK(after.at("tasks") == "1\n2\n4242");
+    ResCtrl::Schemata restored, original;
+    FIXTURE_CHECK(ResCtrl::parseSchemata(after.at("other/schemata"), restored) &&
+        ResCtrl::parseSchemata(before.at("other/schemata"), original) && (restored == original));
+
+    {
+        // Default group: CPUs taken from other groups are given back
+        ResCtrlGroupGuard::Params params;
+        params.cpus = { 6 };
+        ResCtrlGroupGuard guard(rc, params);
+        FIXTURE_CHECK(guard.isApplied());
+        FIXTURE_CHECK(rc.getCPUs("") == std::vector<UI32>({ 0, 1, 2, 3, 4, 5, 6 }));
+        FIXTURE_CHECK(rc.getCPUs("other") == std::vector<UI32>({ 7 }));
+    }
+    FIXTURE_CHECK(Fixture::readFile(root / "cpus_list") == "0-5");
+    FIXTURE_CHECK(Fixture::readFile(root / "other/cpus_list") == "6-7");
+
+    std::filesystem::remove_all(root);
+    std::cout << "ResCtrl fixture test " << (bOK ? "passed" : "FAILED") << std::endl;
+    return bOK;
+}
+
+bool testCPUPerfModeFixture()
+{
+    const auto root = std::filesystem::temp_directory_path() / "TestLibXPUInfo_cpufreq";
+    const String journal = (std::filesystem::temp_directory_path() / "TestLibXPUInfo_cpufreq.journal").string();
+    std::filesystem::remove_all(root);
+    std::filesystem::remove(journal);
+    Fixture::writeFile(root / "devices/system/cpu/online", "0-1\n");
+    for (const char* cpu : { "cpu0", "cpu1" })
+    {
+        const auto dir = root / "devices/system/cpu" / cpu / "cpufreq";
+        Fixture::writeFile(dir / "scaling_governor", "powersave\n");
+        Fixture::writeFile(dir / "scaling_available_governors", "performance powersave\n");
+        Fixture::writeFile(dir / "energy_performance_preference", "balance_power\n");
+        Fixture::writeFile(dir / "energy_performance_available_preferences", "default performance balance_performance balance_power power\n");
+        Fixture::writeFile(dir / "scaling_min_freq", "800000\n");
+        Fixture::writeFile(dir / "scaling_max_freq", "2000000\n");
+        Fixture::writeFile(dir / "cpuinfo_min_freq", "400000\n");
+        Fixture::writeFile(dir / "cpuinfo_max_freq", "5000000\n");
+    }
+    Fixture::writeFile(root / "firmware/acpi/platform_profile", "balanced\n");
+    Fixture::writeFile(root / "firmware/acpi/platform_profile_choices", "low-power balanced performance\n");
+    const auto before = Fixture::snapshot(root);
+
+    // EPP requires the governor to change first; min above the current max requires max first
+    CPUPerfModeGuard::Params params;
+    params.sysRoot = root.string();
+    params.journalPath = journal;
+    params.writeFunc = Fixture::writeCPUFreqAttribute;
+    auto& settings = params.coreTypes[HybridDetect::CoreTypes::ANY];
+    settings.governor = "performance";
+    settings.epp = "performance";
+    settings.minFreqKHz = 3000000;
+    settings.maxFreqKHz = 4500000;
+    params.platformProfile = "performance";
+
+    bool bOK = true;
+    {
+        params.dryRun = true;
+        CPUPerfModeGuard guard(params);
+        FIXTURE_CHECK(!guard.isApplied() && (guard.getChanges().size() == 9));
+        FIXTURE_CHECK(Fixture::snapshot(root) == before);
+        params.dryRun = false;
+    }
+    {
+        CPUPerfModeGuard guard(params);
+        FIXTURE_CHECK(guard.isApplied());
+        const auto applied = Fixture::snapshot(root);
+        FIXTURE_CHECK(applied.at("devices/system/cpu/cpu1/cpufreq/scaling_governor") == "performance");
+        FIXTURE_CHECK(applied.at("devices/system/cpu/cpu1/cpufreq/energy_performance_preference") == "performance");
+        FIXTURE_CHECK(applied.at("devices/system/cpu/cpu1/cpufreq/scaling_min_freq") == "3000000");
+        FIXTURE_CHECK(applied.at("devices/system/cpu/cpu1/cpufreq/scaling_max_freq") == "4500000");
+        FIXTURE_CHECK(applied.at("firmware/acpi/platform_profile") == "performance");
+        FIXTURE_CHECK(Sysfs::exists(journal));
+    }
+    FIXTURE_CHECK(Fixture::snapshot(root) == before);
+    FIXTURE_CHECK(!Sysfs::exists(journal));
+
+    // Simulate a crash: the guard is never destroyed, so only the journal can undo it
+    FIXTURE_CHECK((new CPUPerfModeGuard(params))->isApplied());
+    FIXTURE_CHECK(Fixture::snapshot(root) != before);
+    FIXTURE_CHECK(CPUPerfModeGuard::recoverFromJournal(journal, Fixture::writeCPUFreqAttribute));
+    FIXTURE_CHECK(Fixture::snapshot(root) == before);
+    FIXTURE_CHECK(!Sysfs::exists(journal));
+
+    // The next guard with the same journal recovers first, so it restores the original values
+    FIXTURE_CHECK((new CPUPerfModeGuard(params))->isApplied());
+    {
+        CPUPerfModeGuard::Params other = params;
+        other.coreTypes[HybridDetect::CoreTypes::ANY].epp.reset();
+        other.coreTypes[HybridDetect::CoreTypes::ANY].minFreqKHz.reset();
+        other.coreTypes[HybridDetect::CoreTypes::ANY].governor = "powersave";
+        other.coreTypes[HybridDetect::CoreTypes::ANY].maxFreqKHz = 1000000;
+        CPUPerfModeGuard guard(other);
+        FIXTURE_CHECK(guard.isApplied());
+    }
+    FIXTURE_CHECK(Fixture::snapshot(root) == before);
+    FIXTURE_CHECK(!Sysfs::exists(journal));
+
+    std::filesystem::remove_all(root);
+    std::cout << "CPUPerfModeGuard fixture test " << (bOK ? "passed" : "FAILED") << std::endl;
+    return bOK;
+}
+
+#ifdef XPUINFO_USE_TELEMETRYTRACKER
+// Compressed history must decode bit-exact records, including after dropping blocks
+bool testTelemetryHistory()
+{
+    typedef TelemetryTracker::TimedRecord TimedRecord;
+    const auto same = [](const TimedRecord& a, const TimedRecord& b) { return std::memcmp(&a, &b, sizeof(TimedRecord)) == 0; };
+    std::mt19937_64 rng(1);
+
+    // Realistic: steady sample interval with jitter, monotonic counters, quantized and constant values
+    std::vector<TimedRecord> records;
+    UI64 timeStamp = 123456789000ULL;
+    UI64 readBytes = 0;
+    for (UI32 i = 0; i < 5000; ++i)
+    {
+        TimedRecord rec{};
+        timeStamp += 20000000 + (rng() % 100000);
+        rec.timeStampUI64 = timeStamp;
+        rec.freq = 1200 + 50 * double(rng() % 4);
+        readBytes += rng() % 1000000;
+        rec.bw_read = readBytes;
+        rec.deviceMemoryUsedBytes = 1ULL << 30;
+        rec.deviceMemoryBudgetBytes = 8ULL << 30;
+        rec.activity_global = (rng() % 1000) / 10.0;
+        rec.cpuTempC = 50 + double(rng() % 10);
+        rec.cpuIdlePct[0] = (rng() % 10000) / 100.0;
+        rec.hostMemBWTotal[0] = std::nan("");
+        rec.hostMemBWTotal[1] = -0.0;
+        rec.cpuThrottleEvents[1] = i / 100;
+        records.push_back(rec);
+    }
+
+    bool bOK = true;
+    {
+        TelemetryHistory history;
+        for (const auto& rec : records)
+        {
+            history.append(rec);
+        }
+        UI64 i = 0;
+        bool bSame = true;
+        for (auto it = history.begin(); it != history.end(); ++it, ++i)
+        {
+            bSame = bSame && same(*it, records[i]) && (it.getIndex() == i);
+        }
+        FIXTURE_CHECK(bSame && (i == records.size()));
+        FIXTURE_CHECK(history.getBytes() < history.getUncompressedBytes() / 4);
+
+        auto it = history.lowerBound(records[3000].timeStampUI64 - 1);
+        FIXTURE_CHECK((it != history.end()) && (it.getIndex() == 3000) && same(*it, records[3000]));
+        FIXTURE_CHECK(history.lowerBound(records.front().timeStampUI64).getIndex() == 0);
+        FIXTURE_CHECK(history.lowerBound(timeStamp + 1) == history.end());
+    }
+    {
+        // Random words exercise the widest XOR and delta-of-delta encodings
+        TelemetryHistory history;
+        std::vector<TimedRecord> randomRecords(600);
+        for (auto& rec : randomRecords)
+        {
+            UI64 words[TelemetryHistory::kWordsPerRecord];
+            for (auto& word : words)
+            {
+                word = rng();
+            }
+            std::memcpy(&rec, words, sizeof(rec));
+            history.append(rec);
+        }
+        size_t i = 0;
+        bool bSame = true;
+        for (const auto& rec : history)
+        {
+            bSame = bSame && same(rec, randomRecords[i++]);
+        }
+        FIXTURE_CHECK(bSame && (i == randomRecords.size()));
+    }
+    {
+        // Bounded: the oldest blocks are dropped, indices still refer to the appended records
+        TelemetryHistory history(8192);
+        for (const auto& rec : records)
+        {
+            history.append(rec);
+        }
+        FIXTURE_CHECK(history.getNumDropped() > 0);
+        FIXTURE_CHECK(history.getNumDropped() + history.size() == records.size());
+        FIXTURE_CHECK(history.begin().getIndex() == history.getNumDropped());
+        bool bSame = true;
+        for (auto it = history.begin(); it != history.end(); ++it)
+        {
+            bSame = bSame && same(*it, records[it.getIndex()]);
+        }
+        FIXTURE_CHECK(bSame);
+        FIXTURE_CHECK(history.lowerBound(records.front().timeStampUI64) == history.begin());
+    }
+
+    std::cout << "TelemetryHistory test " << (bOK ? "passed" : "FAILED") << std::endl;
+    return bOK;
+}
+#endif // XPUINFO_USE_TELEMETRYTRACKER
+
 #if TESTLIBXPUINFO_STANDALONE
 int main(int argc, char* argv[])
 #else
@@ -133,6 +588,7 @@ int printXPUInfo(int argc, char* argv[])
 #endif
 {
     bool testIndividual = false;
+    bool testsPassed = true;
     APIType additionalAPIs = APIType(0);
     APIType apiMask = APIType(0);
     for (int a = 1; a < argc; ++a)
@@ -159,6 +615,20 @@ int printXPUInfo(int argc, char* argv[])
                 apiMask = static_cast<APIType>(inMask);
             }
         }
+        if (arg == "-test_resctrl")
+        {
+            testsPassed = testResCtrlFixture() && testsPassed;
+        }
+        if (arg == "-test_cpu_perf_mode")
+        {
+            testsPassed = testCPUPerfModeFixture() && testsPassed;
+        }
+#ifdef XPUINFO_USE_TELEMETRYTRACKER
+        if (arg == "-test_telemetry_history")
+        {
+            testsPassed = testTelemetryHistory() && testsPassed;
+        }
+#endif
 #ifdef XPUINFO_USE_RAPIDJSON
         if (arg == "-write_json")
         {
@@ -240,5 +710,5 @@ int printXPUInfo(int argc, char* argv[])
         std::cout << "Exception initializing XPUInfo!\n";
         return -1;
     }
-    return 0;
+    return testsPassed ? 0 : -1;
 }